@@ -0,0 +1,179 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file BloomFilter.cpp
+ * @brief Implements the Bloom filter used as the visited URL set.
+ */
+
+#include "stdafx.h"
+#include "BloomFilter.h"
+#include <cmath>
+
+static const char BLOOM_MAGIC[8] = { 'W', 'S', 'E', 'B', 'L', 'O', 'O', 'M' };
+static const unsigned int BLOOM_VERSION = 1;
+
+/**
+ * @brief Returns the number of bytes between the read position and the end of a stream,
+ *        or 0 if the stream cannot tell.
+ */
+static unsigned __int64 GetRemainingBytes(std::istream& pStream)
+{
+	const std::streampos nPosition = pStream.tellg();
+	if (nPosition < 0)
+		return 0;
+	pStream.seekg(0, std::ios::end);
+	const std::streampos nEnd = pStream.tellg();
+	pStream.seekg(nPosition);
+	if (!pStream.good() || (nEnd < nPosition))
+		return 0;
+	return static_cast<unsigned __int64>(nEnd - nPosition);
+}
+
+CBloomFilter::CBloomFilter()
+{
+}
+
+CBloomFilter::~CBloomFilter()
+{
+}
+
+bool CBloomFilter::Create(size_t nMemoryBytes, double rFalsePositiveRate)
+{
+	if ((nMemoryBytes < sizeof(unsigned __int64)) || (rFalsePositiveRate <= 0.0) || (rFalsePositiveRate >= 1.0))
+		return false;
+
+	const double rLn2 = std::log(2.0);
+	m_arrBits.assign(nMemoryBytes / sizeof(unsigned __int64), 0);
+	m_nBitCount = m_arrBits.size() * 64;
+	m_nSetBits = 0;
+	m_nInserted = 0;
+	// optimal probe count k = -log2(p), capacity n = -m * ln(2)^2 / ln(p)
+	m_nHashCount = std::max(1u, static_cast<unsigned int>(std::lround(-std::log(rFalsePositiveRate) / rLn2)));
+	m_nCapacity = static_cast<unsigned __int64>(-static_cast<double>(m_nBitCount) * rLn2 * rLn2 / std::log(rFalsePositiveRate));
+	return true;
+}
+
+void CBloomFilter::InsertHash(unsigned __int64 nHash)
+{
+	if (m_arrBits.empty())
+		return;
+
+	// double hashing: probe i is h1 + i * h2, with h2 odd so probes do not repeat
+	const unsigned __int64 nFirst = nHash;
+	const unsigned __int64 nSecond = ((nHash >> 33) | (nHash << 31)) | 1;
+	for (unsigned int nProbe = 0; nProbe < m_nHashCount; nProbe++)
+	{
+		const unsigned __int64 nBit = (nFirst + nProbe * nSecond) % m_nBitCount;
+		unsigned __int64& nWord = m_arrBits[nBit >> 6];
+		const unsigned __int64 nMask = 1ULL << (nBit & 63);
+		if ((nWord & nMask) == 0)
+		{
+			nWord |= nMask;
+			m_nSetBits++;
+		}
+	}
+	m_nInserted++;
+}
+
+bool CBloomFilter::ContainsHash(unsigned __int64 nHash) const
+{
+	if (m_arrBits.empty())
+		return false;
+
+	const unsigned __int64 nFirst = nHash;
+	const unsigned __int64 nSecond = ((nHash >> 33) | (nHash << 31)) | 1;
+	for (unsigned int nProbe = 0; nProbe < m_nHashCount; nProbe++)
+	{
+		const unsigned __int64 nBit = (nFirst + nProbe * nSecond) % m_nBitCount;
+		if ((m_arrBits[nBit >> 6] & (1ULL << (nBit & 63))) == 0)
+			return false;
+	}
+	return true;
+}
+
+double CBloomFilter::GetEstimatedFalsePositiveRate() const
+{
+	if (m_nBitCount == 0)
+		return 0.0;
+	return std::pow(static_cast<double>(m_nSetBits) / static_cast<double>(m_nBitCount), static_cast<double>(m_nHashCount));
+}
+
+bool CBloomFilter::Save(std::ostream& pStream) const
+{
+	const unsigned __int64 nWords = m_arrBits.size();
+	pStream.write(BLOOM_MAGIC, sizeof(BLOOM_MAGIC));
+	pStream.write(reinterpret_cast<const char*>(&BLOOM_VERSION), sizeof(BLOOM_VERSION));
+	pStream.write(reinterpret_cast<const char*>(&m_nHashCount), sizeof(m_nHashCount));
+	pStream.write(reinterpret_cast<const char*>(&m_nSetBits), sizeof(m_nSetBits));
+	pStream.write(reinterpret_cast<const char*>(&m_nInserted), sizeof(m_nInserted));
+	pStream.write(reinterpret_cast<const char*>(&m_nCapacity), sizeof(m_nCapacity));
+	pStream.write(reinterpret_cast<const char*>(&nWords), sizeof(nWords));
+	if (nWords > 0)
+		pStream.write(reinterpret_cast<const char*>(m_arrBits.data()), static_cast<std::streamsize>(nWords * sizeof(unsigned __int64)));
+	return pStream.good();
+}
+
+bool CBloomFilter::Load(std::istream& pStream)
+{
+	char lpszMagic[sizeof(BLOOM_MAGIC)] = { 0, };
+	unsigned int nVersion = 0;
+	unsigned __int64 nWords = 0;
+	pStream.read(lpszMagic, sizeof(lpszMagic));
+	pStream.read(reinterpret_cast<char*>(&nVersion), sizeof(nVersion));
+	if (!pStream.good() || (memcmp(lpszMagic, BLOOM_MAGIC, sizeof(BLOOM_MAGIC)) != 0) || (nVersion != BLOOM_VERSION))
+		return false;
+
+	pStream.read(reinterpret_cast<char*>(&m_nHashCount), sizeof(m_nHashCount));
+	pStream.read(reinterpret_cast<char*>(&m_nSetBits), sizeof(m_nSetBits));
+	pStream.read(reinterpret_cast<char*>(&m_nInserted), sizeof(m_nInserted));
+	pStream.read(reinterpret_cast<char*>(&m_nCapacity), sizeof(m_nCapacity));
+	pStream.read(reinterpret_cast<char*>(&nWords), sizeof(nWords));
+	// without probes every key would look present; the bit array must fit in the rest of the stream
+	if (!pStream.good() || (m_nHashCount == 0) || (nWords > GetRemainingBytes(pStream) / sizeof(unsigned __int64)))
+	{
+		m_arrBits.clear();
+		m_nBitCount = 0;
+		return false;
+	}
+
+	m_arrBits.assign(static_cast<size_t>(nWords), 0);
+	if (nWords > 0)
+		pStream.read(reinterpret_cast<char*>(m_arrBits.data()), static_cast<std::streamsize>(nWords * sizeof(unsigned __int64)));
+	m_nBitCount = nWords * 64;
+	if (!pStream.good())
+	{
+		m_arrBits.clear();
+		m_nBitCount = 0;
+		return false;
+	}
+	return true;
+}
+
+unsigned __int64 CBloomFilter::Hash(const std::string& lpszKey)
+{
+	unsigned __int64 nHash = 14695981039346656037ULL;
+	for (const char ch : lpszKey)
+	{
+		nHash ^= static_cast<unsigned char>(ch);
+		nHash *= 1099511628211ULL;
+	}
+	// fmix64 from MurmurHash3 spreads FNV's weak low bits across the word
+	nHash ^= nHash >> 33;
+	nHash *= 0xff51afd7ed558ccdULL;
+	nHash ^= nHash >> 33;
+	nHash *= 0xc4ceb9fe1a85ec53ULL;
+	nHash ^= nHash >> 33;
+	return nHash;
+}
@@ -0,0 +1,97 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file BloomFilter.h
+ * @brief Declaration of a fixed-size Bloom filter used as the visited URL set
+ *        for crawls that do not fit in memory as an exact hash set.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+/**
+ * @class CBloomFilter
+ * @brief Probabilistic set with a fixed memory budget and no false negatives.
+ *
+ * The number of hash functions is derived from the requested false positive rate,
+ * and the capacity from the memory budget; inserting more keys than the capacity
+ * keeps working but the false positive rate degrades.
+ */
+class CBloomFilter
+{
+public:
+	CBloomFilter();
+	~CBloomFilter();
+
+public:
+	/**
+	 * @brief Allocates the bit array.
+	 * @param nMemoryBytes Memory budget for the bit array, in bytes.
+	 * @param rFalsePositiveRate Target false positive rate, for example 0.001.
+	 * @return true if the filter was created.
+	 */
+	bool Create(size_t nMemoryBytes, double rFalsePositiveRate);
+
+	/**
+	 * @brief Adds a key to the filter.
+	 */
+	void Insert(const std::string& lpszKey) { InsertHash(Hash(lpszKey)); }
+
+	/**
+	 * @brief Checks whether a key may have been inserted.
+	 * @return false if the key was definitely never inserted.
+	 */
+	bool Contains(const std::string& lpszKey) const { return ContainsHash(Hash(lpszKey)); }
+
+	void InsertHash(unsigned __int64 nHash);
+	bool ContainsHash(unsigned __int64 nHash) const;
+
+	/**
+	 * @brief Writes the filter to a binary stream.
+	 */
+	bool Save(std::ostream& pStream) const;
+
+	/**
+	 * @brief Replaces the filter with one previously written by Save.
+	 */
+	bool Load(std::istream& pStream);
+
+	/**
+	 * @brief Estimates the current false positive rate from the fraction of set bits.
+	 */
+	double GetEstimatedFalsePositiveRate() const;
+
+	bool IsCreated() const { return !m_arrBits.empty(); }
+	size_t GetMemoryBytes() const { return m_arrBits.size() * sizeof(unsigned __int64); }
+	unsigned __int64 GetCapacity() const { return m_nCapacity; }
+	unsigned __int64 GetInsertedCount() const { return m_nInserted; }
+
+	/**
+	 * @brief Stable 64-bit hash of a string (FNV-1a with a murmur finalizer),
+	 *        so that saved filters remain valid across builds.
+	 */
+	static unsigned __int64 Hash(const std::string& lpszKey);
+
+protected:
+	std::vector<unsigned __int64> m_arrBits; ///< Bit array
+	unsigned __int64 m_nBitCount = 0;        ///< Number of bits in the array
+	unsigned __int64 m_nSetBits = 0;         ///< Number of bits currently set
+	unsigned __int64 m_nInserted = 0;        ///< Number of Insert calls
+	unsigned __int64 m_nCapacity = 0;        ///< Keys that fit at the target rate
+	unsigned int m_nHashCount = 0;           ///< Number of probes per key
+};
@@ -0,0 +1,211 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file ConcurrentFrontier.cpp
+ * @brief Implements the lock-free intake and the per-thread batches.
+ */
+
+#include "stdafx.h"
+#include "ConcurrentFrontier.h"
+#include "UrlFrontier.h"
+#include "PolitenessScheduler.h"
+#include "CrawlerMetrics.h"
+
+#define INTAKE_DRAIN 4096 // intake size at which producers try to move it into the frontier
+
+CFrontierBatch::CFrontierBatch(CConcurrentFrontier* pOwner)
+	: m_pOwner(pOwner)
+{
+}
+
+CFrontierBatch::~CFrontierBatch()
+{
+	m_pOwner->Unregister(this);
+}
+
+CConcurrentFrontier::CConcurrentFrontier(CUrlFrontier& pFrontier, CPolitenessScheduler& pScheduler)
+	: m_pFrontier(pFrontier), m_pScheduler(pScheduler)
+{
+}
+
+CConcurrentFrontier::~CConcurrentFrontier()
+{
+	CIntakeNode* pNode = m_pIntake.exchange(nullptr);
+	while (pNode != nullptr)
+	{
+		CIntakeNode* pNext = pNode->m_pNext;
+		delete pNode;
+		pNode = pNext;
+	}
+}
+
+void CConcurrentFrontier::Add(std::string lpszURL, double rCash)
+{
+	CIntakeNode* pNode = new CIntakeNode;
+	pNode->m_strURL = std::move(lpszURL);
+	pNode->m_rCash = rCash;
+	pNode->m_pNext = m_pIntake.load(std::memory_order_relaxed);
+	while (!m_pIntake.compare_exchange_weak(pNode->m_pNext, pNode, std::memory_order_release, std::memory_order_relaxed))
+		;
+
+	if (m_nIntakeCount.fetch_add(1, std::memory_order_relaxed) + 1 >= INTAKE_DRAIN)
+	{
+		// help the consumers, but never wait for them
+		std::unique_lock<std::mutex> lock(m_mutexFrontier, std::try_to_lock);
+		if (lock.owns_lock())
+			DrainIntake();
+	}
+}
+
+void CConcurrentFrontier::DrainIntake()
+{
+	CIntakeNode* pNode = m_pIntake.exchange(nullptr, std::memory_order_acquire);
+	if (pNode == nullptr)
+		return;
+
+	// the stack is newest first; reverse it so URLs enter the frontier in discovery order
+	CIntakeNode* pReversed = nullptr;
+	while (pNode != nullptr)
+	{
+		CIntakeNode* pNext = pNode->m_pNext;
+		pNode->m_pNext = pReversed;
+		pReversed = pNode;
+		pNode = pNext;
+	}
+
+	size_t nCount = 0;
+	while (pReversed != nullptr)
+	{
+		CIntakeNode* pNext = pReversed->m_pNext;
+		m_pFrontier.Add(pReversed->m_strURL, pReversed->m_rCash);
+		delete pReversed;
+		pReversed = pNext;
+		nCount++;
+	}
+	m_nIntakeCount.fetch_sub(nCount, std::memory_order_relaxed);
+	m_nDrains++;
+}
+
+CFrontierBatch& CConcurrentFrontier::GetBatch()
+{
+	// one batch per consumer thread, registered on first use so Save can reach it
+	thread_local std::unique_ptr<CFrontierBatch> pBatch;
+	if (pBatch == nullptr)
+	{
+		pBatch = std::make_unique<CFrontierBatch>(this);
+		std::lock_guard<std::mutex> lock(m_mutexFrontier);
+		m_arrBatches.push_back(pBatch.get());
+	}
+	return *pBatch;
+}
+
+void CConcurrentFrontier::Unregister(CFrontierBatch* pBatch)
+{
+	std::lock_guard<std::mutex> lock(m_mutexFrontier);
+	ReturnBatch(pBatch);
+	m_arrBatches.erase(std::remove(m_arrBatches.begin(), m_arrBatches.end(), pBatch), m_arrBatches.end());
+}
+
+void CConcurrentFrontier::ReturnBatch(CFrontierBatch* pBatch)
+{
+	// newest first, so the batch ends up at the head of its back queues in its original order
+	for (auto it = pBatch->m_arrURLs.rbegin(); it != pBatch->m_arrURLs.rend(); it++)
+		m_pScheduler.Return(*it);
+	m_nBatchedCount -= pBatch->m_arrURLs.size();
+	pBatch->m_arrURLs.clear();
+}
+
+bool CConcurrentFrontier::Extract(std::string& lpszURL, ULONGLONG& nWait)
+{
+	lpszURL = "";
+	nWait = 0;
+	CFrontierBatch& pBatch = GetBatch();
+	if (pBatch.m_arrURLs.empty())
+	{
+		std::lock_guard<std::mutex> lock(m_mutexFrontier);
+		DrainIntake();
+		std::string strURL;
+		while ((pBatch.m_arrURLs.size() < m_nBatchSize) && m_pScheduler.Extract(strURL, nWait))
+		{
+			pBatch.m_arrURLs.push_back(std::move(strURL));
+			m_nBatchedCount++;
+		}
+		if (pBatch.m_arrURLs.empty())
+			return false;
+		nWait = 0;
+	}
+
+	lpszURL = std::move(pBatch.m_arrURLs.front());
+	pBatch.m_arrURLs.pop_front();
+	m_nBatchedCount--;
+	return true;
+}
+
+double CConcurrentFrontier::Release(const std::string& lpszURL, ULONGLONG nFetchTime, CPolitenessScheduler::Outcome nOutcome, ULONGLONG nRetryAfter)
+{
+	std::lock_guard<std::mutex> lock(m_mutexFrontier);
+	m_pScheduler.Release(lpszURL, nFetchTime, nOutcome, nRetryAfter);
+	return m_pFrontier.TakeCash(lpszURL);
+}
+
+void CConcurrentFrontier::Return(const std::string& lpszURL)
+{
+	std::lock_guard<std::mutex> lock(m_mutexFrontier);
+	m_pScheduler.Return(lpszURL);
+}
+
+void CConcurrentFrontier::SetHostDelay(const std::string& lpszHost, ULONGLONG nDelay)
+{
+	std::lock_guard<std::mutex> lock(m_mutexFrontier);
+	m_pScheduler.SetHostDelay(lpszHost, nDelay);
+}
+
+void CConcurrentFrontier::GetQueuedHosts(std::vector<std::string>& arrHosts)
+{
+	std::lock_guard<std::mutex> lock(m_mutexFrontier);
+	m_pScheduler.GetQueuedHosts(arrHosts);
+}
+
+bool CConcurrentFrontier::IsEmpty()
+{
+	std::lock_guard<std::mutex> lock(m_mutexFrontier);
+	DrainIntake();
+	return m_pScheduler.IsEmpty() && (m_nBatchedCount == 0);
+}
+
+bool CConcurrentFrontier::Save(std::ostream& pStream)
+{
+	std::lock_guard<std::mutex> lock(m_mutexFrontier);
+	for (auto pBatch : m_arrBatches)
+		ReturnBatch(pBatch);
+	DrainIntake();
+	return m_pFrontier.Save(pStream) && m_pScheduler.Save(pStream);
+}
+
+bool CConcurrentFrontier::Load(std::istream& pStream)
+{
+	std::lock_guard<std::mutex> lock(m_mutexFrontier);
+	return m_pFrontier.Load(pStream) && m_pScheduler.Load(pStream);
+}
+
+void CConcurrentFrontier::ExportMetrics(CCrawlerMetrics& pMetrics)
+{
+	std::lock_guard<std::mutex> lock(m_mutexFrontier);
+	m_pFrontier.ExportMetrics(pMetrics);
+	m_pScheduler.ExportMetrics(pMetrics);
+	pMetrics.SetGauge("frontier_intake_urls", static_cast<double>(m_nIntakeCount));
+	pMetrics.SetGauge("frontier_batched_urls", static_cast<double>(m_nBatchedCount));
+	pMetrics.SetGauge("frontier_intake_drains", static_cast<double>(m_nDrains));
+}
@@ -0,0 +1,157 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file ConcurrentFrontier.h
+ * @brief Declaration of the thread-safe front end of the URL frontier used by
+ *        the crawler worker threads.
+ */
+
+#pragma once
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <iostream>
+#include "PolitenessScheduler.h"
+
+class CUrlFrontier;
+class CCrawlerMetrics;
+class CConcurrentFrontier;
+
+/**
+ * @class CFrontierBatch
+ * @brief URLs handed to one consumer thread in a single trip to the shared frontier.
+ */
+class CFrontierBatch
+{
+public:
+	explicit CFrontierBatch(CConcurrentFrontier* pOwner);
+	~CFrontierBatch();
+
+protected:
+	CConcurrentFrontier* m_pOwner;
+	std::deque<std::string> m_arrURLs;
+
+	friend class CConcurrentFrontier;
+};
+
+/**
+ * @class CConcurrentFrontier
+ * @brief Lets many threads add and extract URLs while the frontier and the
+ *        politeness scheduler themselves stay single-threaded.
+ *
+ * Producers never wait: Add pushes the URL onto a lock-free intake stack with a
+ * single compare-and-swap. The intake is moved into the frontier in bulk by
+ * whichever thread holds the frontier lock next, and by a producer that finds
+ * the intake large and the lock free. Consumers take the lock once per batch of
+ * URLs rather than once per URL; each thread owns its batch.
+ */
+class CConcurrentFrontier
+{
+public:
+	CConcurrentFrontier(CUrlFrontier& pFrontier, CPolitenessScheduler& pScheduler);
+	~CConcurrentFrontier();
+
+public:
+	/**
+	 * @brief Queues a canonical URL with the cash its link carries. Lock-free; safe to call from any thread.
+	 */
+	void Add(std::string lpszURL, double rCash);
+
+	/**
+	 * @brief Hands out the next URL from the calling thread's batch, refilling the batch if needed.
+	 * @param[out] lpszURL The URL to fetch.
+	 * @param[out] nWait If nothing is ready, milliseconds until the next host is; otherwise 0.
+	 * @return true if a URL was handed out.
+	 */
+	bool Extract(std::string& lpszURL, ULONGLONG& nWait);
+
+	/**
+	 * @brief Reports the end of a fetch, and how it went, to the politeness scheduler.
+	 * @return The OPIC cash of the fetched page, to be split among its outlinks.
+	 */
+	double Release(const std::string& lpszURL, ULONGLONG nFetchTime,
+		CPolitenessScheduler::Outcome nOutcome = CPolitenessScheduler::Outcome::SKIPPED, ULONGLONG nRetryAfter = 0);
+
+	/**
+	 * @brief Gives back a handed-out URL that was not fetched; it is crawled next from its host.
+	 */
+	void Return(const std::string& lpszURL);
+
+	/**
+	 * @brief Passes a host's robots.txt crawl-delay to the politeness scheduler.
+	 */
+	void SetHostDelay(const std::string& lpszHost, ULONGLONG nDelay);
+
+	/**
+	 * @brief Checks whether no URL is queued, batched or being fetched.
+	 */
+	bool IsEmpty();
+
+	/**
+	 * @brief Sets how many URLs a consumer takes per trip to the shared frontier.
+	 */
+	void SetBatchSize(size_t nBatchSize) { m_nBatchSize = std::max<size_t>(1, nBatchSize); }
+
+	/**
+	 * @brief Returns every batch to the scheduler and writes the frontier and the
+	 *        scheduler to a checkpoint. No thread may be extracting or fetching meanwhile.
+	 */
+	bool Save(std::ostream& pStream);
+
+	/**
+	 * @brief Restores the frontier and the scheduler from a checkpoint.
+	 */
+	bool Load(std::istream& pStream);
+
+	/**
+	 * @brief Lists the hosts the scheduler will fetch from next.
+	 */
+	void GetQueuedHosts(std::vector<std::string>& arrHosts);
+
+	/**
+	 * @brief Publishes frontier, scheduler and intake statistics.
+	 */
+	void ExportMetrics(CCrawlerMetrics& pMetrics);
+
+protected:
+	/// Intake stack node; the stack is only ever detached as a whole.
+	struct CIntakeNode
+	{
+		std::string m_strURL;
+		double m_rCash = 0.0;
+		CIntakeNode* m_pNext = nullptr;
+	};
+
+	CFrontierBatch& GetBatch();
+	void Unregister(CFrontierBatch* pBatch);
+	void ReturnBatch(CFrontierBatch* pBatch);
+	void DrainIntake();
+
+protected:
+	CUrlFrontier& m_pFrontier;
+	CPolitenessScheduler& m_pScheduler;
+	std::atomic<CIntakeNode*> m_pIntake{ nullptr };
+	std::atomic<size_t> m_nIntakeCount{ 0 };     ///< URLs waiting in the intake stack
+	std::atomic<size_t> m_nBatchedCount{ 0 };    ///< URLs sitting in consumer batches
+	std::atomic<unsigned __int64> m_nDrains{ 0 };
+	std::mutex m_mutexFrontier;                  ///< Guards the frontier, the scheduler and the batch list
+	std::vector<CFrontierBatch*> m_arrBatches;
+	size_t m_nBatchSize = 8;
+
+	friend class CFrontierBatch;
+};
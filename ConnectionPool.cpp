@@ -0,0 +1,156 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file ConnectionPool.cpp
+ * @brief Implements the per-host pool of persistent WinHTTP connections.
+ */
+
+#include "stdafx.h"
+#include "ConnectionPool.h"
+#include "CrawlerMetrics.h"
+
+#define POOL_PURGE_INTERVAL 1000 // milliseconds between two scans for idle connections
+#define HANDSHAKE_SMOOTHING 0.2  // weight of the newest handshake in a host's average
+
+CConnectionPool::CConnectionPool()
+{
+}
+
+CConnectionPool::~CConnectionPool()
+{
+	Clear();
+}
+
+void CConnectionPool::Configure(HINTERNET hSession, unsigned int nConnectionsPerHost, ULONGLONG nIdleTimeout)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_hSession = hSession;
+	m_nIdleTimeout = nIdleTimeout;
+	if ((m_hSession != nullptr) && (nConnectionsPerHost > 0))
+	{
+		DWORD dwConnections = nConnectionsPerHost;
+		::WinHttpSetOption(m_hSession, WINHTTP_OPTION_MAX_CONNS_PER_SERVER, &dwConnections, sizeof(dwConnections));
+		::WinHttpSetOption(m_hSession, WINHTTP_OPTION_MAX_CONNS_PER_1_0_SERVER, &dwConnections, sizeof(dwConnections));
+	}
+}
+
+CConnectionPool::CConnection* CConnectionPool::Acquire(const std::wstring& lpszHost, INTERNET_PORT nPort)
+{
+	const ULONGLONG nNow = ::GetTickCount64();
+	std::wstring strKey(lpszHost);
+	strKey += L':';
+	strKey += std::to_wstring(nPort);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (nNow - m_nLastPurge >= POOL_PURGE_INTERVAL)
+		PurgeLocked(nNow);
+
+	auto it = m_mapConnections.find(strKey);
+	if (it == m_mapConnections.end())
+	{
+		if (m_hSession == nullptr)
+			return nullptr;
+		HINTERNET hConnect = ::WinHttpConnect(m_hSession, lpszHost.c_str(), nPort, 0);
+		if (hConnect == nullptr)
+			return nullptr;
+		auto pConnection = std::make_unique<CConnection>();
+		pConnection->m_strKey = strKey;
+		pConnection->m_hConnect = hConnect;
+		it = m_mapConnections.emplace(strKey, std::move(pConnection)).first;
+		m_nOpened++;
+	}
+	it->second->m_nUsers++;
+	return it->second.get();
+}
+
+void CConnectionPool::Release(CConnection* pConnection)
+{
+	if (pConnection == nullptr)
+		return;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	ASSERT(pConnection->m_nUsers > 0);
+	pConnection->m_nUsers--;
+	pConnection->m_nLastUsed = ::GetTickCount64();
+}
+
+void CConnectionPool::RecordHandshake(CConnection* pConnection, ULONGLONG nHandshakeTime)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const double rTime = static_cast<double>(nHandshakeTime);
+	pConnection->m_rHandshakeTime = (pConnection->m_nHandshakes == 0) ? rTime :
+		(1.0 - HANDSHAKE_SMOOTHING) * pConnection->m_rHandshakeTime + HANDSHAKE_SMOOTHING * rTime;
+	pConnection->m_nHandshakes++;
+	m_nHandshakes++;
+	m_rHandshakeTime += rTime;
+}
+
+void CConnectionPool::RecordReuse(CConnection* pConnection)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_nReused++;
+	// a socket opened before the host's connection handle was (re)created has no measured handshake
+	if (pConnection->m_nHandshakes > 0)
+		m_rHandshakeSaved += pConnection->m_rHandshakeTime;
+	else if (m_nHandshakes > 0)
+		m_rHandshakeSaved += m_rHandshakeTime / m_nHandshakes;
+}
+
+void CConnectionPool::Purge()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	PurgeLocked(::GetTickCount64());
+}
+
+void CConnectionPool::PurgeLocked(ULONGLONG nNow)
+{
+	m_nLastPurge = nNow;
+	for (auto it = m_mapConnections.begin(); it != m_mapConnections.end();)
+	{
+		if ((it->second->m_nUsers == 0) && (nNow - it->second->m_nLastUsed >= m_nIdleTimeout))
+		{
+			// closing the last handle of a server lets WinHTTP drop its idle sockets
+			::WinHttpCloseHandle(it->second->m_hConnect);
+			it = m_mapConnections.erase(it);
+			m_nClosed++;
+		}
+		else
+			it++;
+	}
+}
+
+void CConnectionPool::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto& it : m_mapConnections)
+	{
+		ASSERT(it.second->m_nUsers == 0);
+		::WinHttpCloseHandle(it.second->m_hConnect);
+	}
+	m_mapConnections.clear();
+}
+
+void CConnectionPool::ExportMetrics(CCrawlerMetrics& pMetrics) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const unsigned __int64 nRequests = m_nHandshakes + m_nReused;
+	pMetrics.SetGauge("connection_pool_hosts", static_cast<double>(m_mapConnections.size()));
+	pMetrics.SetGauge("connection_pool_opened", static_cast<double>(m_nOpened));
+	pMetrics.SetGauge("connection_pool_idle_closed", static_cast<double>(m_nClosed));
+	pMetrics.SetGauge("connection_handshakes", static_cast<double>(m_nHandshakes));
+	pMetrics.SetGauge("connection_reuses", static_cast<double>(m_nReused));
+	pMetrics.SetGauge("connection_reuse_ratio", (nRequests > 0) ? static_cast<double>(m_nReused) / nRequests : 0.0);
+	pMetrics.SetGauge("connection_handshake_ms_avg", (m_nHandshakes > 0) ? m_rHandshakeTime / m_nHandshakes : 0.0);
+	pMetrics.SetGauge("connection_handshake_ms_saved", m_rHandshakeSaved);
+}
@@ -0,0 +1,122 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file ConnectionPool.h
+ * @brief Declaration of the per-host pool of persistent WinHTTP connections.
+ */
+
+#pragma once
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <winhttp.h>
+
+class CCrawlerMetrics;
+
+/**
+ * @class CConnectionPool
+ * @brief Keeps one WinHTTP connection handle per host open between requests.
+ *
+ * WinHTTP keeps the sockets of a session alive and reuses them for later requests
+ * to the same server while the connection handle of that server stays open.
+ * The pool therefore hands out a shared connection handle per host and port
+ * instead of opening and closing one per request, and closes the handle of
+ * a host only after it has been idle longer than the idle timeout. At most
+ * the configured number of sockets per host is opened by the session.
+ *
+ * The pool also tells new connections from reused ones: a request that reaches
+ * the sending stage without connecting to the server rode on a kept-alive socket,
+ * and saved the host's average TCP and TLS handshake time.
+ */
+class CConnectionPool
+{
+public:
+	/// Connection handle of one host, shared by the requests to that host.
+	struct CConnection
+	{
+		std::wstring m_strKey;
+		HINTERNET m_hConnect = nullptr;
+		size_t m_nUsers = 0;                 ///< Requests currently using the handle
+		ULONGLONG m_nLastUsed = 0;           ///< Tick count when the last user released it
+		double m_rHandshakeTime = 0.0;       ///< Average handshake time of the host, in milliseconds
+		unsigned __int64 m_nHandshakes = 0;
+	};
+
+	CConnectionPool();
+	~CConnectionPool();
+
+public:
+	/**
+	 * @brief Sets the limits of the pool and of the session's sockets.
+	 * @param hSession The WinHTTP session the connections belong to.
+	 * @param nConnectionsPerHost Sockets the session may open to one server.
+	 * @param nIdleTimeout Milliseconds an unused host connection stays open.
+	 */
+	void Configure(HINTERNET hSession, unsigned int nConnectionsPerHost, ULONGLONG nIdleTimeout);
+
+	/**
+	 * @brief Takes the shared connection of a host and port, opening it if needed.
+	 * @return The connection, or nullptr if WinHTTP could not open it. Give it back with Release.
+	 */
+	CConnection* Acquire(const std::wstring& lpszHost, INTERNET_PORT nPort);
+
+	/**
+	 * @brief Gives back a connection taken with Acquire.
+	 */
+	void Release(CConnection* pConnection);
+
+	/**
+	 * @brief Records that a request had to connect, and how long the handshakes took.
+	 */
+	void RecordHandshake(CConnection* pConnection, ULONGLONG nHandshakeTime);
+
+	/**
+	 * @brief Records that a request was sent on a kept-alive socket.
+	 */
+	void RecordReuse(CConnection* pConnection);
+
+	/**
+	 * @brief Closes the connections idle for longer than the idle timeout.
+	 */
+	void Purge();
+
+	/**
+	 * @brief Closes every connection; none may be in use.
+	 */
+	void Clear();
+
+	/**
+	 * @brief Publishes pool size, reuse ratio and saved handshake time.
+	 */
+	void ExportMetrics(CCrawlerMetrics& pMetrics) const;
+
+protected:
+	void PurgeLocked(ULONGLONG nNow);
+
+protected:
+	HINTERNET m_hSession = nullptr;
+	ULONGLONG m_nIdleTimeout = 30000;
+	ULONGLONG m_nLastPurge = 0;
+	mutable std::mutex m_mutex;
+	std::unordered_map<std::wstring, std::unique_ptr<CConnection>> m_mapConnections;
+	unsigned __int64 m_nOpened = 0;          ///< Connection handles opened
+	unsigned __int64 m_nClosed = 0;          ///< Connection handles closed after being idle
+	unsigned __int64 m_nHandshakes = 0;      ///< Requests that opened a socket
+	unsigned __int64 m_nReused = 0;          ///< Requests sent on a kept-alive socket
+	double m_rHandshakeTime = 0.0;           ///< Total handshake time, in milliseconds
+	double m_rHandshakeSaved = 0.0;          ///< Estimated handshake time saved by reuse, in milliseconds
+};
@@ -0,0 +1,245 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file CrawlCheckpoint.cpp
+ * @brief Implements writing and memory-mapped reading of crawl checkpoints.
+ *
+ * File layout: an 8-byte magic and a uint32 version, the sections, then an
+ * 8-byte end marker. Sections are read back in the order they were written.
+ */
+
+#include "stdafx.h"
+#include "CrawlCheckpoint.h"
+
+static const char CHECKPOINT_MAGIC[8] = { 'W', 'S', 'E', 'C', 'K', 'P', 'T', '1' };
+static const char CHECKPOINT_END[8] = { 'W', 'S', 'E', 'E', 'N', 'D', '0', '1' };
+static const unsigned int CHECKPOINT_VERSION = 6;
+static const size_t CHECKPOINT_HEADER = sizeof(CHECKPOINT_MAGIC) + sizeof(CHECKPOINT_VERSION);
+static const size_t CHECKPOINT_BUFFER = 0x100000; // bytes collected before each WriteFile
+
+CFileStreamBuffer::CFileStreamBuffer()
+{
+}
+
+CFileStreamBuffer::~CFileStreamBuffer()
+{
+	Close();
+}
+
+bool CFileStreamBuffer::Open(const std::string& lpszPath)
+{
+	Close();
+	m_hFile = ::CreateFileA(lpszPath.c_str(), GENERIC_WRITE, 0, nullptr,
+		CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_hFile == INVALID_HANDLE_VALUE)
+		return false;
+	m_arrBuffer.resize(CHECKPOINT_BUFFER);
+	setp(m_arrBuffer.data(), m_arrBuffer.data() + m_arrBuffer.size());
+	return true;
+}
+
+bool CFileStreamBuffer::WriteBuffer()
+{
+	const char* pData = pbase();
+	size_t nLength = static_cast<size_t>(pptr() - pbase());
+	setp(m_arrBuffer.data(), m_arrBuffer.data() + m_arrBuffer.size());
+	while (nLength > 0)
+	{
+		DWORD dwWritten = 0;
+		if (!::WriteFile(m_hFile, pData, static_cast<DWORD>(std::min<size_t>(nLength, CHECKPOINT_BUFFER)), &dwWritten, nullptr) ||
+			(dwWritten == 0))
+			return false;
+		pData += dwWritten;
+		nLength -= dwWritten;
+	}
+	return true;
+}
+
+CFileStreamBuffer::int_type CFileStreamBuffer::overflow(int_type nChar)
+{
+	if (!IsOpen() || !WriteBuffer())
+		return traits_type::eof();
+	if (!traits_type::eq_int_type(nChar, traits_type::eof()))
+	{
+		*pptr() = traits_type::to_char_type(nChar);
+		pbump(1);
+	}
+	return traits_type::not_eof(nChar);
+}
+
+std::streamsize CFileStreamBuffer::xsputn(const char* pData, std::streamsize nCount)
+{
+	// bulk sections, such as the visited filter, bypass the buffer
+	if (!IsOpen())
+		return 0;
+	if (nCount <= epptr() - pptr())
+	{
+		memcpy(pptr(), pData, static_cast<size_t>(nCount));
+		pbump(static_cast<int>(nCount));
+		return nCount;
+	}
+	if (!WriteBuffer())
+		return 0;
+	std::streamsize nWritten = 0;
+	while (nWritten < nCount)
+	{
+		DWORD dwWritten = 0;
+		const DWORD dwLength = static_cast<DWORD>(std::min<std::streamsize>(nCount - nWritten, CHECKPOINT_BUFFER));
+		if (!::WriteFile(m_hFile, pData + nWritten, dwLength, &dwWritten, nullptr) || (dwWritten == 0))
+			break;
+		nWritten += dwWritten;
+	}
+	return nWritten;
+}
+
+int CFileStreamBuffer::sync()
+{
+	return (IsOpen() && WriteBuffer()) ? 0 : -1;
+}
+
+bool CFileStreamBuffer::Flush()
+{
+	return (sync() == 0) && ::FlushFileBuffers(m_hFile);
+}
+
+void CFileStreamBuffer::Close()
+{
+	if (m_hFile != INVALID_HANDLE_VALUE)
+	{
+		::CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+	setp(nullptr, nullptr);
+	m_arrBuffer.clear();
+	m_arrBuffer.shrink_to_fit();
+}
+
+CCrawlCheckpoint::CCrawlCheckpoint()
+{
+}
+
+CCrawlCheckpoint::~CCrawlCheckpoint()
+{
+	Close();
+}
+
+bool CCrawlCheckpoint::Create(const std::string& lpszPath)
+{
+	Close();
+	m_strPath = lpszPath;
+	m_strTempPath = lpszPath + ".tmp";
+	m_pOutput.clear();
+	if (!m_pOutputBuffer.Open(m_strTempPath))
+		return false;
+	m_pOutput.write(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+	WriteCheckpointValue(m_pOutput, CHECKPOINT_VERSION);
+	return m_pOutput.good();
+}
+
+bool CCrawlCheckpoint::Commit()
+{
+	if (!m_pOutputBuffer.IsOpen())
+		return false;
+	m_pOutput.write(CHECKPOINT_END, sizeof(CHECKPOINT_END));
+	// the data must be on the disk before the rename is, or a crash may leave a renamed empty file
+	const bool bWritten = m_pOutput.good() && m_pOutputBuffer.Flush();
+	m_pOutputBuffer.Close();
+	if (!bWritten || !::MoveFileExA(m_strTempPath.c_str(), m_strPath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+	{
+		::DeleteFileA(m_strTempPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool CCrawlCheckpoint::Open(const std::string& lpszPath)
+{
+	Close();
+	m_strPath = lpszPath;
+
+	m_hFile = ::CreateFileA(lpszPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER nFileSize = { 0, };
+	if (!::GetFileSizeEx(m_hFile, &nFileSize) ||
+		(nFileSize.QuadPart < static_cast<LONGLONG>(CHECKPOINT_HEADER + sizeof(CHECKPOINT_END))))
+	{
+		Close();
+		return false;
+	}
+	m_nSize = static_cast<size_t>(nFileSize.QuadPart);
+
+	m_hMapping = ::CreateFileMapping(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_hMapping == nullptr)
+	{
+		Close();
+		return false;
+	}
+	m_pView = static_cast<const char*>(::MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+	if (m_pView == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	unsigned int nVersion = 0;
+	memcpy(&nVersion, m_pView + sizeof(CHECKPOINT_MAGIC), sizeof(nVersion));
+	if ((memcmp(m_pView, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0) || (nVersion != CHECKPOINT_VERSION) ||
+		(memcmp(m_pView + m_nSize - sizeof(CHECKPOINT_END), CHECKPOINT_END, sizeof(CHECKPOINT_END)) != 0))
+	{
+		Close();
+		return false;
+	}
+
+	// the stream never writes, so the const view can back a read-only span
+	m_pInput = std::make_unique<std::ispanstream>(std::span<char>(const_cast<char*>(m_pView) + CHECKPOINT_HEADER,
+		m_nSize - CHECKPOINT_HEADER - sizeof(CHECKPOINT_END)));
+	return true;
+}
+
+bool CCrawlCheckpoint::IsInputComplete()
+{
+	if ((m_pInput == nullptr) || !m_pInput->good())
+		return false;
+	return (static_cast<size_t>(m_pInput->tellg()) == m_nSize - CHECKPOINT_HEADER - sizeof(CHECKPOINT_END));
+}
+
+void CCrawlCheckpoint::Close()
+{
+	if (m_pOutputBuffer.IsOpen())
+	{
+		m_pOutputBuffer.Close();
+		::DeleteFileA(m_strTempPath.c_str());
+	}
+	m_pInput.reset();
+	if (m_pView != nullptr)
+	{
+		::UnmapViewOfFile(m_pView);
+		m_pView = nullptr;
+	}
+	if (m_hMapping != nullptr)
+	{
+		::CloseHandle(m_hMapping);
+		m_hMapping = nullptr;
+	}
+	if (m_hFile != INVALID_HANDLE_VALUE)
+	{
+		::CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+	m_nSize = 0;
+}
@@ -0,0 +1,186 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file CrawlCheckpoint.h
+ * @brief Declaration of the binary crawl checkpoint file and its stream helpers.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <streambuf>
+#include <ostream>
+#include <spanstream>
+#include <memory>
+#include <algorithm>
+
+/**
+ * @brief Writes a trivially copyable value in native byte order.
+ */
+template <class T>
+inline void WriteCheckpointValue(std::ostream& pStream, const T& pValue)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "checkpoint values must be trivially copyable");
+	pStream.write(reinterpret_cast<const char*>(&pValue), sizeof(T));
+}
+
+/**
+ * @brief Reads a value written by WriteCheckpointValue.
+ */
+template <class T>
+inline bool ReadCheckpointValue(std::istream& pStream, T& pValue)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "checkpoint values must be trivially copyable");
+	pStream.read(reinterpret_cast<char*>(&pValue), sizeof(T));
+	return pStream.good();
+}
+
+/**
+ * @brief Checks that a count read from a checkpoint fits in the bytes left in the stream,
+ *        so a damaged count is rejected before anything is allocated for it.
+ * @param nElementSize Bytes stored per counted element.
+ */
+inline bool IsCheckpointCountValid(std::istream& pStream, unsigned __int64 nCount, size_t nElementSize)
+{
+	const std::streampos nPosition = pStream.tellg();
+	if (!pStream.good() || (nPosition < 0))
+		return false;
+	pStream.seekg(0, std::ios::end);
+	const std::streampos nEnd = pStream.tellg();
+	pStream.seekg(nPosition);
+	if (!pStream.good() || (nEnd < nPosition))
+		return false;
+	return nCount <= static_cast<unsigned __int64>(nEnd - nPosition) / std::max<size_t>(nElementSize, 1);
+}
+
+/**
+ * @brief Writes a length-prefixed string.
+ */
+inline void WriteCheckpointString(std::ostream& pStream, const std::string& lpszText)
+{
+	WriteCheckpointValue(pStream, static_cast<unsigned int>(lpszText.length()));
+	pStream.write(lpszText.data(), lpszText.length());
+}
+
+/**
+ * @brief Reads a string written by WriteCheckpointString.
+ */
+inline bool ReadCheckpointString(std::istream& pStream, std::string& lpszText)
+{
+	unsigned int nLength = 0;
+	if (!ReadCheckpointValue(pStream, nLength) || !IsCheckpointCountValid(pStream, nLength, sizeof(char)))
+		return false;
+	lpszText.resize(nLength);
+	pStream.read(lpszText.data(), nLength);
+	return pStream.good();
+}
+
+/**
+ * @class CFileStreamBuffer
+ * @brief Output stream buffer that writes a new file through a Win32 handle,
+ *        so the data can be flushed to the disk before the file is renamed.
+ */
+class CFileStreamBuffer : public std::streambuf
+{
+public:
+	CFileStreamBuffer();
+	~CFileStreamBuffer();
+
+public:
+	/**
+	 * @brief Creates the file, replacing an existing one.
+	 */
+	bool Open(const std::string& lpszPath);
+
+	/**
+	 * @brief Writes the buffered data and waits until the file is on the disk.
+	 */
+	bool Flush();
+
+	void Close();
+	bool IsOpen() const { return (m_hFile != INVALID_HANDLE_VALUE); }
+
+protected:
+	int_type overflow(int_type nChar) override;
+	std::streamsize xsputn(const char* pData, std::streamsize nCount) override;
+	int sync() override;
+	bool WriteBuffer();
+
+protected:
+	HANDLE m_hFile = INVALID_HANDLE_VALUE;
+	std::vector<char> m_arrBuffer;
+};
+
+/**
+ * @class CCrawlCheckpoint
+ * @brief One checkpoint file: a header, the sections written by the crawler
+ *        components, and an end marker.
+ *
+ * A new checkpoint is written to a temporary file that replaces the previous
+ * checkpoint only once it is complete and flushed to the disk, so a crash while
+ * saving keeps the old one.
+ * Reading maps the file into memory and serves the sections from the mapped view,
+ * so bulk sections such as the visited filter are copied straight from the page cache.
+ */
+class CCrawlCheckpoint
+{
+public:
+	CCrawlCheckpoint();
+	~CCrawlCheckpoint();
+
+public:
+	/**
+	 * @brief Starts writing a new checkpoint next to lpszPath.
+	 * @return true if the temporary file was created.
+	 */
+	bool Create(const std::string& lpszPath);
+
+	/**
+	 * @brief Finishes the checkpoint started by Create and moves it over the previous one.
+	 * @return true if the checkpoint is on disk.
+	 */
+	bool Commit();
+
+	/**
+	 * @brief Maps an existing checkpoint and checks its header and end marker.
+	 * @return true if the checkpoint can be read.
+	 */
+	bool Open(const std::string& lpszPath);
+
+	/**
+	 * @brief Discards an unfinished checkpoint or unmaps an opened one.
+	 */
+	void Close();
+
+	std::ostream& GetOutput() { return m_pOutput; }
+	std::istream& GetInput() { return *m_pInput; }
+
+	/**
+	 * @brief Checks that the input has been read up to the end marker exactly.
+	 */
+	bool IsInputComplete();
+
+protected:
+	std::string m_strPath;
+	std::string m_strTempPath;
+	CFileStreamBuffer m_pOutputBuffer;
+	std::ostream m_pOutput{ &m_pOutputBuffer };
+	HANDLE m_hFile = INVALID_HANDLE_VALUE;
+	HANDLE m_hMapping = nullptr;
+	const char* m_pView = nullptr;
+	size_t m_nSize = 0;
+	std::unique_ptr<std::ispanstream> m_pInput;
+};
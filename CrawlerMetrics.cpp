@@ -0,0 +1,96 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file CrawlerMetrics.cpp
+ * @brief Implements the registry of named crawler counters, gauges and histograms.
+ */
+
+#include "stdafx.h"
+#include "CrawlerMetrics.h"
+
+CCrawlerMetrics gCrawlerMetrics;
+
+CCrawlerMetrics::CCrawlerMetrics()
+{
+}
+
+CCrawlerMetrics::~CCrawlerMetrics()
+{
+}
+
+void CCrawlerMetrics::SetGauge(const std::string& lpszName, double rValue)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_mapGauges[lpszName] = rValue;
+}
+
+void CCrawlerMetrics::RemoveGauges(const std::string& lpszPrefix)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_mapGauges.lower_bound(lpszPrefix);
+	while ((it != m_mapGauges.end()) && it->first.starts_with(lpszPrefix))
+		it = m_mapGauges.erase(it);
+}
+
+void CCrawlerMetrics::AddCounter(const std::string& lpszName, __int64 nDelta)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_mapCounters[lpszName].fetch_add(nDelta, std::memory_order_relaxed);
+}
+
+CCrawlerCounter CCrawlerMetrics::GetCounter(const std::string& lpszName)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return CCrawlerCounter(m_mapCounters[lpszName]);
+}
+
+void CCrawlerMetrics::AddSample(const std::string& lpszName, double rValue)
+{
+	size_t nBucket = 0;
+	while ((nBucket < METRICS_HISTOGRAM_BUCKETS) && (rValue > static_cast<double>(1ULL << nBucket)))
+		nBucket++;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	CHistogram& pHistogram = m_mapHistograms[lpszName];
+	pHistogram.m_arrBuckets[nBucket]++;
+	pHistogram.m_nCount++;
+	pHistogram.m_rSum += rValue;
+}
+
+std::string CCrawlerMetrics::Format() const
+{
+	std::ostringstream pOutput;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (const auto& it : m_mapCounters)
+		pOutput << it.first << " " << it.second.load(std::memory_order_relaxed) << "\n";
+	for (const auto& it : m_mapGauges)
+		pOutput << it.first << " " << std::setprecision(6) << it.second << "\n";
+	for (const auto& it : m_mapHistograms)
+	{
+		__int64 nCumulative = 0;
+		for (size_t nBucket = 0; nBucket <= METRICS_HISTOGRAM_BUCKETS; nBucket++)
+		{
+			nCumulative += it.second.m_arrBuckets[nBucket];
+			pOutput << it.first << "_le_";
+			if (nBucket < METRICS_HISTOGRAM_BUCKETS)
+				pOutput << (1ULL << nBucket);
+			else
+				pOutput << "inf";
+			pOutput << " " << nCumulative << "\n";
+		}
+		pOutput << it.first << "_count " << it.second.m_nCount << "\n";
+		pOutput << it.first << "_sum " << std::setprecision(6) << it.second.m_rSum << "\n";
+	}
+	return pOutput.str();
+}
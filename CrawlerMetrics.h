@@ -0,0 +1,107 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file CrawlerMetrics.h
+ * @brief Declaration of the registry of named crawler counters, gauges and histograms.
+ */
+
+#pragma once
+
+#include <map>
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <string>
+
+#define METRICS_HISTOGRAM_BUCKETS 16 // upper bounds 1, 2, 4, ... 16384, then everything larger
+
+/**
+ * @class CCrawlerCounter
+ * @brief Handle to a registered counter for hot paths: adding is a relaxed atomic
+ *        increment, with no lock and no name lookup.
+ */
+class CCrawlerCounter
+{
+public:
+	CCrawlerCounter() {}
+	explicit CCrawlerCounter(std::atomic<__int64>& pValue) : m_pValue(&pValue) {}
+
+public:
+	void Add(__int64 nDelta = 1) const { m_pValue->fetch_add(nDelta, std::memory_order_relaxed); }
+
+protected:
+	std::atomic<__int64>* m_pValue = nullptr;
+};
+
+/**
+ * @class CCrawlerMetrics
+ * @brief Thread-safe collection of named counters, gauges and histograms, formatted as
+ *        "name value" lines for the debug output.
+ */
+class CCrawlerMetrics
+{
+public:
+	CCrawlerMetrics();
+	~CCrawlerMetrics();
+
+public:
+	/**
+	 * @brief Sets a gauge to an absolute value.
+	 */
+	void SetGauge(const std::string& lpszName, double rValue);
+
+	/**
+	 * @brief Removes every gauge whose name starts with a prefix, such as per-host gauges of hosts no longer tracked.
+	 */
+	void RemoveGauges(const std::string& lpszPrefix);
+
+	/**
+	 * @brief Adds a delta to a monotonic counter.
+	 */
+	void AddCounter(const std::string& lpszName, __int64 nDelta = 1);
+
+	/**
+	 * @brief Registers a counter and returns a handle to it, valid as long as the registry.
+	 *        Meant to be kept in a static by code that counts once per URL or link.
+	 */
+	CCrawlerCounter GetCounter(const std::string& lpszName);
+
+	/**
+	 * @brief Records one sample in a histogram with power-of-two buckets.
+	 */
+	void AddSample(const std::string& lpszName, double rValue);
+
+	/**
+	 * @brief Formats all metrics, one "name value" pair per line: counters, then gauges, then
+	 *        histograms as cumulative "name_le_<bound>" buckets with "name_count" and "name_sum".
+	 */
+	std::string Format() const;
+
+protected:
+	struct CHistogram
+	{
+		std::array<__int64, METRICS_HISTOGRAM_BUCKETS + 1> m_arrBuckets{};
+		__int64 m_nCount = 0;
+		double m_rSum = 0.0;
+	};
+
+protected:
+	mutable std::mutex m_mutex;
+	std::map<std::string, double> m_mapGauges;
+	std::map<std::string, std::atomic<__int64>> m_mapCounters; ///< Nodes never move: handles point into them
+	std::map<std::string, CHistogram> m_mapHistograms;
+};
+
+extern CCrawlerMetrics gCrawlerMetrics; ///< Metrics shared by every crawler component
@@ -0,0 +1,267 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file DnsResolver.cpp
+ * @brief Implements the asynchronous host name resolver.
+ */
+
+#include "stdafx.h"
+#include "DnsResolver.h"
+#include "CrawlerMetrics.h"
+#include <ws2tcpip.h>
+
+#pragma comment(lib, "dnsapi")
+#pragma comment(lib, "ws2_32")
+
+#define DNS_MAX_QUERIES 256          // queries in flight at once
+#define DNS_MAX_PREFETCHES 128       // of which prefetches, so lookups always find a free slot
+#define DNS_MAX_ENTRIES 262144       // cached host names
+#define DNS_MIN_TTL 5000             // floor on record TTLs, in milliseconds
+#define DNS_MAX_TTL (24 * 3600 * 1000ULL)
+#define DNS_ERROR_TTL 30000          // how long a timeout or server failure is remembered
+
+CDnsResolver::CDnsResolver()
+{
+}
+
+CDnsResolver::~CDnsResolver()
+{
+	// no waiting here: during static destruction the callbacks may never come,
+	// so the crawler calls Cancel when it stops
+	CancelQueries();
+}
+
+bool CDnsResolver::Configure(unsigned int nNegativeTTL, const std::string& lpszServer)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_nNegativeTTL = static_cast<ULONGLONG>(nNegativeTTL) * 1000;
+	m_arrServer.clear();
+	if (lpszServer.empty())
+		return true;
+
+	const size_t nColon = lpszServer.find(':');
+	const std::string strAddress = lpszServer.substr(0, nColon);
+	const int nPort = (nColon == std::string::npos) ? 53 : atoi(lpszServer.c_str() + nColon + 1);
+	SOCKADDR_IN pAddress = { 0, };
+	pAddress.sin_family = AF_INET;
+	pAddress.sin_port = htons(static_cast<u_short>(nPort));
+	if ((nPort <= 0) || (nPort > 0xFFFF) || (inet_pton(AF_INET, strAddress.c_str(), &pAddress.sin_addr) != 1))
+		return false;
+
+	m_arrServer.resize(sizeof(DNS_ADDR_ARRAY), 0);
+	PDNS_ADDR_ARRAY pServers = reinterpret_cast<PDNS_ADDR_ARRAY>(m_arrServer.data());
+	pServers->MaxCount = 1;
+	pServers->AddrCount = 1;
+	pServers->Family = AF_INET;
+	memcpy(pServers->AddrArray[0].MaxSa, &pAddress, sizeof(pAddress));
+	return true;
+}
+
+std::string CDnsResolver::GetName(const std::string& lpszHost)
+{
+	// GetHost keeps the port, and brackets IPv6 literals
+	if (!lpszHost.empty() && (lpszHost[0] == '['))
+		return lpszHost.substr(0, lpszHost.find(']') + 1);
+	return lpszHost.substr(0, lpszHost.find(':'));
+}
+
+bool CDnsResolver::IsAddress(const std::string& lpszName)
+{
+	if (!lpszName.empty() && (lpszName[0] == '['))
+		return true;
+	return lpszName.find_first_not_of("0123456789.") == std::string::npos;
+}
+
+CDnsResolver::Status CDnsResolver::Lookup(const std::string& lpszHost, bool bCount)
+{
+	const std::string strName = GetName(lpszHost);
+	if (strName.empty() || IsAddress(strName))
+		return Status::RESOLVED;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_bCancelled)
+		return Status::RESOLVED;
+	auto it = m_mapCache.find(strName);
+	if ((it != m_mapCache.end()) && (it->second.m_nExpires > ::GetTickCount64()))
+	{
+		if (bCount)
+			gCrawlerMetrics.AddCounter((it->second.m_nStatus == Status::NOT_FOUND) ? "dns_negative_hits" : "dns_cache_hits");
+		return it->second.m_nStatus;
+	}
+	if (m_mapQueries.find(strName) != m_mapQueries.end())
+	{
+		if (bCount)
+			gCrawlerMetrics.AddCounter("dns_prefetch_waits"); // prefetched, but not answered yet
+		return Status::PENDING;
+	}
+
+	if (bCount)
+		gCrawlerMetrics.AddCounter("dns_cache_misses");
+	if (!StartLocked(strName))
+	{
+		// answered synchronously, or no query could be started
+		it = m_mapCache.find(strName);
+		if (it != m_mapCache.end())
+			return it->second.m_nStatus;
+	}
+	return Status::PENDING;
+}
+
+void CDnsResolver::Prefetch(const std::string& lpszHost)
+{
+	const std::string strName = GetName(lpszHost);
+	if (strName.empty() || IsAddress(strName))
+		return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_bCancelled || (m_mapQueries.size() >= DNS_MAX_PREFETCHES) || (m_mapQueries.find(strName) != m_mapQueries.end()))
+		return;
+	auto it = m_mapCache.find(strName);
+	if ((it != m_mapCache.end()) && (it->second.m_nExpires > ::GetTickCount64()))
+		return;
+	gCrawlerMetrics.AddCounter("dns_prefetches");
+	StartLocked(strName);
+}
+
+bool CDnsResolver::StartLocked(const std::string& lpszName)
+{
+	if (m_mapQueries.size() >= DNS_MAX_QUERIES)
+		return false; // polled again later
+
+	auto pQuery = std::make_unique<CQuery>();
+	pQuery->m_pOwner = this;
+	pQuery->m_strHost = lpszName;
+	pQuery->m_strName.assign(lpszName.begin(), lpszName.end());
+	pQuery->m_nStart = ::GetTickCount64();
+	memset(&pQuery->m_pResult, 0, sizeof(pQuery->m_pResult));
+	memset(&pQuery->m_pCancel, 0, sizeof(pQuery->m_pCancel));
+	pQuery->m_pResult.Version = DNS_QUERY_REQUEST_VERSION1;
+
+	DNS_QUERY_REQUEST pRequest = { 0, };
+	pRequest.Version = DNS_QUERY_REQUEST_VERSION1;
+	pRequest.QueryName = pQuery->m_strName.c_str();
+	pRequest.QueryType = DNS_TYPE_A;
+	pRequest.QueryOptions = DNS_QUERY_STANDARD;
+	pRequest.pDnsServerList = m_arrServer.empty() ? nullptr : reinterpret_cast<PDNS_ADDR_ARRAY>(m_arrServer.data());
+	pRequest.pQueryCompletionCallback = QueryCallback;
+	pRequest.pQueryContext = pQuery.get();
+
+	// registered first: the callback may run on another thread before DnsQueryEx returns
+	CQuery* pStarted = pQuery.get();
+	m_mapQueries.emplace(lpszName, std::move(pQuery));
+	gCrawlerMetrics.AddCounter("dns_queries");
+	const DNS_STATUS nStatus = ::DnsQueryEx(&pRequest, &pStarted->m_pResult, &pStarted->m_pCancel);
+	if (nStatus == DNS_REQUEST_PENDING)
+		return true;
+	// completed synchronously, or failed to start; the callback will not be called
+	pStarted->m_pResult.QueryStatus = nStatus;
+	CompleteLocked(pStarted);
+	return false;
+}
+
+VOID WINAPI CDnsResolver::QueryCallback(PVOID pContext, PDNS_QUERY_RESULT /*pResult*/)
+{
+	CQuery* pQuery = static_cast<CQuery*>(pContext);
+	CDnsResolver* pOwner = pQuery->m_pOwner;
+	{
+		std::lock_guard<std::mutex> lock(pOwner->m_mutex);
+		pOwner->CompleteLocked(pQuery);
+	}
+	pOwner->m_eventDone.notify_all();
+}
+
+void CDnsResolver::CompleteLocked(CQuery* pQuery)
+{
+	const DNS_STATUS nStatus = pQuery->m_pResult.QueryStatus;
+	const ULONGLONG nNow = ::GetTickCount64();
+	if (nStatus != ERROR_CANCELLED)
+		gCrawlerMetrics.AddSample("dns_resolve_ms", static_cast<double>(nNow - pQuery->m_nStart));
+
+	if ((nStatus == ERROR_SUCCESS) && (pQuery->m_pResult.pQueryRecords != nullptr))
+	{
+		// the answer, including any CNAME chain, is valid for its shortest TTL
+		DWORD dwTTL = MAXDWORD;
+		for (PDNS_RECORD pRecord = pQuery->m_pResult.pQueryRecords; pRecord != nullptr; pRecord = pRecord->pNext)
+			dwTTL = std::min(dwTTL, pRecord->dwTtl);
+		StoreLocked(pQuery->m_strHost, Status::RESOLVED,
+			std::min(std::max(static_cast<ULONGLONG>(dwTTL) * 1000, static_cast<ULONGLONG>(DNS_MIN_TTL)), DNS_MAX_TTL));
+		gCrawlerMetrics.AddCounter("dns_resolved");
+	}
+	else if (nStatus == DNS_ERROR_RCODE_NAME_ERROR)
+	{
+		StoreLocked(pQuery->m_strHost, Status::NOT_FOUND, m_nNegativeTTL);
+		gCrawlerMetrics.AddCounter("dns_not_found");
+	}
+	else if (nStatus != ERROR_CANCELLED)
+	{
+		// no address record, timeout or server failure: let the fetch try on its own
+		StoreLocked(pQuery->m_strHost, Status::RESOLVED, DNS_ERROR_TTL);
+		gCrawlerMetrics.AddCounter("dns_errors");
+	}
+	if (pQuery->m_pResult.pQueryRecords != nullptr)
+		::DnsRecordListFree(pQuery->m_pResult.pQueryRecords, DnsFreeRecordList);
+	m_mapQueries.erase(pQuery->m_strHost);
+}
+
+void CDnsResolver::StoreLocked(const std::string& lpszName, Status nStatus, ULONGLONG nTTL)
+{
+	const ULONGLONG nNow = ::GetTickCount64();
+	if ((m_mapCache.size() >= DNS_MAX_ENTRIES) && (m_mapCache.find(lpszName) == m_mapCache.end()))
+	{
+		for (auto it = m_mapCache.begin(); it != m_mapCache.end();)
+		{
+			if (it->second.m_nExpires <= nNow)
+				it = m_mapCache.erase(it);
+			else
+				it++;
+		}
+		// still full of live answers: drop an arbitrary eighth, they are merely resolved again
+		for (auto it = m_mapCache.begin(); (it != m_mapCache.end()) && (m_mapCache.size() > DNS_MAX_ENTRIES - DNS_MAX_ENTRIES / 8);)
+			it = m_mapCache.erase(it);
+	}
+	CEntry& pEntry = m_mapCache[lpszName];
+	pEntry.m_nStatus = nStatus;
+	pEntry.m_nExpires = nNow + nTTL;
+}
+
+void CDnsResolver::Cancel()
+{
+	CancelQueries();
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_eventDone.wait(lock, [this] { return m_mapQueries.empty(); });
+	m_bCancelled = false; // the next crawl resolves hosts again
+}
+
+void CDnsResolver::CancelQueries()
+{
+	std::vector<DNS_QUERY_CANCEL> arrCancel;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bCancelled = true;
+		for (const auto& it : m_mapQueries)
+			arrCancel.push_back(it.second->m_pCancel);
+	}
+	// outside the lock: a cancelled query may complete on this thread
+	for (auto& pCancel : arrCancel)
+		::DnsCancelQuery(&pCancel);
+}
+
+void CDnsResolver::ExportMetrics(CCrawlerMetrics& pMetrics) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	pMetrics.SetGauge("dns_cache_entries", static_cast<double>(m_mapCache.size()));
+	pMetrics.SetGauge("dns_queries_in_flight", static_cast<double>(m_mapQueries.size()));
+}
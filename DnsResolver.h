@@ -0,0 +1,121 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file DnsResolver.h
+ * @brief Declaration of the asynchronous host name resolver with its TTL cache.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <windns.h>
+
+class CCrawlerMetrics;
+
+/**
+ * @class CDnsResolver
+ * @brief Resolves crawl hosts ahead of their fetches with DnsQueryEx and caches the answers.
+ *
+ * A lookup never blocks: it answers from the cache or starts an asynchronous
+ * query and reports the host as pending until the query completes. Answers are
+ * cached for the TTL of their records; hosts that do not exist are cached for the
+ * negative TTL, so their URLs are dropped without occupying a fetch slot.
+ * Timeouts and server failures are cached briefly as resolved, letting the
+ * fetch try the system resolver itself. Resolving through the system resolver
+ * also warms the cache WinHTTP resolves from; a configured server is queried
+ * directly instead. Safe to use from any thread.
+ */
+class CDnsResolver
+{
+public:
+	enum class Status
+	{
+		PENDING,
+		RESOLVED,
+		NOT_FOUND
+	};
+
+	CDnsResolver();
+	~CDnsResolver();
+
+public:
+	/**
+	 * @brief Sets the negative TTL and the DNS server.
+	 * @param nNegativeTTL Seconds a nonexistent host stays cached.
+	 * @param lpszServer IPv4 address of the DNS server, with an optional ":port"; empty for the system resolver.
+	 * @return false if the server address cannot be parsed; the system resolver is used then.
+	 */
+	bool Configure(unsigned int nNegativeTTL, const std::string& lpszServer);
+
+	/**
+	 * @brief Looks up a host, starting its resolution if it is not cached.
+	 * @param lpszHost Host name, optionally followed by ":port".
+	 * @param bCount false for the repeated polls of a host already reported as pending.
+	 */
+	Status Lookup(const std::string& lpszHost, bool bCount = true);
+
+	/**
+	 * @brief Starts resolving a host that will be fetched soon, unless it is cached or being resolved.
+	 */
+	void Prefetch(const std::string& lpszHost);
+
+	/**
+	 * @brief Cancels the queries in flight and waits for them to end.
+	 *        Must be called before the resolver is destroyed, which does not wait.
+	 */
+	void Cancel();
+
+	void ExportMetrics(CCrawlerMetrics& pMetrics) const;
+
+protected:
+	struct CEntry
+	{
+		Status m_nStatus = Status::PENDING;
+		ULONGLONG m_nExpires = 0;      ///< Tick count when the answer goes stale
+	};
+
+	/// One query in flight; the result structure must outlive the asynchronous call.
+	struct CQuery
+	{
+		CDnsResolver* m_pOwner = nullptr;
+		std::string m_strHost;
+		std::wstring m_strName;
+		ULONGLONG m_nStart = 0;
+		DNS_QUERY_RESULT m_pResult;
+		DNS_QUERY_CANCEL m_pCancel;
+	};
+
+	static std::string GetName(const std::string& lpszHost);
+	static bool IsAddress(const std::string& lpszName);
+	static VOID WINAPI QueryCallback(PVOID pContext, PDNS_QUERY_RESULT pResult);
+	void CancelQueries();
+	bool StartLocked(const std::string& lpszName);
+	void CompleteLocked(CQuery* pQuery);
+	void StoreLocked(const std::string& lpszName, Status nStatus, ULONGLONG nTTL);
+
+protected:
+	mutable std::mutex m_mutex;
+	std::condition_variable m_eventDone;
+	std::unordered_map<std::string, CEntry> m_mapCache;                  ///< Keyed by lowercase host name
+	std::unordered_map<std::string, std::unique_ptr<CQuery>> m_mapQueries; ///< Queries in flight
+	std::vector<unsigned char> m_arrServer;                             ///< DNS_ADDR_ARRAY of the configured server, empty for the system resolver
+	ULONGLONG m_nNegativeTTL = 300000;
+	bool m_bCancelled = false;
+};
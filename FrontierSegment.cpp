@@ -0,0 +1,167 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file FrontierSegment.cpp
+ * @brief Implements writing and memory-mapped reading of frontier segment files.
+ *
+ * File layout: an 8-byte magic and a uint64 record count, then records of
+ * { double cash, uint64 sequence, uint32 length, length bytes of URL }.
+ */
+
+#include "stdafx.h"
+#include "FrontierSegment.h"
+
+static const char SEGMENT_MAGIC[8] = { 'W', 'S', 'E', 'S', 'E', 'G', '0', '2' };
+static const size_t SEGMENT_HEADER = sizeof(SEGMENT_MAGIC) + sizeof(unsigned __int64);
+static const size_t RECORD_HEADER = sizeof(double) + sizeof(unsigned __int64) + sizeof(unsigned int);
+
+CFrontierSegmentWriter::CFrontierSegmentWriter()
+{
+}
+
+CFrontierSegmentWriter::~CFrontierSegmentWriter()
+{
+	if (m_pFile.is_open())
+		m_pFile.close();
+}
+
+bool CFrontierSegmentWriter::Open(const std::string& lpszPath)
+{
+	m_nCount = 0;
+	m_pFile.open(lpszPath, std::ios::binary | std::ios::trunc);
+	if (!m_pFile.is_open())
+		return false;
+	m_pFile.write(SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+	m_pFile.write(reinterpret_cast<const char*>(&m_nCount), sizeof(m_nCount)); // patched by Close
+	return m_pFile.good();
+}
+
+bool CFrontierSegmentWriter::Append(const CFrontierEntry& pEntry)
+{
+	const unsigned int nLength = static_cast<unsigned int>(pEntry.m_strURL.length());
+	m_pFile.write(reinterpret_cast<const char*>(&pEntry.m_rCash), sizeof(pEntry.m_rCash));
+	m_pFile.write(reinterpret_cast<const char*>(&pEntry.m_nSequence), sizeof(pEntry.m_nSequence));
+	m_pFile.write(reinterpret_cast<const char*>(&nLength), sizeof(nLength));
+	m_pFile.write(pEntry.m_strURL.data(), nLength);
+	m_nCount++;
+	return m_pFile.good();
+}
+
+bool CFrontierSegmentWriter::Close()
+{
+	m_pFile.seekp(sizeof(SEGMENT_MAGIC), std::ios::beg);
+	m_pFile.write(reinterpret_cast<const char*>(&m_nCount), sizeof(m_nCount));
+	m_pFile.flush();
+	const bool bResult = m_pFile.good();
+	m_pFile.close();
+	return bResult;
+}
+
+CFrontierSegment::CFrontierSegment()
+{
+}
+
+CFrontierSegment::~CFrontierSegment()
+{
+	Close(false);
+}
+
+bool CFrontierSegment::Open(const std::string& lpszPath, unsigned __int64 nOffset, unsigned __int64 nRemaining)
+{
+	Close(false);
+	m_strPath = lpszPath;
+
+	m_hFile = ::CreateFileA(lpszPath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER nFileSize = { 0, };
+	if (!::GetFileSizeEx(m_hFile, &nFileSize) || (nFileSize.QuadPart < static_cast<LONGLONG>(SEGMENT_HEADER)))
+	{
+		Close(false);
+		return false;
+	}
+	m_nSize = static_cast<unsigned __int64>(nFileSize.QuadPart);
+
+	m_hMapping = ::CreateFileMapping(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_hMapping == nullptr)
+	{
+		Close(false);
+		return false;
+	}
+	m_pView = static_cast<const BYTE*>(::MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+	if ((m_pView == nullptr) || (memcmp(m_pView, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) != 0))
+	{
+		Close(false);
+		return false;
+	}
+
+	if (nOffset >= SEGMENT_HEADER)
+	{
+		m_nOffset = nOffset;
+		m_nRemaining = nRemaining;
+	}
+	else
+	{
+		m_nOffset = SEGMENT_HEADER;
+		memcpy(&m_nRemaining, m_pView + sizeof(SEGMENT_MAGIC), sizeof(m_nRemaining));
+	}
+	m_bCurrent = Decode();
+	return true;
+}
+
+void CFrontierSegment::Close(bool bDelete)
+{
+	if (m_pView != nullptr)
+	{
+		::UnmapViewOfFile(m_pView);
+		m_pView = nullptr;
+	}
+	if (m_hMapping != nullptr)
+	{
+		::CloseHandle(m_hMapping);
+		m_hMapping = nullptr;
+	}
+	if (m_hFile != INVALID_HANDLE_VALUE)
+	{
+		::CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+	if (bDelete && !m_strPath.empty())
+		::DeleteFileA(m_strPath.c_str());
+	m_bCurrent = false;
+	m_nSize = 0;
+	m_nRemaining = 0;
+}
+
+bool CFrontierSegment::Decode()
+{
+	if ((m_pView == nullptr) || (m_nOffset + RECORD_HEADER > m_nSize))
+		return false;
+
+	unsigned int nLength = 0;
+	const BYTE* pRecord = m_pView + m_nOffset;
+	memcpy(&m_pCurrent.m_rCash, pRecord, sizeof(double));
+	memcpy(&m_pCurrent.m_nSequence, pRecord + sizeof(double), sizeof(unsigned __int64));
+	memcpy(&nLength, pRecord + sizeof(double) + sizeof(unsigned __int64), sizeof(unsigned int));
+	if (m_nOffset + RECORD_HEADER + nLength > m_nSize)
+		return false; // truncated record
+
+	m_pCurrent.m_strURL.assign(reinterpret_cast<const char*>(pRecord + RECORD_HEADER), nLength);
+	m_nCurrentOffset = m_nOffset;
+	m_nOffset += RECORD_HEADER + nLength;
+	return true;
+}
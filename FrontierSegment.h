@@ -0,0 +1,129 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file FrontierSegment.h
+ * @brief Declarations for the sorted, append-only segment files that hold
+ *        the part of the URL frontier spilled out of memory.
+ */
+
+#pragma once
+
+#include <string>
+#include <fstream>
+
+/**
+ * @struct CFrontierEntry
+ * @brief One queued URL together with its OPIC cash and discovery order.
+ */
+struct CFrontierEntry
+{
+	std::string m_strURL;
+	double m_rCash = 0.0;
+	unsigned __int64 m_nSequence = 0;
+};
+
+/**
+ * @brief Frontier ordering: more cash first, then earlier discovery first.
+ *        Works for any entry type with m_rCash and m_nSequence members.
+ */
+template <class TFirst, class TSecond>
+inline bool IsHigherPriority(const TFirst& pFirst, const TSecond& pSecond)
+{
+	if (pFirst.m_rCash != pSecond.m_rCash)
+		return (pFirst.m_rCash > pSecond.m_rCash);
+	return (pFirst.m_nSequence < pSecond.m_nSequence);
+}
+
+/**
+ * @class CFrontierSegmentWriter
+ * @brief Writes entries, already sorted by priority, to a new segment file.
+ */
+class CFrontierSegmentWriter
+{
+public:
+	CFrontierSegmentWriter();
+	~CFrontierSegmentWriter();
+
+public:
+	bool Open(const std::string& lpszPath);
+	bool Append(const CFrontierEntry& pEntry);
+	bool Close();
+
+	unsigned __int64 GetCount() const { return m_nCount; }
+
+protected:
+	std::ofstream m_pFile;
+	unsigned __int64 m_nCount = 0;
+};
+
+/**
+ * @class CFrontierSegment
+ * @brief Memory-mapped, read-once cursor over a segment file.
+ *
+ * Records are decoded straight from the mapped view; the operating system pages
+ * the file in as the cursor advances, so an open segment costs address space
+ * rather than heap memory.
+ */
+class CFrontierSegment
+{
+public:
+	CFrontierSegment();
+	~CFrontierSegment();
+
+public:
+	/**
+	 * @brief Maps a segment file and positions the cursor.
+	 * @param lpszPath Path of the segment file.
+	 * @param nOffset Byte offset of the next record, or 0 to start after the header.
+	 * @param nRemaining Records left from nOffset on; ignored when starting after the header.
+	 * @return true if the file was mapped and has a valid header.
+	 */
+	bool Open(const std::string& lpszPath, unsigned __int64 nOffset = 0, unsigned __int64 nRemaining = 0);
+
+	/**
+	 * @brief Unmaps the file, optionally deleting it.
+	 */
+	void Close(bool bDelete);
+
+	bool IsExhausted() const { return !m_bCurrent; }
+	const CFrontierEntry& Peek() const { return m_pCurrent; }
+	void Next()
+	{
+		if (m_bCurrent && (m_nRemaining > 0))
+			m_nRemaining--;
+		m_bCurrent = Decode();
+	}
+
+	const std::string& GetPath() const { return m_strPath; }
+	/// Offset of the record returned by Peek, suitable for reopening the segment later.
+	unsigned __int64 GetOffset() const { return m_nCurrentOffset; }
+	/// Records not consumed yet, including the one returned by Peek.
+	unsigned __int64 GetRemaining() const { return m_nRemaining; }
+
+protected:
+	bool Decode();
+
+protected:
+	std::string m_strPath;
+	HANDLE m_hFile = INVALID_HANDLE_VALUE;
+	HANDLE m_hMapping = nullptr;
+	const BYTE* m_pView = nullptr;
+	unsigned __int64 m_nSize = 0;
+	unsigned __int64 m_nOffset = 0;
+	unsigned __int64 m_nCurrentOffset = 0;
+	unsigned __int64 m_nRemaining = 0;
+	CFrontierEntry m_pCurrent;
+	bool m_bCurrent = false;
+};
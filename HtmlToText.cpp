@@ -15,57 +15,260 @@ WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
 #include "stdafx.h"
 #include "HtmlToText.h"
 #include <algorithm>
+#include <bit>
+#if defined(_M_IX86) || defined(_M_X64)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+#define HTML_MAX_NESTING 64      // nested elements counted while their content is skipped
+#define HTML_PARSE_BUDGET 250    // milliseconds one page may take before it is cut short
+#define HTML_BUDGET_CHECK 1024   // tags parsed between two checks of the clock
+
+/// Copies a run of text up to the first '<' (or length) to out, with tabs, CRs and LFs turned into
+/// spaces, and returns the number of characters copied. out must have room for length characters.
+typedef size_t (*CopyTextRunProc)(const char* text, size_t length, char* out);
+
+static size_t CopyTextRunScalar(const char* text, size_t length, char* out)
+{
+	for (size_t i = 0; i < length; i++)
+	{
+		const char ch = text[i];
+		if (ch == '<')
+			return i;
+		out[i] = ((ch == '\t') || (ch == '\r') || (ch == '\n')) ? ' ' : ch;
+	}
+	return length;
+}
+
+#if defined(_M_IX86) || defined(_M_X64)
+static size_t CopyTextRunSSE2(const char* text, size_t length, char* out)
+{
+	const __m128i lt = _mm_set1_epi8('<');
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i tab = _mm_set1_epi8('\t');
+	const __m128i cr = _mm_set1_epi8('\r');
+	const __m128i lf = _mm_set1_epi8('\n');
+	size_t i = 0;
+	for (; i + 16 <= length; i += 16)
+	{
+		// the whole chunk is stored; bytes after a '<' are cut off by the caller
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+		const __m128i white = _mm_or_si128(_mm_cmpeq_epi8(chunk, tab), _mm_or_si128(_mm_cmpeq_epi8(chunk, cr), _mm_cmpeq_epi8(chunk, lf)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_or_si128(_mm_andnot_si128(white, chunk), _mm_and_si128(white, space)));
+		const unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, lt)));
+		if (mask != 0)
+			return i + std::countr_zero(mask);
+	}
+	return i + CopyTextRunScalar(text + i, length - i, out + i);
+}
+
+static size_t CopyTextRunAVX2(const char* text, size_t length, char* out)
+{
+	const __m256i lt = _mm256_set1_epi8('<');
+	const __m256i space = _mm256_set1_epi8(' ');
+	const __m256i tab = _mm256_set1_epi8('\t');
+	const __m256i cr = _mm256_set1_epi8('\r');
+	const __m256i lf = _mm256_set1_epi8('\n');
+	size_t i = 0;
+	for (; i + 32 <= length; i += 32)
+	{
+		const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+		const __m256i white = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, tab), _mm256_or_si256(_mm256_cmpeq_epi8(chunk, cr), _mm256_cmpeq_epi8(chunk, lf)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_blendv_epi8(chunk, space, white));
+		const unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, lt)));
+		if (mask != 0)
+			return i + std::countr_zero(mask);
+	}
+	return i + CopyTextRunSSE2(text + i, length - i, out + i);
+}
+
+static bool IsAVX2Supported()
+{
+	int info[4] = { 0 };
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+	// AVX2 needs the OS to save the YMM registers (OSXSAVE, AVX, XCR0 bits 1 and 2)
+	__cpuid(info, 1);
+	if (((info[2] & (1 << 27)) == 0) || ((info[2] & (1 << 28)) == 0) || ((_xgetbv(0) & 6) != 6))
+		return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+}
+
+static const CopyTextRunProc CopyTextRun = IsAVX2Supported() ? CopyTextRunAVX2 : CopyTextRunSSE2;
+#else
+static const CopyTextRunProc CopyTextRun = CopyTextRunScalar;
+#endif
 
 CHtmlToText::CHtmlToText()
 {
-	_tags.SetAt(_T("address"), _T("\n"));
-	_tags.SetAt(_T("blockquote"), _T("\n"));
-	_tags.SetAt(_T("div"), _T("\n"));
-	_tags.SetAt(_T("dl"), _T("\n"));
-	_tags.SetAt(_T("fieldset"), _T("\n"));
-	_tags.SetAt(_T("form"), _T("\n"));
-	_tags.SetAt(_T("h1"), _T("\n"));
-	_tags.SetAt(_T("/h1"), _T("\n"));
-	_tags.SetAt(_T("h2"), _T("\n"));
-	_tags.SetAt(_T("/h2"), _T("\n"));
-	_tags.SetAt(_T("h3"), _T("\n"));
-	_tags.SetAt(_T("/h3"), _T("\n"));
-	_tags.SetAt(_T("h4"), _T("\n"));
-	_tags.SetAt(_T("/h4"), _T("\n"));
-	_tags.SetAt(_T("h5"), _T("\n"));
-	_tags.SetAt(_T("/h5"), _T("\n"));
-	_tags.SetAt(_T("h6"), _T("\n"));
-	_tags.SetAt(_T("/h6"), _T("\n"));
-	_tags.SetAt(_T("p"), _T("\n"));
-	_tags.SetAt(_T("/p"), _T("\n"));
-	_tags.SetAt(_T("table"), _T("\n"));
-	_tags.SetAt(_T("/table"), _T("\n"));
-	_tags.SetAt(_T("ul"), _T("\n"));
-	_tags.SetAt(_T("/ul"), _T("\n"));
-	_tags.SetAt(_T("ol"), _T("\n"));
-	_tags.SetAt(_T("/ol"), _T("\n"));
-	_tags.SetAt(_T("/li"), _T("\n"));
-	_tags.SetAt(_T("br"), _T("\n"));
-	_tags.SetAt(_T("/td"), _T("\t"));
-	_tags.SetAt(_T("/tr"), _T("\n"));
-	_tags.SetAt(_T("/pre"), _T("\n"));
-
-	_ignoreTags.AddTail(_T("script"));
-	_ignoreTags.AddTail(_T("noscript"));
-	_ignoreTags.AddTail(_T("style"));
-	_ignoreTags.AddTail(_T("object"));
 }
 
 CHtmlToText::~CHtmlToText()
 {
 }
 
-const std::string& CHtmlToText::Convert(const std::string& html)
+/// Classification of a tag name, as lowercase bytes with an optional leading '/'.
+struct CTagInfo
+{
+	std::string_view name;
+	CHtmlToText::TagKind kind = CHtmlToText::TagKind::OTHER;
+	char separator = ' ';   ///< Written to the text in place of the tag
+};
+
+static constexpr CTagInfo gTagList[] = {
+	{ "address", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "blockquote", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "div", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "dl", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "fieldset", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "form", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "h1", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "/h1", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "h2", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "/h2", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "h3", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "/h3", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "h4", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "/h4", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "h5", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "/h5", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "h6", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "/h6", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "p", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "/p", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "table", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "/table", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "ul", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "/ul", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "ol", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "/ol", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "/li", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "br", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "/td", CHtmlToText::TagKind::OTHER, '\t' },
+	{ "/tr", CHtmlToText::TagKind::OTHER, '\n' },
+	{ "pre", CHtmlToText::TagKind::PRE, ' ' },
+	{ "/pre", CHtmlToText::TagKind::END_PRE, '\n' },
+	{ "body", CHtmlToText::TagKind::BODY, ' ' },
+	{ "/body", CHtmlToText::TagKind::END_BODY, ' ' },
+	{ "script", CHtmlToText::TagKind::RAW_TEXT, ' ' },
+	{ "noscript", CHtmlToText::TagKind::IGNORED, ' ' },
+	{ "style", CHtmlToText::TagKind::RAW_TEXT, ' ' },
+	{ "object", CHtmlToText::TagKind::IGNORED, ' ' },
+	{ "a", CHtmlToText::TagKind::A, ' ' },
+	{ "/a", CHtmlToText::TagKind::END_A, ' ' },
+	{ "title", CHtmlToText::TagKind::TITLE, ' ' },
+	{ "/title", CHtmlToText::TagKind::END_TITLE, ' ' },
+	{ "meta", CHtmlToText::TagKind::META, ' ' },
+};
+
+#define TAG_TABLE_SIZE 128   // power of two, about three times the number of tags
+
+/// FNV-1a, with a seed chosen at compile time so that no two known tags share a slot.
+static constexpr unsigned int HashTag(std::string_view name, unsigned int seed)
+{
+	unsigned int hash = 2166136261u ^ seed;
+	for (const char ch : name)
+	{
+		hash ^= static_cast<unsigned char>(ch);
+		hash *= 16777619u;
+	}
+	return hash & (TAG_TABLE_SIZE - 1);
+}
+
+static constexpr unsigned int FindTagSeed()
 {
-	// Initialize state variables
+	for (unsigned int seed = 0; ; seed++)
+	{
+		bool used[TAG_TABLE_SIZE] = {};
+		bool collision = false;
+		for (const CTagInfo& info : gTagList)
+		{
+			const unsigned int slot = HashTag(info.name, seed);
+			collision = collision || used[slot];
+			used[slot] = true;
+		}
+		if (!collision)
+			return seed;
+	}
+}
+
+struct CTagTable
+{
+	CTagInfo slots[TAG_TABLE_SIZE];
+};
+
+static constexpr unsigned int gTagSeed = FindTagSeed();
+
+static constexpr CTagTable BuildTagTable()
+{
+	CTagTable table{};
+	for (const CTagInfo& info : gTagList)
+		table.slots[HashTag(info.name, gTagSeed)] = info;
+	return table;
+}
+
+static constexpr CTagTable gTagTable = BuildTagTable();
+static constexpr CTagInfo gUnknownTag;
+
+/// Looks up a lowercase tag name; unknown tags are OTHER and separated by a space.
+static const CTagInfo& LookupTag(std::string_view name)
+{
+	const CTagInfo& info = gTagTable.slots[HashTag(name, gTagSeed)];
+	return (info.name == name) ? info : gUnknownTag;
+}
+
+static bool IsTagName(std::string_view name, std::string_view lowercase)
+{
+	return (name.length() == lowercase.length()) &&
+		std::equal(name.begin(), name.end(), lowercase.begin(),
+			[](char ch, char lower) { return tolower(static_cast<unsigned char>(ch)) == lower; });
+}
+
+static std::string_view TrimView(std::string_view text)
+{
+	const size_t first = text.find_first_not_of(" \t\r\n");
+	if (first == std::string_view::npos)
+		return std::string_view();
+	return text.substr(first, text.find_last_not_of(" \t\r\n") - first + 1);
+}
+
+void CHtmlToText::Reset()
+{
+	_text.clear();
+	_html = std::string_view();
+	_pos = 0;
+	_preformatted = false;
+	_visitor = nullptr;
+	_attributes.clear();
+	_linkHref = std::string_view();
+	_linkStart = _titleStart = std::string::npos;
+	_titleSeen = false;
+	_tagCount = 0;
+	_deadline = 0;
+	_overBudget = false;
+}
+
+bool CHtmlToText::IsOverBudget()
+{
+	if (!_overBudget && ((++_tagCount % HTML_BUDGET_CHECK) == 0) && (::GetTickCount64() > _deadline))
+		_overBudget = true;
+	return _overBudget;
+}
+
+void CHtmlToText::Convert(std::string_view html, std::string& text, CHtmlVisitor* visitor)
+{
+	// Initialize state variables; the caller's buffer is written in place and keeps its capacity
 	bool selfClosing = false;
+	Reset();
+	_text.swap(text);
+	_text.clear();
 	_html = html;
-	_pos = 0;
+	_visitor = visitor;
+	_text.reserve(_html.length());
+	_deadline = ::GetTickCount64() + HTML_PARSE_BUDGET;
 
 	// Process input
 	while (!EndOfText())
@@ -73,58 +276,129 @@ const std::string& CHtmlToText::Convert(const std::string& html)
 		if (Peek() == '<')
 		{
 			// HTML tag
-			std::string tag = ParseTag(selfClosing);
+			if (IsOverBudget())
+				break;
+			const size_t tagStart = _pos;
+			const CTagInfo& info = LookupTag(ParseTag(selfClosing));
+			if (_visitor != nullptr)
+				VisitTag(info.kind, tagStart);
 
 			// Handle special tag cases
-			if (tag.compare("body") == 0)
+			if (info.kind == TagKind::BODY)
 			{
 				// Discard content before <body>
 				VERIFY(_text.empty());
 			}
-			else if (tag.compare("/body") == 0)
+			else if (info.kind == TagKind::END_BODY)
 			{
 				// Discard content after </body>
 				_pos = _html.length();
 			}
-			else if (tag.compare("pre") == 0)
+			else if (info.kind == TagKind::PRE)
 			{
 				// Enter preformatted mode
 				_preformatted = true;
 				EatWhitespaceToNextLine();
 			}
-			else if (tag.compare("/pre") == 0)
+			else if (info.kind == TagKind::END_PRE)
 			{
 				// Exit preformatted mode
 				_preformatted = false;
 			}
 
-			_text.append(" ");
+			_text += info.separator;
 
-			if (_ignoreTags.Find(CString(tag.c_str())) != NULL)
-				EatInnerContent(tag);
+			if (info.kind == TagKind::RAW_TEXT)
+				EatRawText(info.name);
+			else if ((info.kind == TagKind::IGNORED) && !selfClosing)
+				EatInnerContent(info.name);
 		}
-		else if (IsWhiteSpace(Peek()))
+		else if (_preformatted)
 		{
-			// Whitespace (treat all as space)
-			_text += (_preformatted ? Peek() : ' ');
-			MoveAhead();
+			// Preformatted text, whitespace kept as is, copied up to the next tag at once
+			const size_t end = std::min(_html.find('<', _pos), _html.length());
+			_text.append(_html, _pos, end - _pos);
+			_pos = end;
 		}
 		else
 		{
-			// Other text
-			_text += Peek();
-			MoveAhead();
+			// Other text up to the next tag, whitespace turned into spaces in the same pass
+			const size_t length = _html.length() - _pos;
+			size_t copied = 0;
+			_text.resize_and_overwrite(_text.length() + length, [this, length, &copied](char* out, size_t size) {
+				copied = CopyTextRun(_html.data() + _pos, length, out + size - length);
+				return size - length + copied;
+				});
+			_pos += copied;
+		}
+	}
+	if (_visitor != nullptr)
+		EndLink();
+	_text.swap(text);
+	// the page may be gone after the call, but the caller may still ask whether it was cut short
+	const bool overBudget = _overBudget;
+	Reset();
+	_overBudget = overBudget;
+}
+
+void CHtmlToText::VisitTag(TagKind kind, size_t tagStart)
+{
+	if ((kind == TagKind::A) || (kind == TagKind::END_A))
+	{
+		// links do not nest: a new <a> closes the open one
+		EndLink();
+		if (kind == TagKind::A)
+		{
+			_linkHref = TrimView(GetAttribute("href"));
+			if (!_linkHref.empty())
+				_linkStart = _text.length();
 		}
 	}
+	else if ((kind == TagKind::TITLE) && !_titleSeen)
+	{
+		_titleStart = _pos;
+		_titleSeen = true;
+	}
+	else if ((kind == TagKind::END_TITLE) && (_titleStart != std::string::npos))
+	{
+		_visitor->OnTitle(TrimView(_html.substr(_titleStart, tagStart - _titleStart)));
+		_titleStart = std::string::npos;
+	}
+	else if (kind == TagKind::META)
+	{
+		std::string_view name = GetAttribute("name");
+		if (name.empty())
+			name = GetAttribute("property");
+		if (name.empty())
+			name = GetAttribute("http-equiv");
+		if (!name.empty())
+			_visitor->OnMeta(name, GetAttribute("content"));
+	}
+}
 
-	return _text;
+void CHtmlToText::EndLink()
+{
+	if (_linkStart == std::string::npos)
+		return;
+	_visitor->OnLink(_linkHref, TrimView(std::string_view(_text).substr(_linkStart)));
+	_linkStart = std::string::npos;
+}
+
+std::string_view CHtmlToText::GetAttribute(std::string_view name) const
+{
+	for (const auto& attribute : _attributes)
+	{
+		if (IsTagName(attribute.first, name))
+			return attribute.second;
+	}
+	return std::string_view();
 }
 
 char toclower(char ch) { return (char)tolower(ch); }
 
-std::string CHtmlToText::ParseTag(bool& selfClosing)
+std::string_view CHtmlToText::ParseTag(bool& selfClosing)
 {
-	std::string tag;
+	_tag.clear();
 	selfClosing = false;
 
 	// Eat comments
@@ -156,51 +430,6 @@ std::string CHtmlToText::ParseTag(bool& selfClosing)
 		EatWhitespace();
 	}
 
-	// Eat scripts
-	if (((_pos + 7) < _html.length()) &&
-		(_html[_pos] == '<') &&
-		(_html[_pos + 1] == 's') &&
-		(_html[_pos + 2] == 'c') &&
-		(_html[_pos + 3] == 'r') &&
-		(_html[_pos + 4] == 'i') &&
-		(_html[_pos + 5] == 'p') &&
-		(_html[_pos + 6] == 't'))
-	{
-		MoveAhead();
-		MoveAhead();
-		MoveAhead();
-		MoveAhead();
-		MoveAhead();
-		MoveAhead();
-		MoveAhead();
-
-
-		while (!EndOfText())
-		{
-			if (((_pos + 7) < _html.length()) &&
-				(_html[_pos] == '/') &&
-				(_html[_pos + 1] == 's') &&
-				(_html[_pos + 2] == 'c') &&
-				(_html[_pos + 3] == 'r') &&
-				(_html[_pos + 4] == 'i') &&
-				(_html[_pos + 5] == 'p') &&
-				(_html[_pos + 6] == 't'))
-				break;
-
-			MoveAhead();
-		}
-
-		MoveAhead();
-		MoveAhead();
-		MoveAhead();
-		MoveAhead();
-		MoveAhead();
-		MoveAhead();
-		MoveAhead();
-		MoveAhead();
-		EatWhitespace();
-	}
-
 	if (Peek() == _T('<'))
 	{
 		MoveAhead();
@@ -213,44 +442,110 @@ std::string CHtmlToText::ParseTag(bool& selfClosing)
 		while (!EndOfText() && !IsWhiteSpace(Peek()) &&
 			(Peek() != '/') && (Peek() != '>'))
 			MoveAhead();
-		tag = _html.substr(start, _pos - start);
-		std::transform(tag.begin(), tag.end(), tag.begin(), toclower);
+		_tag.assign(_html.substr(start, _pos - start));
+		std::transform(_tag.begin(), _tag.end(), _tag.begin(), toclower);
 
-		// Parse rest of tag
+		// Parse attributes: name, name=value, name="value" or name='value'
+		_attributes.clear();
 		while (!EndOfText() && (Peek() != '>'))
 		{
-			if ((Peek() == '\"') || (Peek() == '\''))
+			if (IsWhiteSpace(Peek()))
+				MoveAhead();
+			else if ((Peek() == '\"') || (Peek() == '\''))
 				EatQuotedValue();
-			else
+			else if (Peek() == '/')
 			{
-				if (Peek() == '/')
-					selfClosing = true;
+				selfClosing = true;
 				MoveAhead();
 			}
+			else
+			{
+				start = _pos;
+				while (!EndOfText() && !IsWhiteSpace(Peek()) &&
+					(Peek() != '/') && (Peek() != '>') && (Peek() != '='))
+					MoveAhead();
+				if (_pos == start)
+				{
+					// stray '='
+					MoveAhead();
+					continue;
+				}
+				const std::string_view name = _html.substr(start, _pos - start);
+				std::string_view value;
+				EatWhitespace();
+				if (Peek() == '=')
+				{
+					MoveAhead();
+					EatWhitespace();
+					const char mark = Peek();
+					if ((mark == '\"') || (mark == '\''))
+					{
+						start = _pos + 1;
+						EatQuotedValue();
+						const size_t end = ((_pos > start) && (_html[_pos - 1] == mark)) ? _pos - 1 : _pos;
+						value = _html.substr(start, end - start);
+					}
+					else
+					{
+						start = _pos;
+						while (!EndOfText() && !IsWhiteSpace(Peek()) && (Peek() != '>'))
+							MoveAhead();
+						value = _html.substr(start, _pos - start);
+					}
+				}
+				_attributes.emplace_back(name, value);
+			}
 		}
 
 		MoveAhead();
 	}
-	return tag;
+	return _tag;
+}
+
+void CHtmlToText::EatRawText(std::string_view tag)
+{
+	// the content of script and style is not markup: it ends at the first "</tag"
+	// followed by whitespace, '/' or '>', whatever comes before it
+	while (!EndOfText())
+	{
+		const size_t found = _html.find("</", _pos);
+		if (found == std::string_view::npos)
+			break;
+		const size_t end = found + 2 + tag.length();
+		if ((end <= _html.length()) && IsTagName(_html.substr(found + 2, tag.length()), tag) &&
+			((end == _html.length()) || IsWhiteSpace(_html[end]) || (_html[end] == '/') || (_html[end] == '>')))
+		{
+			// consume the end tag itself
+			bool selfClosing = false;
+			_pos = found;
+			ParseTag(selfClosing);
+			return;
+		}
+		_pos = found + 2;
+	}
+	_pos = _html.length();
 }
 
-void CHtmlToText::EatInnerContent(const std::string& tag)
+void CHtmlToText::EatInnerContent(std::string_view tag)
 {
+	// skips to the end tag matching the opening one, counting nested elements of the same name
 	bool selfClosing = false;
-	const std::string endTag = "/" + tag;
+	size_t depth = 1;
 
-	while (!EndOfText())
+	while (!EndOfText() && !IsOverBudget())
 	{
-		if (Peek() == '<')
+		const size_t found = _html.find('<', _pos);
+		if (found == std::string_view::npos)
+			break;
+		_pos = found;
+		const std::string_view parsed = ParseTag(selfClosing);
+		if (parsed.starts_with('/') && (parsed.substr(1) == tag))
 		{
-			// Consume a tag
-			if (ParseTag(selfClosing).compare(endTag) == 0)
+			if (--depth == 0)
 				return;
-			// Use recursion to consume nested tags
-			if (!selfClosing && (tag[0] != '/'))
-				EatInnerContent(tag);
 		}
-		else
-			MoveAhead();
+		else if ((parsed == tag) && !selfClosing && (depth < HTML_MAX_NESTING))
+			depth++;
 	}
+	_pos = _html.length();
 }
@@ -14,16 +14,78 @@ WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
 
 #pragma once
 
+#include <string_view>
+#include <vector>
+#include <utility>
+
+/**
+ * @class CHtmlVisitor
+ * @brief Receives the structure CHtmlToText finds while it converts a page.
+ *
+ * Values are views into the page being converted, valid only during the call,
+ * with entities not yet decoded.
+ */
+class CHtmlVisitor
+{
+public:
+	virtual ~CHtmlVisitor() {}
+
+	/// The content of the first <title> element.
+	virtual void OnTitle(std::string_view title) { (void)title; }
+	/// An <a> element with an href attribute, and the text it encloses.
+	virtual void OnLink(std::string_view href, std::string_view anchorText) { (void)href; (void)anchorText; }
+	/// A <meta> element; name is its name, property or http-equiv attribute.
+	virtual void OnMeta(std::string_view name, std::string_view content) { (void)name; (void)content; }
+};
+
 class CHtmlToText
 {
 public:
+	/// What a tag means to the converter.
+	enum class TagKind : unsigned char
+	{
+		OTHER,
+		BODY,
+		END_BODY,
+		PRE,
+		END_PRE,
+		RAW_TEXT,    ///< Its content is not markup and is skipped: script, style
+		IGNORED,     ///< Its content is skipped: noscript, object
+		A,
+		END_A,
+		TITLE,
+		END_TITLE,
+		META
+	};
+
 	CHtmlToText();
 	~CHtmlToText();
 
 public:
-	const std::string& Convert(const std::string& html);
-	std::string ParseTag(bool& selfClosing);
-	void EatInnerContent(const std::string& tag);
+	/**
+	 * @brief Converts a page to plain text in one pass, reporting its title, links and meta tags to a visitor.
+	 * @param html The page, read in place; it must outlive the call.
+	 * @param text Receives the text. Its previous content is replaced and its capacity reused,
+	 *        so converting page after page into the same buffer does not allocate.
+	 * @param visitor Receives the page's structure; may be nullptr.
+	 */
+	void Convert(std::string_view html, std::string& text, CHtmlVisitor* visitor = nullptr);
+
+	/// Forgets the last page, keeping the buffers for the next one.
+	void Reset();
+
+	/// Parses the tag at the current position; the lowercase name stays valid until the next call.
+	std::string_view ParseTag(bool& selfClosing);
+	/// Skips the content of a raw text element and its end tag.
+	void EatRawText(std::string_view tag);
+	/// Skips the content of an element and its end tag, without recursion.
+	void EatInnerContent(std::string_view tag);
+
+	/// Whether the last page hit the parse time budget and was converted only in part.
+	bool IsTruncated() const { return _overBudget; }
+
+	/// Value of an attribute of the tag last parsed, empty if it has none.
+	std::string_view GetAttribute(std::string_view name) const;
 
 	bool EndOfText() { return (_pos >= _html.length()); };
 
@@ -74,11 +136,25 @@ public:
 	}
 
 protected:
-	std::string _text;
-	std::string _html;
+	bool IsOverBudget();
+	void VisitTag(TagKind kind, size_t tagStart);
+	void EndLink();
+
+protected:
+	std::string _text;    ///< The caller's output buffer while Convert runs
+	std::string_view _html;
+	std::string _tag;     ///< Name of the tag last parsed, lowercase
 	size_t _pos = 0;
 	bool _preformatted = false;
 
-	CMapStringToString _tags;
-	CStringList _ignoreTags;
+	CHtmlVisitor* _visitor = nullptr;
+	std::vector<std::pair<std::string_view, std::string_view>> _attributes; ///< Of the tag last parsed, as views into _html
+	std::string_view _linkHref;
+	size_t _linkStart = std::string::npos;   ///< Offset in _text where the open link's text starts
+	size_t _titleStart = std::string::npos;  ///< Offset in _html where the open title's content starts
+	bool _titleSeen = false;
+
+	size_t _tagCount = 0;          ///< Tags parsed so far, to check the clock now and then
+	ULONGLONG _deadline = 0;       ///< Tick count when the page's parse budget runs out
+	bool _overBudget = false;
 };
@@ -0,0 +1,541 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file HttpFetcher.cpp
+ * @brief Implements the asynchronous WinHTTP page fetcher.
+ *
+ * Request life cycle, driven by WinHTTP callbacks:
+ * SendRequest -> SENDREQUEST_COMPLETE -> ReceiveResponse -> HEADERS_AVAILABLE ->
+ * QueryDataAvailable -> DATA_AVAILABLE -> ReadData -> READ_COMPLETE -> ... until
+ * DATA_AVAILABLE reports 0 bytes. Any REQUEST_ERROR ends the request as failed.
+ * The request object is deleted on HANDLE_CLOSING, the last callback of its handle.
+ */
+
+#include "stdafx.h"
+#include "HttpFetcher.h"
+#include "CrawlerMetrics.h"
+#include "WarcArchive.h"
+
+#pragma comment(lib, "winhttp")
+
+#define FETCH_USER_AGENT L"WebSearchEngine/1.0 (+https://text-mining.ro/)"
+#define FETCH_RESOLVE_TIMEOUT 10000
+#define FETCH_CONNECT_TIMEOUT 10000
+#define FETCH_SEND_TIMEOUT 30000
+#define FETCH_RECEIVE_TIMEOUT 30000
+#define FETCH_INITIAL_BUFFER (64 * 1024)
+#define FETCH_SNIFF_SIZE 512 // body bytes checked for the signature of a binary file
+#define FETCH_REPLAY_HEADER_SLACK (64 * 1024) // status line, headers and chunk framing allowed on top of the body limit
+#define FETCH_CALLBACK_FLAGS (WINHTTP_CALLBACK_FLAG_ALL_COMPLETIONS | WINHTTP_CALLBACK_FLAG_HANDLES | \
+	WINHTTP_CALLBACK_FLAG_CONNECT_TO_SERVER | WINHTTP_CALLBACK_FLAG_SEND_REQUEST)
+
+CHttpFetcher::CHttpFetcher()
+{
+	m_hSession = ::WinHttpOpen(FETCH_USER_AGENT, WINHTTP_ACCESS_TYPE_AUTOMATIC_PROXY,
+		WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, WINHTTP_FLAG_ASYNC);
+	if (m_hSession != nullptr)
+	{
+		::WinHttpSetTimeouts(m_hSession, FETCH_RESOLVE_TIMEOUT, FETCH_CONNECT_TIMEOUT, FETCH_SEND_TIMEOUT, FETCH_RECEIVE_TIMEOUT);
+		::WinHttpSetStatusCallback(m_hSession, StatusCallback, FETCH_CALLBACK_FLAGS, 0);
+		// sends Accept-Encoding and inflates incrementally while reading; fails harmlessly before Windows 8.1
+		DWORD dwDecompression = WINHTTP_DECOMPRESSION_FLAG_ALL;
+		::WinHttpSetOption(m_hSession, WINHTTP_OPTION_DECOMPRESSION, &dwDecompression, sizeof(dwDecompression));
+		m_pPool.Configure(m_hSession, 0, 30000);
+	}
+}
+
+CHttpFetcher::~CHttpFetcher()
+{
+	Cancel();
+	{
+		// every request object is deleted by its HANDLE_CLOSING callback
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_eventClosed.wait(lock, [this] { return m_setOpen.empty(); });
+	}
+	m_pPool.Clear();
+	if (m_hSession != nullptr)
+	{
+		::WinHttpSetStatusCallback(m_hSession, nullptr, FETCH_CALLBACK_FLAGS, 0);
+		::WinHttpCloseHandle(m_hSession);
+	}
+}
+
+void CHttpFetcher::Configure(UINT nConnectionsPerHost, UINT nIdleTimeout)
+{
+	m_pPool.Configure(m_hSession, nConnectionsPerHost, static_cast<ULONGLONG>(nIdleTimeout) * 1000);
+}
+
+std::string CHttpFetcher::QueryHeader(HINTERNET hRequest, DWORD dwInfoLevel)
+{
+	DWORD dwSize = 0;
+	::WinHttpQueryHeaders(hRequest, dwInfoLevel, WINHTTP_HEADER_NAME_BY_INDEX, WINHTTP_NO_OUTPUT_BUFFER, &dwSize, WINHTTP_NO_HEADER_INDEX);
+	if ((::GetLastError() != ERROR_INSUFFICIENT_BUFFER) || (dwSize == 0))
+		return std::string();
+
+	std::wstring strValue(dwSize / sizeof(wchar_t), L'\0');
+	if (!::WinHttpQueryHeaders(hRequest, dwInfoLevel, WINHTTP_HEADER_NAME_BY_INDEX, strValue.data(), &dwSize, WINHTTP_NO_HEADER_INDEX))
+		return std::string();
+	strValue.resize(dwSize / sizeof(wchar_t));
+	return std::string(CStringA(strValue.c_str()));
+}
+
+bool CHttpFetcher::IsForeignContentType(const std::string& lpszContentType)
+{
+	std::string strType = lpszContentType.substr(0, lpszContentType.find(';'));
+	strType.erase(std::remove_if(strType.begin(), strType.end(), [](char ch) { return isspace((unsigned char)ch) != 0; }), strType.end());
+	std::transform(strType.begin(), strType.end(), strType.begin(), [](char ch) { return (char)tolower((unsigned char)ch); });
+	// missing and catch-all types are often wrong, so the body decides for those
+	return !strType.empty() && (strType != "text/html") && (strType != "application/xhtml+xml") &&
+		(strType != "text/plain") && (strType != "application/octet-stream") && (strType != "binary/octet-stream") &&
+		(strType != "application/unknown") && (strType != "unknown/unknown");
+}
+
+ULONGLONG CHttpFetcher::ParseRetryAfter(const std::string& lpszValue)
+{
+	// either a number of seconds or an HTTP-date (RFC 9110, section 10.2.3)
+	if (lpszValue.empty())
+		return 0;
+	if (std::all_of(lpszValue.begin(), lpszValue.end(), [](char ch) { return isdigit((unsigned char)ch) != 0; }))
+		return std::min<ULONGLONG>(strtoull(lpszValue.c_str(), nullptr, 10), ULLONG_MAX / 1000) * 1000;
+
+	SYSTEMTIME pRetryTime = { 0 };
+	FILETIME pRetryFileTime = { 0 }, pNowFileTime = { 0 };
+	if (!::WinHttpTimeToSystemTime(CStringW(lpszValue.c_str()), &pRetryTime) || !::SystemTimeToFileTime(&pRetryTime, &pRetryFileTime))
+		return 0;
+	::GetSystemTimeAsFileTime(&pNowFileTime);
+	const ULONGLONG nRetry = (static_cast<ULONGLONG>(pRetryFileTime.dwHighDateTime) << 32) | pRetryFileTime.dwLowDateTime;
+	const ULONGLONG nNow = (static_cast<ULONGLONG>(pNowFileTime.dwHighDateTime) << 32) | pNowFileTime.dwLowDateTime;
+	return (nRetry > nNow) ? (nRetry - nNow) / 10000 : 0; // 100-nanosecond intervals
+}
+
+bool CHttpFetcher::LooksBinary(std::string_view pHead)
+{
+	// signatures of binary files that start with printable text
+	static const std::string_view arrSignatures[] = { "%PDF-", "%!PS", "{\\rtf", "GIF8", "ID3", "RIFF", "OggS", "fLaC", "Rar!" };
+	for (const auto& lpszSignature : arrSignatures)
+	{
+		if (pHead.starts_with(lpszSignature))
+			return true;
+	}
+	// UTF-16 text is full of zero bytes
+	if (pHead.starts_with("\xFE\xFF") || pHead.starts_with("\xFF\xFE"))
+		return false;
+	// any other binary format (images, archives, executables) holds control bytes that text never does
+	for (const char ch : pHead)
+	{
+		const unsigned char nByte = static_cast<unsigned char>(ch);
+		if ((nByte <= 0x08) || (nByte == 0x0B) || ((nByte >= 0x0E) && (nByte <= 0x1A)) || ((nByte >= 0x1C) && (nByte <= 0x1F)))
+			return true;
+	}
+	return false;
+}
+
+bool CHttpFetcher::IsBinaryBody(CFetchRequest* pRequest)
+{
+	// checked once, as soon as enough of the body has arrived to abort the rest of the transfer
+	CFetchResult* pResult = pRequest->m_pResult.get();
+	if (!pRequest->m_bHtmlOnly || pRequest->m_bSniffed || (pResult->m_nStatusCode < 200) || (pResult->m_nStatusCode >= 300))
+		return false;
+	pRequest->m_bSniffed = true;
+	if (!LooksBinary(std::string_view(pResult->m_arrBuffer.data(), std::min<size_t>(pResult->m_nLength, FETCH_SNIFF_SIZE))))
+		return false;
+	gCrawlerMetrics.AddCounter("fetch_rejected_by_sniffing");
+	return true;
+}
+
+std::unique_ptr<CFetchResult> CHttpFetcher::AcquireResult(const std::string& lpszURL, UINT nTag)
+{
+	std::unique_ptr<CFetchResult> pResult;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_arrFree.empty())
+		{
+			pResult = std::move(m_arrFree.back());
+			m_arrFree.pop_back();
+		}
+	}
+	if (pResult == nullptr)
+	{
+		pResult = std::make_unique<CFetchResult>();
+		pResult->m_arrBuffer.resize(FETCH_INITIAL_BUFFER);
+	}
+	pResult->m_strURL = lpszURL;
+	pResult->m_nTag = nTag;
+	pResult->m_bReceived = false;
+	pResult->m_nStatusCode = 0;
+	pResult->m_strContentType.clear();
+	pResult->m_strETag.clear();
+	pResult->m_strLastModified.clear();
+	pResult->m_nLength = 0;
+	pResult->m_nStartTime = ::GetTickCount64();
+	pResult->m_nFetchTime = 0;
+	pResult->m_nRetryAfter = 0;
+
+	return pResult;
+}
+
+bool CHttpFetcher::SetReplayArchive(const std::string& lpszPath)
+{
+	m_pReplay = std::make_unique<CWarcArchive>();
+	if (m_pReplay->Open(lpszPath))
+		return true;
+	m_pReplay.reset();
+	return false;
+}
+
+bool CHttpFetcher::SetRecordArchive(const std::string& lpszPath)
+{
+	m_pRecord = std::make_unique<CWarcArchive>();
+	if (m_pRecord->Create(lpszPath))
+		return true;
+	m_pRecord.reset();
+	return false;
+}
+
+bool CHttpFetcher::Replay(const std::string& lpszURL, UINT nTag, bool bHtmlOnly)
+{
+	// answered at once, through the same queue as live downloads
+	std::unique_ptr<CFetchResult> pResult = AcquireResult(lpszURL, nTag);
+	bool bReceived = true;
+	const unsigned __int64 nMaxLength = (m_nMaxBodySize > 0) ? m_nMaxBodySize + FETCH_REPLAY_HEADER_SLACK : 0;
+	const CWarcArchive::Status nStatus = m_pReplay->Read(lpszURL, *pResult, nMaxLength);
+	if (nStatus == CWarcArchive::Status::NOT_FOUND)
+	{
+		// as if the server had no such page: a missing robots.txt then allows everything
+		gCrawlerMetrics.AddCounter("fetch_replay_misses");
+		pResult->m_nStatusCode = 404;
+		pResult->m_nLength = 0;
+	}
+	else if ((nStatus == CWarcArchive::Status::TOO_LARGE) || ((m_nMaxBodySize > 0) && (pResult->m_nLength > m_nMaxBodySize)))
+	{
+		gCrawlerMetrics.AddCounter("fetch_body_too_large");
+		bReceived = false;
+	}
+	else if (bHtmlOnly && (pResult->m_nStatusCode >= 200) && (pResult->m_nStatusCode < 300))
+	{
+		if (IsForeignContentType(pResult->m_strContentType))
+		{
+			gCrawlerMetrics.AddCounter("fetch_rejected_content_type");
+			bReceived = false;
+		}
+		else if (LooksBinary(std::string_view(pResult->m_arrBuffer.data(), std::min<size_t>(pResult->m_nLength, FETCH_SNIFF_SIZE))))
+		{
+			gCrawlerMetrics.AddCounter("fetch_rejected_by_sniffing");
+			bReceived = false;
+		}
+	}
+	m_nPending++;
+	Finish(std::move(pResult), bReceived);
+	return true;
+}
+
+bool CHttpFetcher::Submit(const std::string& lpszURL, UINT nTag, bool bHtmlOnly)
+{
+	if (m_pReplay != nullptr)
+		return Replay(lpszURL, nTag, bHtmlOnly);
+	if (m_hSession == nullptr)
+		return false;
+
+	// canonical URLs are plain ASCII, so the wide form is a widening copy
+	const std::wstring strURL(lpszURL.begin(), lpszURL.end());
+	URL_COMPONENTS pComponents = { sizeof(URL_COMPONENTS), };
+	pComponents.dwHostNameLength = (DWORD)-1;
+	pComponents.dwUrlPathLength = (DWORD)-1;
+	pComponents.dwExtraInfoLength = (DWORD)-1;
+	if (!::WinHttpCrackUrl(strURL.c_str(), static_cast<DWORD>(strURL.length()), 0, &pComponents))
+	{
+		gCrawlerMetrics.AddCounter("fetch_failures");
+		return false;
+	}
+
+	const std::wstring strHost(pComponents.lpszHostName, pComponents.dwHostNameLength);
+	std::wstring strObject(pComponents.lpszUrlPath, pComponents.dwUrlPathLength);
+	strObject.append(pComponents.lpszExtraInfo, pComponents.dwExtraInfoLength);
+	if (strObject.empty())
+		strObject = L"/";
+
+	std::unique_ptr<CFetchResult> pResult = AcquireResult(lpszURL, nTag);
+	CFetchRequest* pRequest = new CFetchRequest;
+	pRequest->m_pOwner = this;
+	pRequest->m_pResult = std::move(pResult);
+	pRequest->m_bHtmlOnly = bHtmlOnly;
+	pRequest->m_pConnection = m_pPool.Acquire(strHost, pComponents.nPort);
+	if (pRequest->m_pConnection != nullptr)
+		pRequest->m_hRequest = ::WinHttpOpenRequest(pRequest->m_pConnection->m_hConnect, L"GET", strObject.c_str(), nullptr, WINHTTP_NO_REFERER,
+			WINHTTP_DEFAULT_ACCEPT_TYPES, (pComponents.nScheme == INTERNET_SCHEME_HTTPS) ? WINHTTP_FLAG_SECURE : 0);
+	if (pRequest->m_hRequest == nullptr)
+	{
+		m_pPool.Release(pRequest->m_pConnection);
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_arrFree.push_back(std::move(pRequest->m_pResult));
+		}
+		delete pRequest;
+		gCrawlerMetrics.AddCounter("fetch_failures");
+		return false;
+	}
+
+	// from here on the request object belongs to its callbacks
+	DWORD_PTR dwContext = reinterpret_cast<DWORD_PTR>(pRequest);
+	::WinHttpSetOption(pRequest->m_hRequest, WINHTTP_OPTION_CONTEXT_VALUE, &dwContext, sizeof(dwContext));
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_setOpen.insert(pRequest);
+	}
+	m_nPending++;
+	if (!::WinHttpSendRequest(pRequest->m_hRequest, WINHTTP_NO_ADDITIONAL_HEADERS, 0, WINHTTP_NO_REQUEST_DATA, 0, 0, dwContext))
+	{
+		{
+			std::lock_guard<std::mutex> lock(pRequest->m_mutex);
+			Complete(pRequest, false);
+		}
+		CloseRequest(pRequest);
+	}
+	return true;
+}
+
+void CALLBACK CHttpFetcher::StatusCallback(HINTERNET /*hInternet*/, DWORD_PTR dwContext, DWORD dwStatus, LPVOID lpvInfo, DWORD dwInfoLength)
+{
+	// connection handles carry no context
+	CFetchRequest* pRequest = reinterpret_cast<CFetchRequest*>(dwContext);
+	if (pRequest != nullptr)
+		pRequest->m_pOwner->OnStatus(pRequest, dwStatus, lpvInfo, dwInfoLength);
+}
+
+void CHttpFetcher::OnStatus(CFetchRequest* pRequest, DWORD dwStatus, LPVOID lpvInfo, DWORD dwInfoLength)
+{
+	if (dwStatus == WINHTTP_CALLBACK_STATUS_HANDLE_CLOSING)
+	{
+		// a handle closed before any completion still owes its result, or m_nPending never drops to 0
+		std::unique_ptr<CFetchResult> pResult;
+		{
+			std::lock_guard<std::mutex> lock(pRequest->m_mutex);
+			pResult = std::move(pRequest->m_pResult);
+		}
+		if (pResult != nullptr)
+			Finish(std::move(pResult), false);
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_setOpen.erase(pRequest);
+		}
+		delete pRequest;
+		m_eventClosed.notify_all();
+		return;
+	}
+
+	// a cancelled request may report an error while another callback is still running
+	std::unique_lock<std::mutex> lock(pRequest->m_mutex);
+	CFetchResult* pResult = pRequest->m_pResult.get();
+	if (pResult == nullptr)
+		return; // already completed
+	HINTERNET hRequest = pRequest->m_hRequest;
+
+	switch (dwStatus)
+	{
+	case WINHTTP_CALLBACK_STATUS_CONNECTING_TO_SERVER:
+		if (!pRequest->m_bSent)
+			pRequest->m_nConnectStart = ::GetTickCount64();
+		break;
+	case WINHTTP_CALLBACK_STATUS_SENDING_REQUEST:
+		// TLS is negotiated between connecting and sending, so this covers both handshakes
+		if (!pRequest->m_bSent)
+		{
+			pRequest->m_bSent = true;
+			if (pRequest->m_nConnectStart != 0)
+				m_pPool.RecordHandshake(pRequest->m_pConnection, ::GetTickCount64() - pRequest->m_nConnectStart);
+			else
+				m_pPool.RecordReuse(pRequest->m_pConnection);
+		}
+		break;
+	case WINHTTP_CALLBACK_STATUS_SENDREQUEST_COMPLETE:
+		if (!::WinHttpReceiveResponse(hRequest, nullptr))
+			Complete(pRequest, false);
+		break;
+	case WINHTTP_CALLBACK_STATUS_HEADERS_AVAILABLE:
+	{
+		DWORD dwStatusCode = 0;
+		DWORD dwSize = sizeof(dwStatusCode);
+		::WinHttpQueryHeaders(hRequest, WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER,
+			WINHTTP_HEADER_NAME_BY_INDEX, &dwStatusCode, &dwSize, WINHTTP_NO_HEADER_INDEX);
+		pResult->m_nStatusCode = dwStatusCode;
+		pResult->m_strContentType = QueryHeader(hRequest, WINHTTP_QUERY_CONTENT_TYPE);
+		pResult->m_strETag = QueryHeader(hRequest, WINHTTP_QUERY_ETAG);
+		pResult->m_strLastModified = QueryHeader(hRequest, WINHTTP_QUERY_LAST_MODIFIED);
+		if ((dwStatusCode == 429) || (dwStatusCode == HTTP_STATUS_SERVICE_UNAVAIL))
+			pResult->m_nRetryAfter = ParseRetryAfter(QueryHeader(hRequest, WINHTTP_QUERY_RETRY_AFTER));
+
+		// the declared length is the encoded one, which only grows when decoded
+		DWORD dwContentLength = 0;
+		dwSize = sizeof(dwContentLength);
+		if ((m_nMaxBodySize > 0) && ::WinHttpQueryHeaders(hRequest, WINHTTP_QUERY_CONTENT_LENGTH | WINHTTP_QUERY_FLAG_NUMBER,
+			WINHTTP_HEADER_NAME_BY_INDEX, &dwContentLength, &dwSize, WINHTTP_NO_HEADER_INDEX) && (dwContentLength > m_nMaxBodySize))
+		{
+			gCrawlerMetrics.AddCounter("fetch_body_too_large");
+			Complete(pRequest, false);
+		}
+		else if (pRequest->m_bHtmlOnly && (dwStatusCode >= 200) && (dwStatusCode < 300) && IsForeignContentType(pResult->m_strContentType))
+		{
+			gCrawlerMetrics.AddCounter("fetch_rejected_content_type");
+			Complete(pRequest, false);
+		}
+		else if (!::WinHttpQueryDataAvailable(hRequest, nullptr))
+			Complete(pRequest, false);
+		break;
+	}
+	case WINHTTP_CALLBACK_STATUS_DATA_AVAILABLE:
+	{
+		const DWORD dwAvailable = *static_cast<DWORD*>(lpvInfo);
+		if (dwAvailable == 0)
+		{
+			Complete(pRequest, !IsBinaryBody(pRequest));
+			break;
+		}
+		if ((m_nMaxBodySize > 0) && (pResult->m_nLength + dwAvailable > m_nMaxBodySize))
+		{
+			// too large once decoded: abort before a compression bomb fills memory
+			gCrawlerMetrics.AddCounter("fetch_body_too_large");
+			Complete(pRequest, false);
+			break;
+		}
+		// grow geometrically; the buffer keeps its size for the next page
+		if (pResult->m_nLength + dwAvailable > pResult->m_arrBuffer.size())
+			pResult->m_arrBuffer.resize(std::max(pResult->m_arrBuffer.size() * 2, pResult->m_nLength + dwAvailable));
+		if (!::WinHttpReadData(hRequest, pResult->m_arrBuffer.data() + pResult->m_nLength, dwAvailable, nullptr))
+			Complete(pRequest, false);
+		break;
+	}
+	case WINHTTP_CALLBACK_STATUS_READ_COMPLETE:
+		pResult->m_nLength += dwInfoLength;
+		if (((dwInfoLength == 0) || (pResult->m_nLength >= FETCH_SNIFF_SIZE)) && IsBinaryBody(pRequest))
+			Complete(pRequest, false);
+		else if (dwInfoLength == 0)
+			Complete(pRequest, true);
+		else if (!::WinHttpQueryDataAvailable(hRequest, nullptr))
+			Complete(pRequest, false);
+		break;
+	case WINHTTP_CALLBACK_STATUS_REQUEST_ERROR:
+		Complete(pRequest, false);
+		break;
+	}
+
+	// the handles are closed outside the request lock, as closing ends in deleting the request
+	const bool bDone = (pRequest->m_pResult == nullptr);
+	lock.unlock();
+	if (bDone)
+		CloseRequest(pRequest);
+}
+
+void CHttpFetcher::Complete(CFetchRequest* pRequest, bool bReceived)
+{
+	std::unique_ptr<CFetchResult> pResult = std::move(pRequest->m_pResult);
+	if (pResult != nullptr)
+		Finish(std::move(pResult), bReceived);
+}
+
+void CHttpFetcher::Finish(std::unique_ptr<CFetchResult> pResult, bool bReceived)
+{
+	pResult->m_bReceived = bReceived;
+	if (!bReceived)
+		pResult->m_nLength = 0;
+	pResult->m_nFetchTime = ::GetTickCount64() - pResult->m_nStartTime;
+	if (!bReceived)
+		gCrawlerMetrics.AddCounter("fetch_failures");
+	else
+	{
+		gCrawlerMetrics.AddCounter("fetch_bytes", static_cast<__int64>(pResult->m_nLength));
+		if (!pResult->IsSuccess())
+			gCrawlerMetrics.AddCounter("fetch_status_" + std::to_string(pResult->m_nStatusCode));
+		if (m_pRecord != nullptr)
+			m_pRecord->Write(*pResult);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_arrResults.push_back(std::move(pResult));
+	}
+	m_nCompleted++;
+	m_eventResult.notify_one();
+}
+
+void CHttpFetcher::CloseRequest(CFetchRequest* pRequest)
+{
+	if (!pRequest->m_bClosed.exchange(true))
+		CloseHandles(pRequest);
+}
+
+void CHttpFetcher::CloseHandles(CFetchRequest* pRequest)
+{
+	// the connection stays open in the pool for the next request to the host
+	CConnectionPool::CConnection* pConnection = pRequest->m_pConnection;
+	::WinHttpCloseHandle(pRequest->m_hRequest);
+	m_pPool.Release(pConnection);
+}
+
+void CHttpFetcher::Cancel()
+{
+	// claim the handles under the lock: a claimed request cannot be deleted before its handle is closed
+	std::vector<CFetchRequest*> arrClaimed;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (auto pRequest : m_setOpen)
+		{
+			if (!pRequest->m_bClosed.exchange(true))
+				arrClaimed.push_back(pRequest);
+		}
+	}
+	// closing outside the lock: WinHTTP may call back synchronously
+	for (auto pRequest : arrClaimed)
+		CloseHandles(pRequest);
+}
+
+bool CHttpFetcher::WaitForResult(std::unique_ptr<CFetchResult>& pResult, DWORD dwTimeout)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (!m_eventResult.wait_for(lock, std::chrono::milliseconds(dwTimeout), [this] { return !m_arrResults.empty(); }))
+		return false;
+	pResult = std::move(m_arrResults.front());
+	m_arrResults.pop_front();
+	return true;
+}
+
+void CHttpFetcher::Recycle(std::unique_ptr<CFetchResult> pResult)
+{
+	if (pResult == nullptr)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_arrFree.push_back(std::move(pResult));
+	}
+	m_nPending--;
+}
+
+void CHttpFetcher::ExportMetrics(CCrawlerMetrics& pMetrics) const
+{
+	size_t nQueued = 0, nOpen = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		nQueued = m_arrResults.size();
+		nOpen = m_setOpen.size();
+	}
+	pMetrics.SetGauge("fetch_in_flight", static_cast<double>(nOpen));
+	pMetrics.SetGauge("fetch_results_queued", static_cast<double>(nQueued));
+	pMetrics.SetGauge("fetch_pending", static_cast<double>(m_nPending));
+	pMetrics.SetGauge("fetch_completed", static_cast<double>(m_nCompleted));
+	m_pPool.ExportMetrics(pMetrics);
+	if (m_pReplay != nullptr)
+		m_pReplay->ExportMetrics(pMetrics);
+	if (m_pRecord != nullptr)
+		m_pRecord->ExportMetrics(pMetrics);
+}
@@ -0,0 +1,220 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file HttpFetcher.h
+ * @brief Declaration of the asynchronous WinHTTP page fetcher that keeps many
+ *        requests in flight and reads response bodies straight into memory.
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_set>
+#include <winhttp.h>
+#include "ConnectionPool.h"
+
+class CCrawlerMetrics;
+class CWarcArchive;
+
+/**
+ * @class CFetchResult
+ * @brief One finished download: the response of a URL and how long it took.
+ *
+ * Results are recycled by the fetcher, so the body buffer keeps the capacity of
+ * the largest page it has held and later pages are read into it without
+ * allocating.
+ */
+class CFetchResult
+{
+public:
+	/**
+	 * @brief Body of the response.
+	 */
+	std::string_view GetBody() const { return std::string_view(m_arrBuffer.data(), m_nLength); }
+
+	/**
+	 * @brief Checks whether a response was received and its status is a success (2xx).
+	 */
+	bool IsSuccess() const { return m_bReceived && (m_nStatusCode >= 200) && (m_nStatusCode < 300); }
+
+public:
+	std::string m_strURL;
+	UINT m_nTag = 0;                   ///< As given to Submit
+	bool m_bReceived = false;          ///< false if the request failed before a complete response
+	DWORD m_nStatusCode = 0;
+	std::string m_strContentType;
+	std::string m_strETag;
+	std::string m_strLastModified;
+	ULONGLONG m_nStartTime = 0;        ///< Tick count when the request was submitted
+	ULONGLONG m_nFetchTime = 0;        ///< Milliseconds from submission to completion
+	ULONGLONG m_nRetryAfter = 0;       ///< Milliseconds a 429 or 503 response asked to wait; 0 if none
+
+protected:
+	std::vector<char> m_arrBuffer;     ///< Body, followed by spare capacity
+	size_t m_nLength = 0;              ///< Bytes of m_arrBuffer holding the body
+
+	friend class CHttpFetcher;
+	friend class CWarcArchive;
+};
+
+/**
+ * @class CHttpFetcher
+ * @brief Multiplexes many HTTP and HTTPS downloads over WinHTTP's asynchronous API.
+ *
+ * Submit starts a request and returns at once; WinHTTP drives every request from
+ * its own I/O completion threads through a small state machine (send, headers,
+ * data available, read) and the finished result is queued for WaitForResult.
+ * Throughput is therefore bounded by the number of requests in flight rather
+ * than by the round-trip time of one page. Submit, WaitForResult and Recycle may
+ * be called from any thread. Connections are kept alive per host by a CConnectionPool.
+ *
+ * The session asks for gzip and deflate transfer encoding and WinHTTP inflates
+ * the body as it is read, so the body buffer only ever holds decoded bytes and
+ * the size limit caps what a compressed response may expand to.
+ *
+ * Requests for pages accept HTML only. A response whose Content-Type names
+ * another media type, or whose first bytes are those of a binary file, is
+ * aborted before the rest of its body is transferred and comes back as failed.
+ * A declared Content-Length above the size limit is rejected before any byte is read.
+ *
+ * For reproducible, network-free runs the fetcher can replay a WARC archive
+ * instead: each submitted URL is answered at once from its recorded response, or
+ * as "404 Not Found" if it was not recorded. Live crawls can record every
+ * response they receive into a WARC file for later replay.
+ */
+class CHttpFetcher
+{
+public:
+	CHttpFetcher();
+	~CHttpFetcher();
+
+public:
+	/**
+	 * @brief Sets how connections to a host are kept alive between requests.
+	 * @param nConnectionsPerHost Sockets opened to one server at most.
+	 * @param nIdleTimeout Seconds an unused host connection stays open.
+	 */
+	void Configure(UINT nConnectionsPerHost, UINT nIdleTimeout);
+
+	/**
+	 * @brief Sets the largest body accepted, counted after decompression; larger responses fail.
+	 * @param nMaxBodySize Size in bytes; 0 for no limit.
+	 */
+	void SetMaxBodySize(size_t nMaxBodySize) { m_nMaxBodySize = nMaxBodySize; }
+
+	/**
+	 * @brief Serves every request from recorded responses instead of the network.
+	 * @param lpszPath A .warc file, or a directory of .warc files.
+	 * @return false if the archive cannot be read; the fetcher stays live then.
+	 */
+	bool SetReplayArchive(const std::string& lpszPath);
+
+	/**
+	 * @brief Appends every response received from now on to a WARC file.
+	 * @return false if the file cannot be opened; nothing is recorded then.
+	 */
+	bool SetRecordArchive(const std::string& lpszPath);
+
+	/**
+	 * @brief Starts downloading a URL, following redirects.
+	 * @param lpszURL Absolute http or https URL.
+	 * @param nTag Caller's value, copied to the result to tell kinds of downloads apart.
+	 * @param bHtmlOnly true to abort responses that are not HTML; false to accept any content.
+	 * @return false if the request could not be started; no result is queued then.
+	 */
+	bool Submit(const std::string& lpszURL, UINT nTag = 0, bool bHtmlOnly = true);
+
+	/**
+	 * @brief Takes the next finished download.
+	 * @param[out] pResult The result; give it back with Recycle when done with the body.
+	 * @param dwTimeout Milliseconds to wait for a result.
+	 * @return true if a result was taken.
+	 */
+	bool WaitForResult(std::unique_ptr<CFetchResult>& pResult, DWORD dwTimeout);
+
+	/**
+	 * @brief Returns a result so its buffer can be reused by a later request.
+	 *        The request stops counting as pending only now, once its page is processed.
+	 */
+	void Recycle(std::unique_ptr<CFetchResult> pResult);
+
+	/**
+	 * @brief Aborts every request in flight; each still produces a failed result.
+	 */
+	void Cancel();
+
+	/**
+	 * @brief Number of submitted requests whose result has not been recycled yet.
+	 */
+	size_t GetPendingCount() const { return m_nPending; }
+
+	/**
+	 * @brief Publishes in-flight, completion and connection reuse statistics.
+	 */
+	void ExportMetrics(CCrawlerMetrics& pMetrics) const;
+
+protected:
+	/// State of one request while WinHTTP owns it.
+	struct CFetchRequest
+	{
+		CHttpFetcher* m_pOwner = nullptr;
+		std::unique_ptr<CFetchResult> m_pResult;
+		CConnectionPool::CConnection* m_pConnection = nullptr;
+		HINTERNET m_hRequest = nullptr;
+		ULONGLONG m_nConnectStart = 0;     ///< Tick count when a new socket started connecting, 0 if none did
+		bool m_bSent = false;              ///< The first request of a redirect chain was sent
+		bool m_bHtmlOnly = true;
+		bool m_bSniffed = false;           ///< The first bytes of the body have been checked
+		std::atomic<bool> m_bClosed{ false };
+		std::mutex m_mutex;                ///< Serializes the callbacks of a cancelled request
+	};
+
+	std::unique_ptr<CFetchResult> AcquireResult(const std::string& lpszURL, UINT nTag);
+	bool Replay(const std::string& lpszURL, UINT nTag, bool bHtmlOnly);
+	static void CALLBACK StatusCallback(HINTERNET hInternet, DWORD_PTR dwContext, DWORD dwStatus, LPVOID lpvInfo, DWORD dwInfoLength);
+	void OnStatus(CFetchRequest* pRequest, DWORD dwStatus, LPVOID lpvInfo, DWORD dwInfoLength);
+	bool IsBinaryBody(CFetchRequest* pRequest);                 ///< Sniffs the start of a page's body, once
+	void Complete(CFetchRequest* pRequest, bool bReceived);   ///< Queues the result; the caller closes the handles
+	void Finish(std::unique_ptr<CFetchResult> pResult, bool bReceived);
+	void CloseRequest(CFetchRequest* pRequest);
+	void CloseHandles(CFetchRequest* pRequest);
+	static std::string QueryHeader(HINTERNET hRequest, DWORD dwInfoLevel);
+	static bool IsForeignContentType(const std::string& lpszContentType);
+	static bool LooksBinary(std::string_view pHead);
+	static ULONGLONG ParseRetryAfter(const std::string& lpszValue);
+
+protected:
+	HINTERNET m_hSession = nullptr;
+	CConnectionPool m_pPool;
+	std::unique_ptr<CWarcArchive> m_pReplay;             ///< Archive answering requests, nullptr when live
+	std::unique_ptr<CWarcArchive> m_pRecord;             ///< Archive receiving responses, nullptr if not recording
+	size_t m_nMaxBodySize = 0;
+	std::atomic<size_t> m_nPending{ 0 };
+	std::atomic<unsigned __int64> m_nCompleted{ 0 };
+
+	mutable std::mutex m_mutex;                          ///< Guards the queues and the open request set
+	std::condition_variable m_eventResult;
+	std::condition_variable m_eventClosed;
+	std::deque<std::unique_ptr<CFetchResult>> m_arrResults;   ///< Finished, not taken yet
+	std::vector<std::unique_ptr<CFetchResult>> m_arrFree;     ///< Recycled results
+	std::unordered_set<CFetchRequest*> m_setOpen;           ///< Requests whose handles are not closed yet
+};
@@ -0,0 +1,321 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file PolitenessScheduler.cpp
+ * @brief Implements the per-host back queues and the next-fetch-time heap.
+ */
+
+#include "stdafx.h"
+#include "PolitenessScheduler.h"
+#include "UrlFrontier.h"
+#include "CrawlerMetrics.h"
+#include "CrawlCheckpoint.h"
+
+#define DELAY_FACTOR 10      // wait this many times the last fetch time before hitting the host again
+#define REFILL_LIMIT 1024    // front queue pops per refill, so one crowded host cannot stall Extract
+#define BACK_QUEUE_LIMIT 8   // URLs a back queue holds; the rest wait in the frontier in OPIC order
+#define AIMD_INCREASE 0.05   // fetches per second added to a host's rate after each healthy fetch
+#define AIMD_DECREASE 0.5    // factor applied to a host's rate on a sign of overload
+#define AIMD_MIN_RATE (1.0 / 60) // a slowed host is still fetched once a minute
+#define LATENCY_WEIGHT 0.2   // weight of the newest fetch time in a host's average latency
+#define LATENCY_SLOWDOWN 2.0 // a fetch this many times slower than the average is a sign of overload...
+#define LATENCY_FLOOR 500    // ...if it also took at least this many milliseconds
+#define RETRY_AFTER_LIMIT (3600 * 1000ULL) // longest Retry-After honoured
+#define RATE_MEMORY (3600 * 1000ULL) // how long a slowed host's rate is remembered without fetches
+
+CPolitenessScheduler::CPolitenessScheduler(CUrlFrontier& pFrontier)
+	: m_pFrontier(pFrontier)
+{
+}
+
+CPolitenessScheduler::~CPolitenessScheduler()
+{
+}
+
+void CPolitenessScheduler::Configure(size_t nBackQueues, ULONGLONG nMinimumDelay)
+{
+	m_nBackQueues = std::max<size_t>(1, nBackQueues);
+	m_nMinimumDelay = nMinimumDelay;
+}
+
+void CPolitenessScheduler::Refill()
+{
+	// pull from the front queue until every back queue slot holds a host; URLs of hosts
+	// whose back queue is full are held by the frontier under their host, with their cash
+	const auto pAccept = [this](const std::string& lpszCandidate) {
+		auto it = m_mapBackQueues.find(GetHost(lpszCandidate));
+		return (it == m_mapBackQueues.end()) || (it->second.m_arrURLs.size() < BACK_QUEUE_LIMIT);
+	};
+	std::string lpszURL;
+	for (size_t nPops = 0; (m_mapBackQueues.size() < m_nBackQueues) && (nPops < REFILL_LIMIT); nPops++)
+	{
+		if (!m_pFrontier.Extract(lpszURL, pAccept))
+			break;
+
+		const std::string strHost = GetHost(lpszURL);
+		auto it = m_mapBackQueues.find(strHost);
+		if (it == m_mapBackQueues.end())
+		{
+			it = m_mapBackQueues.emplace(strHost, CBackQueue()).first;
+			auto pCooldown = m_mapCooldown.find(strHost);
+			if (pCooldown != m_mapCooldown.end())
+			{
+				it->second.m_nNextFetch = pCooldown->second.m_nNextFetch;
+				it->second.m_pRate = pCooldown->second.m_pRate;
+				m_mapCooldown.erase(pCooldown);
+			}
+			m_heapReady.push(CReadyHost(it->second.m_nNextFetch, strHost));
+		}
+		it->second.m_arrURLs.push_back(std::move(lpszURL));
+		m_nBackQueued++;
+	}
+}
+
+bool CPolitenessScheduler::Extract(std::string& lpszURL, ULONGLONG& nWait)
+{
+	lpszURL = "";
+	nWait = 0;
+	Refill();
+
+	while (!m_heapReady.empty())
+	{
+		const ULONGLONG nNow = ::GetTickCount64();
+		const CReadyHost pTop = m_heapReady.top();
+		if (pTop.first > nNow)
+		{
+			nWait = pTop.first - nNow;
+			return false;
+		}
+		m_heapReady.pop();
+
+		auto it = m_mapBackQueues.find(pTop.second);
+		if ((it == m_mapBackQueues.end()) || it->second.m_bBusy || it->second.m_arrURLs.empty())
+			continue; // stale heap entry
+
+		lpszURL = std::move(it->second.m_arrURLs.front());
+		it->second.m_arrURLs.pop_front();
+		it->second.m_bBusy = true;
+		m_nBackQueued--;
+
+		// the frontier only holds URLs of hosts with a full back queue: top it up
+		// from them, so the queue does not run dry while some are left
+		std::string strHeld;
+		while ((it->second.m_arrURLs.size() < BACK_QUEUE_LIMIT) && m_pFrontier.ExtractHeld(pTop.second, strHeld))
+		{
+			it->second.m_arrURLs.push_back(std::move(strHeld));
+			m_nBackQueued++;
+		}
+		m_nBusyHosts++;
+		return true;
+	}
+	return false;
+}
+
+double CPolitenessScheduler::GetMaximumRate() const
+{
+	return 1000.0 / static_cast<double>(std::max<ULONGLONG>(m_nMinimumDelay, 1));
+}
+
+ULONGLONG CPolitenessScheduler::AdaptRate(CHostRate& pRate, ULONGLONG nFetchTime, Outcome nOutcome)
+{
+	const double rMaximum = GetMaximumRate();
+	if ((pRate.m_rRate <= 0.0) || (pRate.m_rRate > rMaximum))
+		pRate.m_rRate = rMaximum;
+
+	bool bOverload = (nOutcome == Outcome::THROTTLED) || (nOutcome == Outcome::FAILED);
+	if (nOutcome == Outcome::SUCCESS)
+	{
+		// compared with the average before this fetch is part of it
+		const double rFetchTime = static_cast<double>(nFetchTime);
+		if ((pRate.m_rLatency > 0.0) && (rFetchTime >= LATENCY_FLOOR) && (rFetchTime > LATENCY_SLOWDOWN * pRate.m_rLatency))
+		{
+			bOverload = true;
+			gCrawlerMetrics.AddCounter("politeness_latency_slowdowns");
+		}
+		pRate.m_rLatency = (pRate.m_rLatency > 0.0) ? (1.0 - LATENCY_WEIGHT) * pRate.m_rLatency + LATENCY_WEIGHT * rFetchTime : rFetchTime;
+	}
+
+	if (bOverload)
+	{
+		pRate.m_rRate = std::max(pRate.m_rRate * AIMD_DECREASE, AIMD_MIN_RATE);
+		pRate.m_nDecreased = ::GetTickCount64();
+		gCrawlerMetrics.AddCounter("politeness_rate_decreases");
+	}
+	else if (nOutcome == Outcome::SUCCESS)
+		pRate.m_rRate = std::min(pRate.m_rRate + AIMD_INCREASE, rMaximum);
+	return static_cast<ULONGLONG>(1000.0 / pRate.m_rRate);
+}
+
+void CPolitenessScheduler::Release(const std::string& lpszURL, ULONGLONG nFetchTime, Outcome nOutcome, ULONGLONG nRetryAfter)
+{
+	auto it = m_mapBackQueues.find(GetHost(lpszURL));
+	if ((it == m_mapBackQueues.end()) || !it->second.m_bBusy)
+		return;
+
+	const ULONGLONG nNow = ::GetTickCount64();
+	const ULONGLONG nInterval = AdaptRate(it->second.m_pRate, nFetchTime, nOutcome);
+	if (nOutcome == Outcome::THROTTLED)
+		gCrawlerMetrics.AddCounter("politeness_throttled");
+	if (nRetryAfter > 0)
+		gCrawlerMetrics.AddCounter("politeness_retry_after");
+	it->second.m_bBusy = false;
+	it->second.m_nNextFetch = !m_bDelays ? nNow : nNow + std::max<ULONGLONG>({ nInterval, DELAY_FACTOR * nFetchTime,
+		it->second.m_nHostDelay, std::min(nRetryAfter, RETRY_AFTER_LIMIT) });
+	m_nBusyHosts--;
+	if (it->second.m_arrURLs.empty())
+	{
+		// the slot goes back to the front queue, but the host keeps its delay and its rate
+		// in case it gets a new back queue before the delay is over
+		CCooldown& pCooldown = m_mapCooldown[it->first];
+		pCooldown.m_nNextFetch = it->second.m_nNextFetch;
+		pCooldown.m_pRate = it->second.m_pRate;
+		m_mapBackQueues.erase(it);
+		if (m_mapCooldown.size() > 4 * m_nBackQueues)
+		{
+			// slowed hosts are remembered for a while even when their delay is over
+			const double rMaximum = GetMaximumRate();
+			for (auto pEntry = m_mapCooldown.begin(); pEntry != m_mapCooldown.end();)
+			{
+				const CHostRate& pRate = pEntry->second.m_pRate;
+				if ((pEntry->second.m_nNextFetch <= nNow) && ((pRate.m_rRate >= rMaximum) || (pRate.m_nDecreased + RATE_MEMORY <= nNow)))
+					pEntry = m_mapCooldown.erase(pEntry);
+				else
+					pEntry++;
+			}
+		}
+		return;
+	}
+	m_heapReady.push(CReadyHost(it->second.m_nNextFetch, it->first));
+}
+
+void CPolitenessScheduler::SetHostDelay(const std::string& lpszHost, ULONGLONG nDelay)
+{
+	auto it = m_mapBackQueues.find(lpszHost);
+	if (it != m_mapBackQueues.end())
+		it->second.m_nHostDelay = nDelay;
+}
+
+bool CPolitenessScheduler::Save(std::ostream& pStream) const
+{
+	ASSERT(m_nBusyHosts == 0);
+	WriteCheckpointValue(pStream, static_cast<unsigned __int64>(m_nBackQueued));
+	for (const auto& it : m_mapBackQueues)
+	{
+		for (const auto& lpszURL : it.second.m_arrURLs)
+			WriteCheckpointString(pStream, lpszURL);
+	}
+	return pStream.good();
+}
+
+bool CPolitenessScheduler::Load(std::istream& pStream)
+{
+	unsigned __int64 nCount = 0;
+	if (!ReadCheckpointValue(pStream, nCount))
+		return false;
+	std::string lpszURL;
+	for (unsigned __int64 nIndex = 0; nIndex < nCount; nIndex++)
+	{
+		if (!ReadCheckpointString(pStream, lpszURL))
+		{
+			m_mapBackQueues.clear();
+			m_heapReady = decltype(m_heapReady)();
+			m_nBackQueued = 0;
+			return false;
+		}
+		const std::string strHost = GetHost(lpszURL);
+		auto it = m_mapBackQueues.find(strHost);
+		if (it == m_mapBackQueues.end())
+		{
+			it = m_mapBackQueues.emplace(strHost, CBackQueue()).first;
+			m_heapReady.push(CReadyHost(0, strHost));
+		}
+		it->second.m_arrURLs.push_back(lpszURL);
+		m_nBackQueued++;
+	}
+	return true;
+}
+
+void CPolitenessScheduler::Return(const std::string& lpszURL)
+{
+	const std::string strHost = GetHost(lpszURL);
+	auto it = m_mapBackQueues.find(strHost);
+	if (it == m_mapBackQueues.end())
+		it = m_mapBackQueues.emplace(strHost, CBackQueue()).first;
+	if (it->second.m_bBusy)
+	{
+		it->second.m_bBusy = false;
+		m_nBusyHosts--;
+	}
+	it->second.m_arrURLs.push_front(lpszURL);
+	m_nBackQueued++;
+	m_heapReady.push(CReadyHost(it->second.m_nNextFetch, strHost));
+}
+
+bool CPolitenessScheduler::IsEmpty() const
+{
+	return m_mapBackQueues.empty() && m_pFrontier.IsEmpty();
+}
+
+void CPolitenessScheduler::GetQueuedHosts(std::vector<std::string>& arrHosts) const
+{
+	arrHosts.clear();
+	for (const auto& it : m_mapBackQueues)
+	{
+		if (!it.second.m_bBusy && !it.second.m_arrURLs.empty())
+			arrHosts.push_back(it.first);
+	}
+}
+
+void CPolitenessScheduler::ExportMetrics(CCrawlerMetrics& pMetrics) const
+{
+	pMetrics.SetGauge("politeness_back_queues", static_cast<double>(m_mapBackQueues.size()));
+	pMetrics.SetGauge("politeness_back_queued_urls", static_cast<double>(m_nBackQueued));
+	pMetrics.SetGauge("politeness_busy_hosts", static_cast<double>(m_nBusyHosts));
+
+	// hosts come and go, so the per-host gauges are replaced as a whole
+	const double rMaximum = GetMaximumRate();
+	size_t nSlowed = 0;
+	pMetrics.RemoveGauges("politeness_host_rate_");
+	for (const auto& it : m_mapBackQueues)
+	{
+		const double rRate = (it.second.m_pRate.m_rRate > 0.0) ? std::min(it.second.m_pRate.m_rRate, rMaximum) : rMaximum;
+		pMetrics.SetGauge("politeness_host_rate_" + it.first, rRate);
+		if (rRate < rMaximum)
+			nSlowed++;
+	}
+	for (const auto& it : m_mapCooldown)
+	{
+		if ((it.second.m_pRate.m_rRate > 0.0) && (it.second.m_pRate.m_rRate < rMaximum))
+			nSlowed++;
+	}
+	pMetrics.SetGauge("politeness_slowed_hosts", static_cast<double>(nSlowed));
+}
+
+std::string CPolitenessScheduler::GetHost(const std::string& lpszURL)
+{
+	size_t nStart = lpszURL.find("://");
+	nStart = (nStart == std::string::npos) ? 0 : nStart + 3;
+	size_t nEnd = lpszURL.find_first_of("/?#", nStart);
+	if (nEnd == std::string::npos)
+		nEnd = lpszURL.length();
+	const size_t nUser = lpszURL.rfind('@', nEnd);
+	if ((nUser != std::string::npos) && (nUser >= nStart))
+		nStart = nUser + 1;
+
+	std::string strHost = lpszURL.substr(nStart, nEnd - nStart);
+	std::transform(strHost.begin(), strHost.end(), strHost.begin(),
+		[](char ch) { return (char)tolower((unsigned char)ch); });
+	return strHost;
+}
@@ -0,0 +1,188 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file PolitenessScheduler.h
+ * @brief Declaration of the Mercator-style back-queue scheduler that spreads
+ *        fetches over hosts and enforces a per-host delay.
+ */
+
+#pragma once
+
+#include <string>
+#include <iostream>
+#include <deque>
+#include <queue>
+#include <vector>
+#include <unordered_map>
+
+class CUrlFrontier;
+class CCrawlerMetrics;
+
+/**
+ * @class CPolitenessScheduler
+ * @brief Back queues keyed by host, fed from the priority ordered frontier
+ *        (the front queue), and a min-heap of the next time each host may be fetched.
+ *
+ * A host is busy from the moment one of its URLs is handed out until Release is
+ * called; it then becomes eligible again after max(1 / host rate, 10 x fetch time,
+ * the host's crawl-delay), or later if the server asked for it with Retry-After.
+ * At most one fetch per host is ever in flight, so each host has a token bucket
+ * of depth one that refills at the host rate.
+ *
+ * The host rate is set by an AIMD controller. It starts at the ceiling given by
+ * the minimum delay and is halved whenever the host answers 429 or 503, fails to
+ * answer, or answers much slower than its running average latency; every
+ * healthy fetch then adds a small constant to it, back up to the ceiling.
+ *
+ * Back queues are kept short: a host holds a few URLs at most, and the rest of
+ * its URLs stay in the frontier, where they keep collecting cash.
+ */
+class CPolitenessScheduler
+{
+public:
+	/// How the fetch of a released URL went, as feedback for the host rate.
+	enum class Outcome
+	{
+		SKIPPED,     ///< Not fetched; the rate is left alone
+		SUCCESS,     ///< The server answered
+		THROTTLED,   ///< "429 Too Many Requests" or "503 Service Unavailable"
+		FAILED       ///< No answer: timeout or connection error
+	};
+
+	explicit CPolitenessScheduler(CUrlFrontier& pFrontier);
+	~CPolitenessScheduler();
+
+public:
+	/**
+	 * @brief Sets the politeness parameters.
+	 * @param nBackQueues Number of hosts that may hold back queues at the same time.
+	 * @param nMinimumDelay Minimum delay between two fetches from the same host, in milliseconds.
+	 */
+	void Configure(size_t nBackQueues, ULONGLONG nMinimumDelay);
+
+	/**
+	 * @brief Hands out the next URL whose host may be fetched now.
+	 * @param[out] lpszURL The URL to fetch.
+	 * @param[out] nWait If nothing is ready, milliseconds until the next host is; otherwise 0.
+	 * @return true if a URL was handed out.
+	 */
+	bool Extract(std::string& lpszURL, ULONGLONG& nWait);
+
+	/**
+	 * @brief Marks the host of a URL handed out by Extract as idle again and adapts its rate.
+	 * @param lpszURL The URL that was fetched.
+	 * @param nFetchTime How long the fetch took, in milliseconds.
+	 * @param nOutcome How the fetch went.
+	 * @param nRetryAfter Milliseconds the server asked to wait before the next request; 0 if none.
+	 */
+	void Release(const std::string& lpszURL, ULONGLONG nFetchTime, Outcome nOutcome = Outcome::SKIPPED, ULONGLONG nRetryAfter = 0);
+
+	/**
+	 * @brief Sets the crawl-delay a host asks for in its robots.txt; it applies from
+	 *        the next Release. Hosts without a back queue are ignored.
+	 * @param lpszHost Host as returned by GetHost.
+	 * @param nDelay Delay between two fetches, in milliseconds.
+	 */
+	void SetHostDelay(const std::string& lpszHost, ULONGLONG nDelay);
+
+	/**
+	 * @brief Turns the delays between two fetches from a host on or off. A host still
+	 *        has one fetch in flight at most; delays are only turned off while responses
+	 *        are replayed from an archive, which puts no load on the hosts.
+	 */
+	void EnableDelays(bool bEnable) { m_bDelays = bEnable; }
+
+	/**
+	 * @brief Gives back a URL handed out by Extract that was not fetched; it goes
+	 *        to the head of its back queue and its host becomes idle again.
+	 */
+	void Return(const std::string& lpszURL);
+
+	/**
+	 * @brief Writes the URLs waiting in back queues to a checkpoint; they have
+	 *        already left the frontier. Must not be called while a fetch is in flight.
+	 */
+	bool Save(std::ostream& pStream) const;
+
+	/**
+	 * @brief Puts the URLs written by Save back into their back queues.
+	 * @return true if the URLs were restored; otherwise the back queues are left empty.
+	 */
+	bool Load(std::istream& pStream);
+
+	/**
+	 * @brief Checks whether both the front and the back queues are empty and no host is busy.
+	 */
+	bool IsEmpty() const;
+
+	/**
+	 * @brief Lists the hosts whose back queues wait for their next fetch, i.e. the hosts fetched next.
+	 */
+	void GetQueuedHosts(std::vector<std::string>& arrHosts) const;
+
+	/**
+	 * @brief Publishes back-queue statistics and the rate of every host holding a back queue.
+	 */
+	void ExportMetrics(CCrawlerMetrics& pMetrics) const;
+
+	/**
+	 * @brief Extracts the lowercase host (with port, if any) from an absolute URL.
+	 */
+	static std::string GetHost(const std::string& lpszURL);
+
+protected:
+	/// AIMD state of a host's fetch rate.
+	struct CHostRate
+	{
+		double m_rRate = 0.0;         ///< Fetches per second; 0 until the first release, meaning the ceiling
+		double m_rLatency = 0.0;      ///< Moving average of the fetch time, in milliseconds
+		ULONGLONG m_nDecreased = 0;   ///< Tick count of the last decrease
+	};
+
+	/// Per-host FIFO of URLs and its politeness state.
+	struct CBackQueue
+	{
+		std::deque<std::string> m_arrURLs;
+		ULONGLONG m_nNextFetch = 0;
+		ULONGLONG m_nHostDelay = 0;   ///< Crawl-delay from the host's robots.txt
+		CHostRate m_pRate;
+		bool m_bBusy = false;
+	};
+
+	/// Politeness state kept for a host after its back queue is gone.
+	struct CCooldown
+	{
+		ULONGLONG m_nNextFetch = 0;
+		CHostRate m_pRate;
+	};
+
+	/// Min-heap entry: a host and the time it may be fetched again.
+	typedef std::pair<ULONGLONG, std::string> CReadyHost;
+
+	void Refill();
+	ULONGLONG AdaptRate(CHostRate& pRate, ULONGLONG nFetchTime, Outcome nOutcome);
+	double GetMaximumRate() const;
+
+protected:
+	CUrlFrontier& m_pFrontier;
+	std::unordered_map<std::string, CBackQueue> m_mapBackQueues;
+	std::priority_queue<CReadyHost, std::vector<CReadyHost>, std::greater<CReadyHost>> m_heapReady;
+	std::unordered_map<std::string, CCooldown> m_mapCooldown; ///< Hosts without a back queue that still cool down or were slowed
+	size_t m_nBackQueues = 64;
+	ULONGLONG m_nMinimumDelay = 1000;
+	bool m_bDelays = true;
+	size_t m_nBusyHosts = 0;
+	size_t m_nBackQueued = 0; ///< URLs waiting in back queues
+};
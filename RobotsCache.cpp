@@ -0,0 +1,179 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file RobotsCache.cpp
+ * @brief Implements the per-site cache of robots.txt rules.
+ */
+
+#include "stdafx.h"
+#include "RobotsCache.h"
+#include "CrawlerMetrics.h"
+
+#define ROBOTS_AGENT "websearchengine"       // product token of the fetcher's user agent, lowercase
+#define ROBOTS_PATH "/robots.txt"
+#define ROBOTS_TTL (24 * 3600 * 1000ULL)     // RFC 9309: cached rules should not be used for more than a day
+#define ROBOTS_ERROR_TTL (3600 * 1000ULL)    // an unreachable robots.txt is retried after an hour
+
+CRobotsCache::CRobotsCache()
+{
+}
+
+CRobotsCache::~CRobotsCache()
+{
+}
+
+void CRobotsCache::Configure(size_t nCapacity)
+{
+	std::lock_guard<std::shared_mutex> lock(m_mutex);
+	m_nCapacity = std::max<size_t>(1, nCapacity);
+}
+
+std::string CRobotsCache::GetOrigin(const std::string& lpszURL)
+{
+	size_t nStart = lpszURL.find("://");
+	nStart = (nStart == std::string::npos) ? 0 : nStart + 3;
+	const size_t nEnd = lpszURL.find_first_of("/?#", nStart);
+	return lpszURL.substr(0, nEnd);
+}
+
+CRobotsCache::CEntryList::iterator CRobotsCache::FindLocked(const std::string& lpszOrigin)
+{
+	auto it = m_mapEntries.find(lpszOrigin);
+	if (it == m_mapEntries.end())
+	{
+		m_arrEntries.emplace_front();
+		m_arrEntries.front().m_strOrigin = lpszOrigin;
+		m_mapEntries.emplace(lpszOrigin, m_arrEntries.begin());
+		while (m_arrEntries.size() > m_nCapacity)
+		{
+			// a fetch still in flight for the evicted site is simply dropped by Complete
+			m_mapEntries.erase(m_arrEntries.back().m_strOrigin);
+			m_arrEntries.pop_back();
+			gCrawlerMetrics.AddCounter("robots_cache_evictions");
+		}
+		return m_arrEntries.begin();
+	}
+	m_arrEntries.splice(m_arrEntries.begin(), m_arrEntries, it->second);
+	return it->second;
+}
+
+CRobotsCache::Verdict CRobotsCache::Check(const std::string& lpszURL, unsigned int& nCrawlDelay, bool bFetch)
+{
+	nCrawlDelay = 0;
+	const std::string strOrigin = GetOrigin(lpszURL);
+	std::string_view strPath(lpszURL);
+	strPath = strPath.substr(strOrigin.length(), strPath.find('#') - strOrigin.length());
+	if (strPath == ROBOTS_PATH)
+		return Verdict::ALLOWED;
+
+	if (!bFetch)
+	{
+		// links are only checked against known rules: most linked sites are never crawled
+		std::shared_lock<std::shared_mutex> lock(m_mutex);
+		auto pFound = m_mapEntries.find(strOrigin);
+		if (pFound == m_mapEntries.end())
+			return Verdict::UNKNOWN;
+		return CheckRules(*pFound->second, strPath, nCrawlDelay);
+	}
+
+	std::lock_guard<std::shared_mutex> lock(m_mutex);
+	auto it = FindLocked(strOrigin);
+	if (!it->m_bFetching && (!it->m_bFetched || (it->m_nExpires <= ::GetTickCount64())))
+	{
+		it->m_bFetching = true;
+		m_arrFetches.push_back(strOrigin + ROBOTS_PATH);
+		gCrawlerMetrics.AddCounter(it->m_bFetched ? "robots_refreshes" : "robots_cache_misses");
+	}
+	return CheckRules(*it, strPath, nCrawlDelay);
+}
+
+CRobotsCache::Verdict CRobotsCache::CheckRules(const CEntry& pEntry, std::string_view lpszPath, unsigned int& nCrawlDelay)
+{
+	if (!pEntry.m_bFetched)
+		return Verdict::UNKNOWN;
+
+	nCrawlDelay = pEntry.m_pRules.GetCrawlDelay();
+	// a URL without a path, or with only a query, is checked as the root path
+	std::string strRoot;
+	if (lpszPath.empty() || (lpszPath[0] != '/'))
+	{
+		strRoot = "/" + std::string(lpszPath);
+		lpszPath = strRoot;
+	}
+	return pEntry.m_pRules.IsAllowed(lpszPath) ? Verdict::ALLOWED : Verdict::DISALLOWED;
+}
+
+bool CRobotsCache::TakeFetch(std::string& lpszRobotsURL)
+{
+	std::lock_guard<std::shared_mutex> lock(m_mutex);
+	if (m_arrFetches.empty())
+		return false;
+	lpszRobotsURL = std::move(m_arrFetches.front());
+	m_arrFetches.pop_front();
+	return true;
+}
+
+void CRobotsCache::Complete(const std::string& lpszRobotsURL, bool bReceived, DWORD nStatusCode, std::string_view pBody)
+{
+	// parsed before taking the lock: a robots.txt may be hundreds of kilobytes
+	CRobotsRules pRules;
+	ULONGLONG nTTL = ROBOTS_TTL;
+	bool bUsable = true;
+	if (bReceived && (nStatusCode >= 200) && (nStatusCode < 300))
+	{
+		pRules.Parse(pBody, ROBOTS_AGENT);
+		gCrawlerMetrics.AddCounter("robots_parsed");
+	}
+	else if (bReceived && (nStatusCode >= 300) && (nStatusCode < 500))
+	{
+		// no robots.txt, or too many redirects to one: no restrictions
+		pRules.AllowAll();
+		gCrawlerMetrics.AddCounter("robots_unavailable");
+	}
+	else
+	{
+		pRules.DisallowAll();
+		nTTL = ROBOTS_ERROR_TTL;
+		bUsable = false;
+		gCrawlerMetrics.AddCounter("robots_unreachable");
+	}
+
+	std::lock_guard<std::shared_mutex> lock(m_mutex);
+	auto pFound = m_mapEntries.find(GetOrigin(lpszRobotsURL));
+	if (pFound == m_mapEntries.end())
+		return; // evicted while it was being fetched
+	CEntry& pEntry = *pFound->second;
+	pEntry.m_bFetching = false;
+	pEntry.m_nExpires = ::GetTickCount64() + nTTL;
+	// a failed refresh keeps the previous rules until the next attempt
+	if (bUsable || !pEntry.m_bFetched)
+		pEntry.m_pRules = std::move(pRules);
+	pEntry.m_bFetched = true;
+}
+
+void CRobotsCache::Discard(const std::string& lpszRobotsURL)
+{
+	std::lock_guard<std::shared_mutex> lock(m_mutex);
+	auto pFound = m_mapEntries.find(GetOrigin(lpszRobotsURL));
+	if (pFound != m_mapEntries.end())
+		pFound->second->m_bFetching = false;
+}
+
+void CRobotsCache::ExportMetrics(CCrawlerMetrics& pMetrics) const
+{
+	std::shared_lock<std::shared_mutex> lock(m_mutex);
+	pMetrics.SetGauge("robots_cache_entries", static_cast<double>(m_arrEntries.size()));
+	pMetrics.SetGauge("robots_fetches_queued", static_cast<double>(m_arrFetches.size()));
+}
@@ -0,0 +1,122 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file RobotsCache.h
+ * @brief Declaration of the per-site cache of robots.txt rules.
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <list>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include "RobotsRules.h"
+
+class CCrawlerMetrics;
+
+/**
+ * @class CRobotsCache
+ * @brief Keeps the compiled robots.txt rules of the most recently crawled sites.
+ *
+ * Sites are keyed by origin (scheme, host and port) and kept in least recently
+ * used order up to a fixed capacity. The first check of a site queues the fetch
+ * of its robots.txt and reports the URL as unknown until Complete stores the
+ * rules; the crawler takes the queued fetches with TakeFetch. Rules expire after
+ * a day and are refetched, the old rules answering in the meantime. As RFC 9309
+ * asks, a missing robots.txt (4xx) allows everything and an unreachable one
+ * (5xx, network error) disallows everything until it is retried. Safe to use
+ * from any thread; checks that do not queue fetches only take a shared lock.
+ */
+class CRobotsCache
+{
+public:
+	enum class Verdict
+	{
+		ALLOWED,
+		DISALLOWED,
+		UNKNOWN
+	};
+
+	CRobotsCache();
+	~CRobotsCache();
+
+public:
+	/**
+	 * @brief Sets how many sites keep their rules in memory.
+	 */
+	void Configure(size_t nCapacity);
+
+	/**
+	 * @brief Checks a canonical URL against the rules of its site.
+	 * @param lpszURL Absolute URL.
+	 * @param[out] nCrawlDelay The site's crawl-delay in milliseconds, 0 if none or unknown.
+	 * @param bFetch true to queue the fetch of robots.txt if the site's rules are missing or stale.
+	 * @return UNKNOWN if the site's rules have not been fetched yet.
+	 */
+	Verdict Check(const std::string& lpszURL, unsigned int& nCrawlDelay, bool bFetch);
+
+	/**
+	 * @brief Takes the next robots.txt URL to fetch.
+	 * @return false if no fetch is queued.
+	 */
+	bool TakeFetch(std::string& lpszRobotsURL);
+
+	/**
+	 * @brief Stores the outcome of a robots.txt fetch.
+	 * @param lpszRobotsURL The URL given by TakeFetch.
+	 * @param bReceived false if no response was received.
+	 * @param nStatusCode HTTP status of the response.
+	 * @param pBody Body of the response.
+	 */
+	void Complete(const std::string& lpszRobotsURL, bool bReceived, DWORD nStatusCode, std::string_view pBody);
+
+	/**
+	 * @brief Forgets a fetch that was cancelled; the next check queues it again.
+	 */
+	void Discard(const std::string& lpszRobotsURL);
+
+	void ExportMetrics(CCrawlerMetrics& pMetrics) const;
+
+	/**
+	 * @brief Extracts the origin, "scheme://host[:port]", from an absolute URL.
+	 */
+	static std::string GetOrigin(const std::string& lpszURL);
+
+protected:
+	struct CEntry
+	{
+		std::string m_strOrigin;
+		CRobotsRules m_pRules;
+		ULONGLONG m_nExpires = 0;      ///< Tick count when the rules are refetched
+		bool m_bFetched = false;       ///< m_pRules holds the site's rules
+		bool m_bFetching = false;      ///< A fetch of robots.txt is queued or in flight
+	};
+
+	typedef std::list<CEntry> CEntryList;
+
+	CEntryList::iterator FindLocked(const std::string& lpszOrigin);
+	static Verdict CheckRules(const CEntry& pEntry, std::string_view lpszPath, unsigned int& nCrawlDelay);
+
+protected:
+	mutable std::shared_mutex m_mutex;
+	CEntryList m_arrEntries;                                            ///< Most recently used first
+	std::unordered_map<std::string, CEntryList::iterator> m_mapEntries; ///< Keyed by origin
+	std::deque<std::string> m_arrFetches;                               ///< robots.txt URLs to fetch
+	size_t m_nCapacity = 16384;
+};
@@ -0,0 +1,200 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file RobotsRules.cpp
+ * @brief Implements the robots.txt parser and rule matcher.
+ */
+
+#include "stdafx.h"
+#include "RobotsRules.h"
+#include <algorithm>
+
+#define ROBOTS_MAX_SIZE (500 * 1024)     // RFC 9309: parse at least the first 500 KiB
+#define ROBOTS_MAX_CRAWL_DELAY 60000     // milliseconds; longer delays would starve a host
+
+static std::string_view TrimRobotsField(std::string_view lpszField)
+{
+	const size_t nFirst = lpszField.find_first_not_of(" \t");
+	if (nFirst == std::string_view::npos)
+		return std::string_view();
+	const size_t nLast = lpszField.find_last_not_of(" \t\r");
+	return lpszField.substr(nFirst, nLast - nFirst + 1);
+}
+
+static bool IsRobotsKey(std::string_view lpszKey, std::string_view lpszName)
+{
+	return (lpszKey.length() == lpszName.length()) &&
+		std::equal(lpszKey.begin(), lpszKey.end(), lpszName.begin(),
+			[](char chKey, char chName) { return tolower(static_cast<unsigned char>(chKey)) == chName; });
+}
+
+CRobotsRules::CRobotsRules()
+{
+}
+
+CRobotsRules::~CRobotsRules()
+{
+}
+
+void CRobotsRules::Parse(std::string_view pContent, const std::string& lpszAgent)
+{
+	if (pContent.length() > ROBOTS_MAX_SIZE)
+		pContent = pContent.substr(0, ROBOTS_MAX_SIZE);
+
+	std::vector<CRule> arrAgentRules, arrDefaultRules;
+	double rAgentDelay = -1, rDefaultDelay = -1;
+	bool bAgentGroup = false, bDefaultGroup = false, bFoundAgent = false;
+	bool bInRules = true; // a user-agent line after rules starts a new group
+
+	size_t nStart = 0;
+	while (nStart < pContent.length())
+	{
+		size_t nEnd = pContent.find('\n', nStart);
+		if (nEnd == std::string_view::npos)
+			nEnd = pContent.length();
+		std::string_view strLine = pContent.substr(nStart, nEnd - nStart);
+		nStart = nEnd + 1;
+
+		const size_t nComment = strLine.find('#');
+		if (nComment != std::string_view::npos)
+			strLine = strLine.substr(0, nComment);
+		const size_t nColon = strLine.find(':');
+		if (nColon == std::string_view::npos)
+			continue;
+		const std::string_view strKey = TrimRobotsField(strLine.substr(0, nColon));
+		const std::string_view strValue = TrimRobotsField(strLine.substr(nColon + 1));
+
+		if (IsRobotsKey(strKey, "user-agent"))
+		{
+			if (bInRules)
+			{
+				bAgentGroup = bDefaultGroup = false;
+				bInRules = false;
+			}
+			// only the product token counts: "WebSearchEngine/1.0" names us too
+			const std::string_view strToken = strValue.substr(0, strValue.find_first_of("/ \t"));
+			if (strToken == "*")
+				bDefaultGroup = true;
+			else if (!strToken.empty() && IsRobotsKey(strToken, lpszAgent))
+				bAgentGroup = bFoundAgent = true;
+			continue;
+		}
+
+		const bool bAllow = IsRobotsKey(strKey, "allow");
+		const bool bDisallow = IsRobotsKey(strKey, "disallow");
+		const bool bCrawlDelay = IsRobotsKey(strKey, "crawl-delay");
+		if (!bAllow && !bDisallow && !bCrawlDelay)
+			continue; // sitemap and unknown records do not end the group
+		bInRules = true;
+		if (!bAgentGroup && !bDefaultGroup)
+			continue;
+
+		if (bCrawlDelay)
+		{
+			const double rDelay = atof(std::string(strValue).c_str());
+			if (bAgentGroup)
+				rAgentDelay = std::max(rAgentDelay, rDelay);
+			if (bDefaultGroup)
+				rDefaultDelay = std::max(rDefaultDelay, rDelay);
+			continue;
+		}
+		if (strValue.empty())
+			continue; // an empty disallow allows everything, which is the default
+
+		CRule pRule;
+		pRule.m_strPattern = ((strValue[0] == '/') || (strValue[0] == '*')) ? std::string(strValue) : "/" + std::string(strValue);
+		pRule.m_bAllow = bAllow;
+		pRule.m_bLiteral = (pRule.m_strPattern.find('*') == std::string::npos) && (pRule.m_strPattern.back() != '$');
+		if (bAgentGroup)
+			arrAgentRules.push_back(pRule);
+		if (bDefaultGroup)
+			arrDefaultRules.push_back(std::move(pRule));
+	}
+
+	m_arrRules = bFoundAgent ? std::move(arrAgentRules) : std::move(arrDefaultRules);
+	const double rDelay = bFoundAgent ? rAgentDelay : rDefaultDelay;
+	m_nCrawlDelay = (rDelay > 0) ? static_cast<unsigned int>(std::min(rDelay * 1000, static_cast<double>(ROBOTS_MAX_CRAWL_DELAY))) : 0;
+
+	// longest pattern first, allow first at equal length: the first match decides
+	std::stable_sort(m_arrRules.begin(), m_arrRules.end(), [](const CRule& pLeft, const CRule& pRight) {
+		if (pLeft.m_strPattern.length() != pRight.m_strPattern.length())
+			return pLeft.m_strPattern.length() > pRight.m_strPattern.length();
+		return pLeft.m_bAllow && !pRight.m_bAllow;
+	});
+}
+
+void CRobotsRules::AllowAll()
+{
+	m_arrRules.clear();
+	m_nCrawlDelay = 0;
+}
+
+void CRobotsRules::DisallowAll()
+{
+	CRule pRule;
+	pRule.m_strPattern = "/";
+	pRule.m_bLiteral = true;
+	m_arrRules.assign(1, pRule);
+	m_nCrawlDelay = 0;
+}
+
+bool CRobotsRules::IsAllowed(std::string_view lpszPath) const
+{
+	if (lpszPath.empty())
+		lpszPath = "/";
+	for (const CRule& pRule : m_arrRules)
+	{
+		const bool bMatch = pRule.m_bLiteral ? lpszPath.starts_with(pRule.m_strPattern) : MatchPattern(pRule.m_strPattern, lpszPath);
+		if (bMatch)
+			return pRule.m_bAllow;
+	}
+	return true;
+}
+
+bool CRobotsRules::MatchPattern(std::string_view lpszPattern, std::string_view lpszPath)
+{
+	const bool bAnchored = !lpszPattern.empty() && (lpszPattern.back() == '$');
+	if (bAnchored)
+		lpszPattern.remove_suffix(1);
+
+	// greedy glob with a single backtrack point: the last '*' seen
+	size_t nPattern = 0, nPath = 0;
+	size_t nStar = std::string_view::npos, nMark = 0;
+	while (nPath < lpszPath.length())
+	{
+		if ((nPattern < lpszPattern.length()) && (lpszPattern[nPattern] == '*'))
+		{
+			nStar = nPattern++;
+			nMark = nPath;
+		}
+		else if ((nPattern < lpszPattern.length()) && (lpszPattern[nPattern] == lpszPath[nPath]))
+		{
+			nPattern++;
+			nPath++;
+		}
+		else if ((nPattern == lpszPattern.length()) && !bAnchored)
+			return true; // rules match prefixes
+		else if (nStar != std::string_view::npos)
+		{
+			nPattern = nStar + 1;
+			nPath = ++nMark;
+		}
+		else
+			return false;
+	}
+	while ((nPattern < lpszPattern.length()) && (lpszPattern[nPattern] == '*'))
+		nPattern++;
+	return nPattern == lpszPattern.length();
+}
@@ -0,0 +1,86 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file RobotsRules.h
+ * @brief Declaration of the compiled allow/disallow rules of one robots.txt file.
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class CRobotsRules
+ * @brief The rules of a robots.txt file that apply to this crawler (RFC 9309).
+ *
+ * Parse keeps the groups whose user-agent line names this crawler's product
+ * token, or the "*" group if none does. The rules are compiled once: sorted by
+ * decreasing pattern length, allow before disallow at equal length, so the first
+ * rule that matches a path is the longest match and IsAllowed can stop there.
+ * Patterns without '*' or a trailing '$' are plain prefixes and are compared
+ * directly; the others go through a small wildcard matcher.
+ */
+class CRobotsRules
+{
+public:
+	CRobotsRules();
+	~CRobotsRules();
+
+public:
+	/**
+	 * @brief Compiles the rules of a robots.txt file.
+	 * @param pContent The file; only the first ROBOTS_MAX_SIZE bytes are read.
+	 * @param lpszAgent This crawler's product token in lowercase; user-agent lines are compared case-insensitively.
+	 */
+	void Parse(std::string_view pContent, const std::string& lpszAgent);
+
+	/**
+	 * @brief Rules for a site without a usable robots.txt (4xx): everything is allowed.
+	 */
+	void AllowAll();
+
+	/**
+	 * @brief Rules for a site whose robots.txt is unreachable (5xx, network error): nothing is allowed.
+	 */
+	void DisallowAll();
+
+	/**
+	 * @brief Checks a URL path, with its query, against the longest matching rule.
+	 */
+	bool IsAllowed(std::string_view lpszPath) const;
+
+	/**
+	 * @brief Crawl-delay of the selected group, in milliseconds; 0 if none.
+	 */
+	unsigned int GetCrawlDelay() const { return m_nCrawlDelay; }
+
+	size_t GetRuleCount() const { return m_arrRules.size(); }
+
+protected:
+	struct CRule
+	{
+		std::string m_strPattern;
+		bool m_bAllow = false;
+		bool m_bLiteral = false;     ///< No wildcard and no end anchor: a plain prefix
+	};
+
+	static bool MatchPattern(std::string_view lpszPattern, std::string_view lpszPath);
+
+protected:
+	std::vector<CRule> m_arrRules;
+	unsigned int m_nCrawlDelay = 0;
+};
@@ -0,0 +1,284 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file SpiderTrapDetector.cpp
+ * @brief Implements the spider-trap detector.
+ */
+
+#include "stdafx.h"
+#include "SpiderTrapDetector.h"
+#include "UrlCanonicalizer.h"
+#include "PolitenessScheduler.h"
+#include "CrawlerMetrics.h"
+#include "CrawlCheckpoint.h"
+
+#define TRAP_SHARDS 16                 // independent host shards, each with its own lock
+#define TRAP_FILTER_BYTES (1024 * 1024) // admitted URL filter per shard
+#define TRAP_FILTER_RATE 0.01
+#define MAX_SEGMENT_REPEAT 3           // occurrences of one path segment that mark a loop
+#define MAX_QUERY_PARAMETERS 12
+#define MAX_PATTERNS_PER_HOST 2048
+#define QUERY_BUDGET_DIVISOR 4         // patterns with a query get a quarter of the pattern budget
+
+CSpiderTrapDetector::CSpiderTrapDetector()
+	: m_arrShards(TRAP_SHARDS)
+{
+}
+
+CSpiderTrapDetector::~CSpiderTrapDetector()
+{
+}
+
+void CSpiderTrapDetector::Configure(unsigned int nHostBudget, unsigned int nPatternBudget, unsigned int nMaxDepth)
+{
+	m_nHostBudget = nHostBudget;
+	m_nPatternBudget = nPatternBudget;
+	m_nMaxDepth = nMaxDepth;
+	for (auto& pShard : m_arrShards)
+	{
+		std::lock_guard<std::mutex> lock(pShard.m_mutex);
+		if (!pShard.m_pAdmitted.IsCreated())
+			VERIFY(pShard.m_pAdmitted.Create(TRAP_FILTER_BYTES, TRAP_FILTER_RATE));
+	}
+}
+
+const char* CSpiderTrapDetector::GetVerdictName(Verdict nVerdict)
+{
+	switch (nVerdict)
+	{
+	case Verdict::ADMIT: return "admit";
+	case Verdict::DEPTH: return "depth";
+	case Verdict::REPEATED_SEGMENT: return "repeated_segment";
+	case Verdict::QUERY_PARAMETERS: return "query_parameters";
+	case Verdict::PATTERN_CARDINALITY: return "pattern_cardinality";
+	case Verdict::PATTERN_BUDGET: return "pattern_budget";
+	case Verdict::HOST_BUDGET: return "host_budget";
+	}
+	return "unknown";
+}
+
+bool CSpiderTrapDetector::IsIdentifier(const char* lpszSegment, size_t nLength)
+{
+	// session ids, hashes and similar tokens: long, alphanumeric, mixing digits and letters
+	if (nLength < 16)
+		return false;
+	bool bDigit = false, bAlpha = false;
+	for (size_t nIndex = 0; nIndex < nLength; nIndex++)
+	{
+		const unsigned char ch = static_cast<unsigned char>(lpszSegment[nIndex]);
+		if (isdigit(ch))
+			bDigit = true;
+		else if (isalpha(ch))
+			bAlpha = true;
+		else if ((ch != '-') && (ch != '_'))
+			return false;
+	}
+	return bDigit && bAlpha;
+}
+
+bool CSpiderTrapDetector::GetPattern(const std::string& lpszPath, std::string& strPattern, size_t& nDepth, size_t& nParameters)
+{
+	strPattern.clear();
+	nDepth = 0;
+	nParameters = 0;
+	const size_t nQuery = std::min(lpszPath.find('?'), lpszPath.length());
+
+	std::vector<std::pair<size_t, size_t>> arrSegments;
+	size_t nStart = 0;
+	while (nStart < nQuery)
+	{
+		if (lpszPath[nStart] == '/')
+		{
+			strPattern += '/';
+			nStart++;
+			continue;
+		}
+		size_t nEnd = std::min(lpszPath.find('/', nStart), nQuery);
+		const char* lpszSegment = lpszPath.data() + nStart;
+		const size_t nLength = nEnd - nStart;
+
+		size_t nRepeats = 1;
+		for (const auto& it : arrSegments)
+		{
+			if ((it.second == nLength) && (lpszPath.compare(it.first, nLength, lpszSegment, nLength) == 0))
+				nRepeats++;
+		}
+		if (nRepeats >= MAX_SEGMENT_REPEAT)
+			return false;
+		arrSegments.emplace_back(nStart, nLength);
+		nDepth++;
+
+		if (IsIdentifier(lpszSegment, nLength))
+			strPattern += '*';
+		else
+		{
+			for (size_t nIndex = 0; nIndex < nLength; nIndex++)
+			{
+				if (!isdigit(static_cast<unsigned char>(lpszSegment[nIndex])))
+					strPattern += lpszSegment[nIndex];
+				else if ((nIndex == 0) || !isdigit(static_cast<unsigned char>(lpszSegment[nIndex - 1])))
+					strPattern += '#';
+			}
+		}
+		nStart = nEnd;
+	}
+
+	// the parameter names, in the order the canonicalizer sorted them
+	for (size_t nName = nQuery + 1; nName < lpszPath.length();)
+	{
+		size_t nEnd = lpszPath.find('&', nName);
+		if (nEnd == std::string::npos)
+			nEnd = lpszPath.length();
+		const size_t nValue = std::min(lpszPath.find('=', nName), nEnd);
+		strPattern += (nParameters == 0) ? '?' : '&';
+		strPattern.append(lpszPath, nName, nValue - nName);
+		nParameters++;
+		nName = nEnd + 1;
+	}
+	return true;
+}
+
+CSpiderTrapDetector::Verdict CSpiderTrapDetector::Check(const std::string& lpszCanonicalURL)
+{
+	size_t nPath = lpszCanonicalURL.find("://");
+	nPath = lpszCanonicalURL.find_first_of("/?", (nPath == std::string::npos) ? 0 : nPath + 3);
+	const std::string strPath = (nPath == std::string::npos) ? "/" :
+		((lpszCanonicalURL[nPath] == '?') ? "/" + lpszCanonicalURL.substr(nPath) : lpszCanonicalURL.substr(nPath));
+
+	std::string strPattern;
+	size_t nDepth = 0, nParameters = 0;
+	if (!GetPattern(strPath, strPattern, nDepth, nParameters))
+		return Verdict::REPEATED_SEGMENT;
+	if ((m_nMaxDepth > 0) && (nDepth > m_nMaxDepth))
+		return Verdict::DEPTH;
+	if (nParameters > MAX_QUERY_PARAMETERS)
+		return Verdict::QUERY_PARAMETERS;
+
+	const std::string strHost = CPolitenessScheduler::GetHost(lpszCanonicalURL);
+	CShard& pShard = m_arrShards[CBloomFilter::Hash(strHost) % m_arrShards.size()];
+	const unsigned __int64 nFingerprint = CUrlCanonicalizer::Fingerprint(lpszCanonicalURL);
+
+	std::lock_guard<std::mutex> lock(pShard.m_mutex);
+	if (pShard.m_pAdmitted.IsCreated() && pShard.m_pAdmitted.ContainsHash(nFingerprint))
+		return Verdict::ADMIT; // already charged; the frontier takes care of duplicates
+
+	CHostState& pHost = pShard.m_mapHosts[strHost];
+	if ((m_nHostBudget > 0) && (pHost.m_nURLs >= m_nHostBudget))
+		return Verdict::HOST_BUDGET;
+
+	auto it = pHost.m_mapPatterns.find(strPattern);
+	if (it == pHost.m_mapPatterns.end())
+	{
+		if (pHost.m_mapPatterns.size() >= MAX_PATTERNS_PER_HOST)
+			return Verdict::PATTERN_CARDINALITY;
+		it = pHost.m_mapPatterns.emplace(strPattern, 0).first;
+	}
+	const unsigned int nBudget = (nParameters > 0) ? std::max(1u, m_nPatternBudget / QUERY_BUDGET_DIVISOR) : m_nPatternBudget;
+	if ((m_nPatternBudget > 0) && (it->second >= nBudget))
+		return Verdict::PATTERN_BUDGET;
+
+	it->second++;
+	pHost.m_nURLs++;
+	if (pShard.m_pAdmitted.IsCreated())
+		pShard.m_pAdmitted.InsertHash(nFingerprint);
+	return Verdict::ADMIT;
+}
+
+void CSpiderTrapDetector::Clear()
+{
+	for (auto& pShard : m_arrShards)
+	{
+		std::lock_guard<std::mutex> lock(pShard.m_mutex);
+		pShard.m_pAdmitted = CBloomFilter();
+		pShard.m_mapHosts.clear();
+	}
+}
+
+bool CSpiderTrapDetector::Save(std::ostream& pStream)
+{
+	WriteCheckpointValue(pStream, static_cast<unsigned int>(m_arrShards.size()));
+	for (auto& pShard : m_arrShards)
+	{
+		std::lock_guard<std::mutex> lock(pShard.m_mutex);
+		const unsigned char nFilter = pShard.m_pAdmitted.IsCreated() ? 1 : 0;
+		WriteCheckpointValue(pStream, nFilter);
+		if (nFilter != 0)
+			pShard.m_pAdmitted.Save(pStream);
+		WriteCheckpointValue(pStream, static_cast<unsigned __int64>(pShard.m_mapHosts.size()));
+		for (const auto& itHost : pShard.m_mapHosts)
+		{
+			WriteCheckpointString(pStream, itHost.first);
+			WriteCheckpointValue(pStream, itHost.second.m_nURLs);
+			WriteCheckpointValue(pStream, static_cast<unsigned int>(itHost.second.m_mapPatterns.size()));
+			for (const auto& itPattern : itHost.second.m_mapPatterns)
+			{
+				WriteCheckpointString(pStream, itPattern.first);
+				WriteCheckpointValue(pStream, itPattern.second);
+			}
+		}
+	}
+	return pStream.good();
+}
+
+bool CSpiderTrapDetector::Load(std::istream& pStream)
+{
+	Clear();
+	unsigned int nShards = 0;
+	if (!ReadCheckpointValue(pStream, nShards) || (nShards != m_arrShards.size()))
+		return false;
+	for (auto& pShard : m_arrShards)
+	{
+		std::lock_guard<std::mutex> lock(pShard.m_mutex);
+		unsigned char nFilter = 0;
+		unsigned __int64 nHosts = 0;
+		// a host takes at least its name length and two counts, a pattern its length and count
+		if (!ReadCheckpointValue(pStream, nFilter) || ((nFilter != 0) && !pShard.m_pAdmitted.Load(pStream)) ||
+			!ReadCheckpointValue(pStream, nHosts) || !IsCheckpointCountValid(pStream, nHosts, 3 * sizeof(unsigned int)))
+			return false;
+		for (unsigned __int64 nHost = 0; nHost < nHosts; nHost++)
+		{
+			std::string strHost;
+			unsigned int nURLs = 0, nPatterns = 0;
+			if (!ReadCheckpointString(pStream, strHost) || !ReadCheckpointValue(pStream, nURLs) ||
+				!ReadCheckpointValue(pStream, nPatterns) || !IsCheckpointCountValid(pStream, nPatterns, 2 * sizeof(unsigned int)))
+				return false;
+			CHostState& pHost = pShard.m_mapHosts[strHost];
+			pHost.m_nURLs = nURLs;
+			for (unsigned int nPattern = 0; nPattern < nPatterns; nPattern++)
+			{
+				std::string strPattern;
+				unsigned int nCount = 0;
+				if (!ReadCheckpointString(pStream, strPattern) || !ReadCheckpointValue(pStream, nCount))
+					return false;
+				pHost.m_mapPatterns[strPattern] = nCount;
+			}
+		}
+	}
+	return true;
+}
+
+void CSpiderTrapDetector::ExportMetrics(CCrawlerMetrics& pMetrics)
+{
+	size_t nHosts = 0, nPatterns = 0;
+	for (auto& pShard : m_arrShards)
+	{
+		std::lock_guard<std::mutex> lock(pShard.m_mutex);
+		nHosts += pShard.m_mapHosts.size();
+		for (const auto& it : pShard.m_mapHosts)
+			nPatterns += it.second.m_mapPatterns.size();
+	}
+	pMetrics.SetGauge("trap_detector_hosts", static_cast<double>(nHosts));
+	pMetrics.SetGauge("trap_detector_patterns", static_cast<double>(nPatterns));
+}
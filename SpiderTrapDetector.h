@@ -0,0 +1,124 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file SpiderTrapDetector.h
+ * @brief Declaration of the filter that keeps calendars, faceted navigation and
+ *        other near-infinite URL spaces out of the frontier.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+#include <iostream>
+#include "BloomFilter.h"
+
+class CCrawlerMetrics;
+
+/**
+ * @class CSpiderTrapDetector
+ * @brief Decides whether a newly discovered canonical URL may enter the frontier.
+ *
+ * Each URL is reduced to a pattern: its path with digit runs replaced by '#' and
+ * identifier-like segments by '*', followed by the names of its query parameters.
+ * "/events/2031/07/14?view" and "/events/2031/07/15?view" share the pattern
+ * "/events/#/#/#?view". A URL is rejected when
+ * - its path is deeper than the depth limit,
+ * - one path segment occurs three times or more ("/a/b/a/b/a/b"),
+ * - it has too many query parameters,
+ * - its host has already produced too many different patterns,
+ * - its pattern has used up its budget of distinct URLs (smaller with a query), or
+ * - its host has used up its budget of distinct URLs.
+ *
+ * Budgets count distinct URLs: an admitted URL is remembered in a Bloom filter, so
+ * further links to it pass without being counted again. State is split into
+ * shards by host, so crawler threads checking different hosts rarely contend.
+ */
+class CSpiderTrapDetector
+{
+public:
+	enum class Verdict
+	{
+		ADMIT,
+		DEPTH,
+		REPEATED_SEGMENT,
+		QUERY_PARAMETERS,
+		PATTERN_CARDINALITY,
+		PATTERN_BUDGET,
+		HOST_BUDGET
+	};
+
+	CSpiderTrapDetector();
+	~CSpiderTrapDetector();
+
+public:
+	/**
+	 * @brief Sets the limits, and allocates the filters of admitted URLs unless a checkpoint restored them.
+	 * @param nHostBudget Distinct URLs admitted per host.
+	 * @param nPatternBudget Distinct URLs admitted per host and pattern.
+	 * @param nMaxDepth Maximum number of path segments.
+	 */
+	void Configure(unsigned int nHostBudget, unsigned int nPatternBudget, unsigned int nMaxDepth);
+
+	/**
+	 * @brief Checks a canonical URL and, if it is admitted, charges it to its host and pattern budgets.
+	 *        Safe to call from any thread.
+	 */
+	Verdict Check(const std::string& lpszCanonicalURL);
+
+	/**
+	 * @brief Short name of a verdict, used in metric names.
+	 */
+	static const char* GetVerdictName(Verdict nVerdict);
+
+	/**
+	 * @brief Computes the pattern of a URL path and query, as described above.
+	 * @param lpszPath Path and query of a canonical URL, starting with '/'.
+	 * @param[out] strPattern The pattern.
+	 * @param[out] nDepth Number of path segments.
+	 * @param[out] nParameters Number of query parameters.
+	 * @return false if a path segment repeats too often.
+	 */
+	static bool GetPattern(const std::string& lpszPath, std::string& strPattern, size_t& nDepth, size_t& nParameters);
+
+	void Clear();
+	bool Save(std::ostream& pStream);
+	bool Load(std::istream& pStream);
+	void ExportMetrics(CCrawlerMetrics& pMetrics);
+
+protected:
+	struct CHostState
+	{
+		unsigned int m_nURLs = 0;
+		std::unordered_map<std::string, unsigned int> m_mapPatterns; ///< Distinct URLs admitted per pattern
+	};
+
+	struct CShard
+	{
+		std::mutex m_mutex;
+		CBloomFilter m_pAdmitted;                                    ///< URLs already charged to a budget
+		std::unordered_map<std::string, CHostState> m_mapHosts;
+	};
+
+	static bool IsIdentifier(const char* lpszSegment, size_t nLength);
+
+protected:
+	std::vector<CShard> m_arrShards;
+	unsigned int m_nHostBudget = 0;
+	unsigned int m_nPatternBudget = 0;
+	unsigned int m_nMaxDepth = 0;
+};
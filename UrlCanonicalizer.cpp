@@ -0,0 +1,281 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file UrlCanonicalizer.cpp
+ * @brief Implements URL canonicalization and fingerprinting.
+ */
+
+#include "stdafx.h"
+#include "UrlCanonicalizer.h"
+#include "BloomFilter.h"
+#include <vector>
+#include <algorithm>
+
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+static int HexValue(char ch)
+{
+	if ((ch >= '0') && (ch <= '9'))
+		return ch - '0';
+	if ((ch >= 'A') && (ch <= 'F'))
+		return ch - 'A' + 10;
+	if ((ch >= 'a') && (ch <= 'f'))
+		return ch - 'a' + 10;
+	return -1;
+}
+
+static std::string ToLower(std::string strText)
+{
+	std::transform(strText.begin(), strText.end(), strText.begin(),
+		[](char ch) { return (char)tolower((unsigned char)ch); });
+	return strText;
+}
+
+bool CUrlCanonicalizer::IsUnreserved(char ch)
+{
+	return isalnum((unsigned char)ch) || (ch == '-') || (ch == '.') || (ch == '_') || (ch == '~');
+}
+
+void CUrlCanonicalizer::AppendEncoded(std::string& strOutput, const char* lpszInput, size_t nLength)
+{
+	for (size_t nIndex = 0; nIndex < nLength; nIndex++)
+	{
+		const char ch = lpszInput[nIndex];
+		if (ch == '%')
+		{
+			const int nFirst = (nIndex + 1 < nLength) ? HexValue(lpszInput[nIndex + 1]) : -1;
+			const int nSecond = (nIndex + 2 < nLength) ? HexValue(lpszInput[nIndex + 2]) : -1;
+			if ((nFirst < 0) || (nSecond < 0))
+			{
+				strOutput += "%25"; // a stray percent sign
+				continue;
+			}
+			const char chDecoded = (char)((nFirst << 4) | nSecond);
+			if (IsUnreserved(chDecoded))
+				strOutput += chDecoded;
+			else
+			{
+				strOutput += '%';
+				strOutput += HEX_DIGITS[nFirst];
+				strOutput += HEX_DIGITS[nSecond];
+			}
+			nIndex += 2;
+			continue;
+		}
+
+		const unsigned char nByte = (unsigned char)ch;
+		if ((nByte <= 0x20) || (nByte >= 0x7F) || (strchr("\"<>\\^`{|}", ch) != nullptr))
+		{
+			strOutput += '%';
+			strOutput += HEX_DIGITS[nByte >> 4];
+			strOutput += HEX_DIGITS[nByte & 0x0F];
+		}
+		else
+			strOutput += ch;
+	}
+}
+
+std::string CUrlCanonicalizer::RemoveDotSegments(const std::string& lpszPath)
+{
+	std::vector<std::string> arrSegments;
+	bool bDirectory = false;
+	size_t nStart = 1; // the path always starts with '/'
+	while (nStart <= lpszPath.length())
+	{
+		size_t nEnd = lpszPath.find('/', nStart);
+		if (nEnd == std::string::npos)
+			nEnd = lpszPath.length();
+		const std::string strSegment = lpszPath.substr(nStart, nEnd - nStart);
+		bDirectory = false;
+		if (strSegment == ".")
+			bDirectory = true;
+		else if (strSegment == "..")
+		{
+			if (!arrSegments.empty())
+				arrSegments.pop_back();
+			bDirectory = true;
+		}
+		else
+			arrSegments.push_back(strSegment);
+		nStart = nEnd + 1;
+	}
+
+	std::string strPath;
+	for (const auto& strSegment : arrSegments)
+	{
+		strPath += '/';
+		strPath += strSegment;
+	}
+	if (bDirectory || strPath.empty())
+		strPath += '/';
+	return strPath;
+}
+
+bool CUrlCanonicalizer::IsTrackingParameter(const std::string& lpszName)
+{
+	static const char* const arrTracking[] = {
+		"gclid", "gclsrc", "dclid", "fbclid", "msclkid", "yclid", "igshid", "mc_cid", "mc_eid",
+		"_ga", "_gl", "jsessionid", "phpsessid", "aspsessionid", "cfid", "cftoken",
+	};
+	const std::string strName = ToLower(lpszName);
+	if (strName.rfind("utm_", 0) == 0)
+		return true;
+	for (const char* lpszTracking : arrTracking)
+	{
+		if (strName == lpszTracking)
+			return true;
+	}
+	return false;
+}
+
+bool CUrlCanonicalizer::Canonicalize(const std::string& lpszURL, std::string& strCanonical)
+{
+	strCanonical = "";
+
+	// surrounding blanks are dropped and tabs or line breaks inside the URL ignored
+	std::string strURL;
+	strURL.reserve(lpszURL.length());
+	for (const char ch : lpszURL)
+	{
+		if ((ch != '\t') && (ch != '\r') && (ch != '\n'))
+			strURL += ch;
+	}
+	const size_t nFirst = strURL.find_first_not_of(' ');
+	if (nFirst == std::string::npos)
+		return false;
+	strURL = strURL.substr(nFirst, strURL.find_last_not_of(' ') - nFirst + 1);
+
+	const size_t nSchemeEnd = strURL.find("://");
+	if ((nSchemeEnd == std::string::npos) || (nSchemeEnd == 0))
+		return false;
+	const std::string strScheme = ToLower(strURL.substr(0, nSchemeEnd));
+	if ((strScheme != "http") && (strScheme != "https"))
+		return false;
+
+	const size_t nAuthority = nSchemeEnd + 3;
+	size_t nAuthorityEnd = strURL.find_first_of("/?#", nAuthority);
+	if (nAuthorityEnd == std::string::npos)
+		nAuthorityEnd = strURL.length();
+	std::string strAuthority = strURL.substr(nAuthority, nAuthorityEnd - nAuthority);
+
+	std::string strUserInfo;
+	const size_t nUser = strAuthority.rfind('@');
+	if (nUser != std::string::npos)
+	{
+		strUserInfo = strAuthority.substr(0, nUser + 1);
+		strAuthority.erase(0, nUser + 1);
+	}
+
+	std::string strHost = strAuthority;
+	std::string strPort;
+	const size_t nBracket = strAuthority.find(']');
+	const size_t nColon = strAuthority.rfind(':');
+	if ((nColon != std::string::npos) && ((nBracket == std::string::npos) || (nColon > nBracket)))
+	{
+		strHost = strAuthority.substr(0, nColon);
+		strPort = strAuthority.substr(nColon + 1);
+	}
+	strHost = ToLower(strHost);
+	while (!strHost.empty() && (strHost.back() == '.'))
+		strHost.pop_back();
+	if (strHost.empty())
+		return false;
+	for (const char ch : strHost)
+	{
+		if (((unsigned char)ch <= 0x20) || (strchr("\"<>\\^`{|}/?#@", ch) != nullptr))
+			return false;
+	}
+
+	if (!strPort.empty())
+	{
+		if (strPort.find_first_not_of("0123456789") != std::string::npos)
+			return false;
+		strPort.erase(0, std::min(strPort.find_first_not_of('0'), strPort.length() - 1));
+		if ((strPort.length() > 5) || (std::stoul(strPort) > 65535))
+			return false;
+		if (((strScheme == "http") && (strPort == "80")) || ((strScheme == "https") && (strPort == "443")))
+			strPort = "";
+	}
+
+	// path and query, without the fragment
+	size_t nFragment = strURL.find('#', nAuthorityEnd);
+	if (nFragment == std::string::npos)
+		nFragment = strURL.length();
+	size_t nQuery = strURL.find('?', nAuthorityEnd);
+	if ((nQuery == std::string::npos) || (nQuery > nFragment))
+		nQuery = nFragment;
+
+	std::string strPath;
+	AppendEncoded(strPath, strURL.data() + nAuthorityEnd, nQuery - nAuthorityEnd);
+	if (strPath.empty())
+		strPath = "/";
+	const size_t nSession = ToLower(strPath).find(";jsessionid=");
+	if (nSession != std::string::npos)
+	{
+		const size_t nSessionEnd = strPath.find('/', nSession);
+		strPath.erase(nSession, (nSessionEnd == std::string::npos) ? std::string::npos : nSessionEnd - nSession);
+	}
+	strPath = RemoveDotSegments(strPath);
+
+	std::vector<std::string> arrParameters;
+	if (nQuery < nFragment)
+	{
+		std::string strQuery;
+		AppendEncoded(strQuery, strURL.data() + nQuery + 1, nFragment - nQuery - 1);
+		size_t nStart = 0;
+		while (nStart <= strQuery.length())
+		{
+			size_t nEnd = strQuery.find('&', nStart);
+			if (nEnd == std::string::npos)
+				nEnd = strQuery.length();
+			std::string strParameter = strQuery.substr(nStart, nEnd - nStart);
+			if (!strParameter.empty() && !IsTrackingParameter(strParameter.substr(0, strParameter.find('='))))
+				arrParameters.push_back(std::move(strParameter));
+			nStart = nEnd + 1;
+		}
+		// equal names keep their relative order, since servers may read them as a list
+		std::stable_sort(arrParameters.begin(), arrParameters.end(), [](const std::string& strFirst, const std::string& strSecond) {
+			return strFirst.substr(0, strFirst.find('=')) < strSecond.substr(0, strSecond.find('='));
+			});
+	}
+
+	strCanonical.reserve(strURL.length());
+	strCanonical = strScheme + "://" + strUserInfo + strHost;
+	if (!strPort.empty())
+		strCanonical += ":" + strPort;
+	strCanonical += strPath;
+	for (size_t nIndex = 0; nIndex < arrParameters.size(); nIndex++)
+	{
+		strCanonical += (nIndex == 0) ? '?' : '&';
+		strCanonical += arrParameters[nIndex];
+	}
+	return true;
+}
+
+unsigned __int64 CUrlCanonicalizer::Fingerprint(const std::string& lpszCanonicalURL)
+{
+	const size_t nAuthority = lpszCanonicalURL.find("://");
+	const size_t nPath = lpszCanonicalURL.find('/', (nAuthority == std::string::npos) ? 0 : nAuthority + 3);
+	size_t nQuery = lpszCanonicalURL.find('?');
+	if (nQuery == std::string::npos)
+		nQuery = lpszCanonicalURL.length();
+	if ((nPath != std::string::npos) && (nQuery > nPath + 1) && (lpszCanonicalURL[nQuery - 1] == '/'))
+	{
+		std::string strKey = lpszCanonicalURL;
+		strKey.erase(nQuery - 1, 1);
+		return CBloomFilter::Hash(strKey);
+	}
+	return CBloomFilter::Hash(lpszCanonicalURL);
+}
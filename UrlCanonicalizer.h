@@ -0,0 +1,60 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file UrlCanonicalizer.h
+ * @brief Declaration of the URL canonicalizer that maps the many spellings
+ *        of a page address to one form and a 64-bit fingerprint.
+ */
+
+#pragma once
+
+#include <string>
+
+/**
+ * @class CUrlCanonicalizer
+ * @brief Rewrites absolute http/https URLs into a canonical form.
+ *
+ * The canonical form has a lowercase scheme and host, no default port, no
+ * fragment, decoded unreserved characters and uppercase percent escapes, no
+ * "." or ".." path segments, no session id path parameter, and a query without
+ * tracking parameters whose remaining parameters are sorted by name. Everything
+ * that may change which resource the server returns is left alone.
+ */
+class CUrlCanonicalizer
+{
+public:
+	/**
+	 * @brief Canonicalizes an absolute URL.
+	 * @param lpszURL The URL to canonicalize.
+	 * @param[out] strCanonical The canonical URL.
+	 * @return false if the URL is not a well-formed http or https URL.
+	 */
+	static bool Canonicalize(const std::string& lpszURL, std::string& strCanonical);
+
+	/**
+	 * @brief Computes the 64-bit fingerprint of a canonical URL.
+	 *
+	 * A trailing slash on a non-root path does not take part in the fingerprint,
+	 * so "/dir" and "/dir/" are the same page; the slash is kept in the URL itself
+	 * because relative links on the page are resolved against it.
+	 */
+	static unsigned __int64 Fingerprint(const std::string& lpszCanonicalURL);
+
+protected:
+	static bool IsUnreserved(char ch);
+	static void AppendEncoded(std::string& strOutput, const char* lpszInput, size_t nLength);
+	static std::string RemoveDotSegments(const std::string& lpszPath);
+	static bool IsTrackingParameter(const std::string& lpszName);
+};
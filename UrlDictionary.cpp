@@ -0,0 +1,338 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file UrlDictionary.cpp
+ * @brief Implements the front-coded URL dictionary.
+ *
+ * Entry layout: varint shared prefix length (always 0 for a block head), varint
+ * suffix length, the suffix bytes, varint ID.
+ */
+
+#include "stdafx.h"
+#include "UrlDictionary.h"
+#include "CrawlerMetrics.h"
+#include <algorithm>
+
+#define URL_BLOCK_SIZE 16          // entries per front-coded block
+#define URL_PENDING_MINIMUM 4096   // buffered URLs always allowed before a merge
+#define URL_PENDING_RATIO 8        // merge once the buffer holds 1/8 of the blocked URLs
+#define URL_ID_RATIO 2             // loaded IDs may reach this multiple of the URL count, as IDs are dense
+
+static const char DICTIONARY_MAGIC[8] = { 'W', 'S', 'E', 'U', 'R', 'L', 'D', 'C' };
+static const unsigned int DICTIONARY_VERSION = 1;
+
+static void AppendVarint(std::vector<char>& arrData, unsigned __int64 nValue)
+{
+	while (nValue >= 0x80)
+	{
+		arrData.push_back(static_cast<char>((nValue & 0x7F) | 0x80));
+		nValue >>= 7;
+	}
+	arrData.push_back(static_cast<char>(nValue));
+}
+
+/// Bytes between the read position and the end of the stream, 0 if the stream cannot seek.
+static unsigned __int64 GetRemainingBytes(std::istream& pStream)
+{
+	const std::streampos nPosition = pStream.tellg();
+	if (nPosition < 0)
+		return 0;
+	pStream.seekg(0, std::ios::end);
+	const std::streampos nEnd = pStream.tellg();
+	pStream.seekg(nPosition);
+	if (!pStream.good() || (nEnd < nPosition))
+		return 0;
+	return static_cast<unsigned __int64>(nEnd - nPosition);
+}
+
+static bool ReadVarint(const std::vector<char>& arrData, size_t& nOffset, unsigned __int64& nValue)
+{
+	nValue = 0;
+	for (int nShift = 0; (nShift < 64) && (nOffset < arrData.size()); nShift += 7)
+	{
+		const unsigned char nByte = static_cast<unsigned char>(arrData[nOffset++]);
+		nValue |= static_cast<unsigned __int64>(nByte & 0x7F) << nShift;
+		if ((nByte & 0x80) == 0)
+			return true;
+	}
+	return false;
+}
+
+bool CUrlDictionary::CBlockReader::Next(std::string& strURL, __int64& nID)
+{
+	unsigned __int64 nShared = 0, nSuffix = 0, nValue = 0;
+	if (!ReadVarint(m_arrData, m_nOffset, nShared) || !ReadVarint(m_arrData, m_nOffset, nSuffix) ||
+		(nShared > strURL.length()) || (nSuffix > m_arrData.size() - m_nOffset))
+		return false;
+	strURL.resize(static_cast<size_t>(nShared));
+	strURL.append(m_arrData.data() + m_nOffset, static_cast<size_t>(nSuffix));
+	m_nOffset += static_cast<size_t>(nSuffix);
+	if (!ReadVarint(m_arrData, m_nOffset, nValue))
+		return false;
+	nID = static_cast<__int64>(nValue);
+	return true;
+}
+
+CUrlDictionary::CUrlDictionary()
+{
+}
+
+CUrlDictionary::~CUrlDictionary()
+{
+}
+
+void CUrlDictionary::AppendEntry(std::vector<char>& arrData, const std::string& lpszPrevious, const std::string& lpszURL, __int64 nID, bool bBlockHead)
+{
+	size_t nShared = 0;
+	if (!bBlockHead)
+	{
+		const size_t nLimit = std::min(lpszPrevious.length(), lpszURL.length());
+		while ((nShared < nLimit) && (lpszPrevious[nShared] == lpszURL[nShared]))
+			nShared++;
+	}
+	AppendVarint(arrData, nShared);
+	AppendVarint(arrData, lpszURL.length() - nShared);
+	arrData.insert(arrData.end(), lpszURL.begin() + nShared, lpszURL.end());
+	AppendVarint(arrData, static_cast<unsigned __int64>(nID));
+}
+
+bool CUrlDictionary::Insert(const std::string& lpszURL, __int64 nID)
+{
+	if ((nID < 0) || Contains(lpszURL))
+		return false;
+
+	auto it = m_mapPending.emplace(lpszURL, nID).first;
+	m_mapPendingByID[nID] = &it->first;
+	if (m_mapPending.size() >= std::max<size_t>(URL_PENDING_MINIMUM, m_nBlockedCount / URL_PENDING_RATIO))
+		Merge();
+	return true;
+}
+
+size_t CUrlDictionary::FindBlock(const std::string& lpszURL) const
+{
+	// last block whose head is not greater than the URL; block heads are stored in full
+	size_t nLow = 0, nHigh = m_arrBlocks.size();
+	std::string strHead;
+	__int64 nID = 0;
+	while (nHigh - nLow > 1)
+	{
+		const size_t nMiddle = nLow + (nHigh - nLow) / 2;
+		CBlockReader pReader(m_arrData, m_arrBlocks[nMiddle]);
+		strHead.clear();
+		pReader.Next(strHead, nID);
+		if (strHead.compare(lpszURL) <= 0)
+			nLow = nMiddle;
+		else
+			nHigh = nMiddle;
+	}
+	return nLow;
+}
+
+bool CUrlDictionary::Lookup(const std::string& lpszURL, __int64& nID) const
+{
+	const auto it = m_mapPending.find(lpszURL);
+	if (it != m_mapPending.end())
+	{
+		nID = it->second;
+		return true;
+	}
+	if (m_arrBlocks.empty())
+		return false;
+
+	const size_t nBlock = FindBlock(lpszURL);
+	CBlockReader pReader(m_arrData, m_arrBlocks[nBlock]);
+	const size_t nEntries = std::min<size_t>(URL_BLOCK_SIZE, m_nBlockedCount - nBlock * URL_BLOCK_SIZE);
+	std::string strURL;
+	__int64 nEntryID = 0;
+	for (size_t nIndex = 0; (nIndex < nEntries) && pReader.Next(strURL, nEntryID); nIndex++)
+	{
+		const int nCompare = strURL.compare(lpszURL);
+		if (nCompare == 0)
+		{
+			nID = nEntryID;
+			return true;
+		}
+		if (nCompare > 0)
+			break;
+	}
+	return false;
+}
+
+bool CUrlDictionary::GetURL(__int64 nID, std::string& strURL) const
+{
+	const auto it = m_mapPendingByID.find(nID);
+	if (it != m_mapPendingByID.end())
+	{
+		strURL = *it->second;
+		return true;
+	}
+	if ((nID < 0) || (static_cast<unsigned __int64>(nID) >= m_arrRankByID.size()) || (m_arrRankByID[static_cast<size_t>(nID)] == 0))
+		return false;
+
+	const size_t nRank = m_arrRankByID[static_cast<size_t>(nID)] - 1;
+	CBlockReader pReader(m_arrData, m_arrBlocks[nRank / URL_BLOCK_SIZE]);
+	strURL.clear();
+	__int64 nEntryID = 0;
+	for (size_t nIndex = 0; nIndex <= nRank % URL_BLOCK_SIZE; nIndex++)
+	{
+		if (!pReader.Next(strURL, nEntryID))
+			return false;
+	}
+	return true;
+}
+
+void CUrlDictionary::Merge()
+{
+	if (m_mapPending.empty())
+		return;
+
+	std::vector<char> arrData;
+	arrData.reserve(m_arrData.size() + m_arrData.size() / URL_PENDING_RATIO + m_mapPending.size() * 32);
+	std::vector<size_t> arrBlocks;
+	arrBlocks.reserve((GetCount() + URL_BLOCK_SIZE - 1) / URL_BLOCK_SIZE);
+
+	CBlockReader pReader(m_arrData, 0);
+	std::string strBlocked, strPrevious;
+	__int64 nBlockedID = 0;
+	size_t nRead = 0, nWritten = 0;
+	bool bBlocked = (nRead < m_nBlockedCount) && pReader.Next(strBlocked, nBlockedID);
+	auto it = m_mapPending.begin();
+	while (bBlocked || (it != m_mapPending.end()))
+	{
+		const bool bTakeBlocked = bBlocked && ((it == m_mapPending.end()) || (strBlocked < it->first));
+		const std::string& strURL = bTakeBlocked ? strBlocked : it->first;
+		const __int64 nID = bTakeBlocked ? nBlockedID : it->second;
+
+		const bool bBlockHead = (nWritten % URL_BLOCK_SIZE) == 0;
+		if (bBlockHead)
+			arrBlocks.push_back(arrData.size());
+		AppendEntry(arrData, strPrevious, strURL, nID, bBlockHead);
+		if (static_cast<unsigned __int64>(nID) >= m_arrRankByID.size())
+			m_arrRankByID.resize(std::max<size_t>(static_cast<size_t>(nID) + 1, m_arrRankByID.size() * 3 / 2), 0);
+		m_arrRankByID[static_cast<size_t>(nID)] = static_cast<unsigned int>(++nWritten);
+		strPrevious = strURL;
+
+		if (bTakeBlocked)
+			bBlocked = (++nRead < m_nBlockedCount) && pReader.Next(strBlocked, nBlockedID);
+		else
+			it++;
+	}
+
+	arrData.shrink_to_fit();
+	m_arrData = std::move(arrData);
+	m_arrBlocks = std::move(arrBlocks);
+	m_nBlockedCount = nWritten;
+	m_mapPending.clear();
+	m_mapPendingByID.clear();
+	m_nMerges++;
+}
+
+void CUrlDictionary::Clear()
+{
+	m_arrData.clear();
+	m_arrData.shrink_to_fit();
+	m_arrBlocks.clear();
+	m_arrBlocks.shrink_to_fit();
+	m_arrRankByID.clear();
+	m_arrRankByID.shrink_to_fit();
+	m_nBlockedCount = 0;
+	m_mapPending.clear();
+	m_mapPendingByID.clear();
+}
+
+size_t CUrlDictionary::GetMemoryBytes() const
+{
+	size_t nBytes = m_arrData.capacity() + m_arrBlocks.capacity() * sizeof(size_t) + m_arrRankByID.capacity() * sizeof(unsigned int);
+	// red-black tree node plus the string, and the reverse hash entry
+	for (const auto& it : m_mapPending)
+		nBytes += 64 + ((it.first.length() >= 16) ? it.first.capacity() + 1 : 0) + 32;
+	return nBytes;
+}
+
+bool CUrlDictionary::Rebuild()
+{
+	// recover the block offsets and the ID index from the blocks themselves
+	m_arrBlocks.clear();
+	m_arrRankByID.clear();
+	CBlockReader pReader(m_arrData, 0);
+	std::string strURL, strPrevious;
+	__int64 nID = 0;
+	const unsigned __int64 nMaxID = static_cast<unsigned __int64>(m_nBlockedCount) * URL_ID_RATIO + URL_PENDING_MINIMUM;
+	for (size_t nIndex = 0; nIndex < m_nBlockedCount; nIndex++)
+	{
+		if ((nIndex % URL_BLOCK_SIZE) == 0)
+			m_arrBlocks.push_back(pReader.GetOffset());
+		// a damaged ID would size the rank table after it
+		if (!pReader.Next(strURL, nID) || (nID < 0) || (static_cast<unsigned __int64>(nID) > nMaxID) ||
+			((nIndex > 0) && (strPrevious >= strURL)))
+			return false;
+		if (static_cast<unsigned __int64>(nID) >= m_arrRankByID.size())
+			m_arrRankByID.resize(std::max<size_t>(static_cast<size_t>(nID) + 1, m_arrRankByID.size() * 3 / 2), 0);
+		m_arrRankByID[static_cast<size_t>(nID)] = static_cast<unsigned int>(nIndex + 1);
+		strPrevious = strURL;
+	}
+	return pReader.GetOffset() == m_arrData.size();
+}
+
+bool CUrlDictionary::Save(std::ostream& pStream)
+{
+	Merge();
+	const unsigned __int64 nCount = m_nBlockedCount;
+	const unsigned __int64 nBytes = m_arrData.size();
+	pStream.write(DICTIONARY_MAGIC, sizeof(DICTIONARY_MAGIC));
+	pStream.write(reinterpret_cast<const char*>(&DICTIONARY_VERSION), sizeof(DICTIONARY_VERSION));
+	pStream.write(reinterpret_cast<const char*>(&nCount), sizeof(nCount));
+	pStream.write(reinterpret_cast<const char*>(&nBytes), sizeof(nBytes));
+	if (nBytes > 0)
+		pStream.write(m_arrData.data(), static_cast<std::streamsize>(nBytes));
+	return pStream.good();
+}
+
+bool CUrlDictionary::Load(std::istream& pStream)
+{
+	Clear();
+	char lpszMagic[sizeof(DICTIONARY_MAGIC)] = { 0, };
+	unsigned int nVersion = 0;
+	unsigned __int64 nCount = 0, nBytes = 0;
+	pStream.read(lpszMagic, sizeof(lpszMagic));
+	pStream.read(reinterpret_cast<char*>(&nVersion), sizeof(nVersion));
+	pStream.read(reinterpret_cast<char*>(&nCount), sizeof(nCount));
+	pStream.read(reinterpret_cast<char*>(&nBytes), sizeof(nBytes));
+	if (!pStream.good() || (memcmp(lpszMagic, DICTIONARY_MAGIC, sizeof(DICTIONARY_MAGIC)) != 0) ||
+		(nVersion != DICTIONARY_VERSION) || (nCount > nBytes) || (nBytes > GetRemainingBytes(pStream)))
+		return false;
+
+	m_arrData.resize(static_cast<size_t>(nBytes));
+	if (nBytes > 0)
+		pStream.read(m_arrData.data(), static_cast<std::streamsize>(nBytes));
+	m_nBlockedCount = static_cast<size_t>(nCount);
+	if (!pStream.good() || !Rebuild())
+	{
+		Clear();
+		return false;
+	}
+	return true;
+}
+
+void CUrlDictionary::ExportMetrics(CCrawlerMetrics& pMetrics) const
+{
+	const size_t nCount = GetCount();
+	const size_t nBytes = GetMemoryBytes();
+	pMetrics.SetGauge("url_dictionary_urls", static_cast<double>(nCount));
+	pMetrics.SetGauge("url_dictionary_bytes", static_cast<double>(nBytes));
+	pMetrics.SetGauge("url_dictionary_bytes_per_url", (nCount > 0) ? static_cast<double>(nBytes) / static_cast<double>(nCount) : 0.0);
+	pMetrics.SetGauge("url_dictionary_pending_urls", static_cast<double>(m_mapPending.size()));
+	pMetrics.SetGauge("url_dictionary_merges", static_cast<double>(m_nMerges));
+}
@@ -0,0 +1,132 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file UrlDictionary.h
+ * @brief Declaration of the front-coded dictionary that maps stored webpage URLs
+ *        to their database IDs and back.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <iostream>
+
+class CCrawlerMetrics;
+
+/**
+ * @class CUrlDictionary
+ * @brief Compact bidirectional URL to ID mapping.
+ *
+ * Most URLs are sorted into blocks of URL_BLOCK_SIZE entries. The first URL of a
+ * block is stored in full; every other one only as the length of the prefix it
+ * shares with its predecessor and the remaining suffix, so long common prefixes
+ * such as "https://en.wikipedia.org/wiki/" are stored once per block. A lookup
+ * binary-searches the block heads and decodes at most one block.
+ *
+ * New URLs first go to a small sorted buffer, which is merged into the blocks in
+ * one sequential pass once it reaches an eighth of the dictionary, so the cost of
+ * rewriting the blocks is spread over many inserts.
+ *
+ * IDs must be non-negative and dense, like the AUTO_INCREMENT values assigned by
+ * the crawler. The class is not thread-safe.
+ */
+class CUrlDictionary
+{
+public:
+	CUrlDictionary();
+	~CUrlDictionary();
+
+public:
+	/**
+	 * @brief Adds a URL with its ID.
+	 * @return false if the URL is already in the dictionary or the ID is negative.
+	 */
+	bool Insert(const std::string& lpszURL, __int64 nID);
+
+	/**
+	 * @brief Finds the ID of a URL.
+	 * @param[out] nID The ID, if found.
+	 * @return true if the URL is in the dictionary.
+	 */
+	bool Lookup(const std::string& lpszURL, __int64& nID) const;
+
+	bool Contains(const std::string& lpszURL) const { __int64 nID = 0; return Lookup(lpszURL, nID); }
+
+	/**
+	 * @brief Finds the URL stored with an ID.
+	 * @param[out] strURL The URL, if found.
+	 * @return true if the ID is in the dictionary.
+	 */
+	bool GetURL(__int64 nID, std::string& strURL) const;
+
+	/**
+	 * @brief Moves the buffered URLs into the compressed blocks.
+	 */
+	void Merge();
+
+	void Clear();
+
+	size_t GetCount() const { return m_nBlockedCount + m_mapPending.size(); }
+
+	/**
+	 * @brief Approximate heap memory held by the dictionary, in bytes.
+	 */
+	size_t GetMemoryBytes() const;
+
+	/**
+	 * @brief Merges the buffer and writes the dictionary to a binary stream.
+	 */
+	bool Save(std::ostream& pStream);
+
+	/**
+	 * @brief Replaces the dictionary with one previously written by Save.
+	 */
+	bool Load(std::istream& pStream);
+
+	/**
+	 * @brief Publishes size and compression statistics.
+	 */
+	void ExportMetrics(CCrawlerMetrics& pMetrics) const;
+
+protected:
+	/// Sequential reader of the entries in the compressed blocks.
+	class CBlockReader
+	{
+	public:
+		CBlockReader(const std::vector<char>& arrData, size_t nOffset) : m_arrData(arrData), m_nOffset(nOffset) {}
+		bool Next(std::string& strURL, __int64& nID);
+		size_t GetOffset() const { return m_nOffset; }
+
+	protected:
+		const std::vector<char>& m_arrData;
+		size_t m_nOffset;
+	};
+
+	size_t FindBlock(const std::string& lpszURL) const;
+	bool Rebuild();
+	static void AppendEntry(std::vector<char>& arrData, const std::string& lpszPrevious, const std::string& lpszURL, __int64 nID, bool bBlockHead);
+
+protected:
+	std::vector<char> m_arrData;                       ///< Front-coded blocks, in URL order
+	std::vector<size_t> m_arrBlocks;                   ///< Offset of each block in m_arrData
+	std::vector<unsigned int> m_arrRankByID;           ///< 1 + position in URL order of each blocked ID, 0 if none
+	size_t m_nBlockedCount = 0;                        ///< URLs stored in the blocks
+	std::map<std::string, __int64> m_mapPending;       ///< URLs not yet merged into the blocks
+	std::unordered_map<__int64, const std::string*> m_mapPendingByID;
+	unsigned __int64 m_nMerges = 0;
+};
@@ -0,0 +1,911 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file UrlFrontier.cpp
+ * @brief Implements the URL frontier heap operations.
+ */
+
+#include "stdafx.h"
+#include "UrlFrontier.h"
+#include "UrlCanonicalizer.h"
+#include "CrawlerMetrics.h"
+#include "CrawlCheckpoint.h"
+#include "PolitenessScheduler.h"
+
+#define FILTER_SAMPLE_RATE 1024
+#define ARENA_SLACK (1024 * 1024) // garbage bytes tolerated before the arena is compacted
+#define STAGING_LOW 1024
+#define STAGING_BATCH 4096
+#define EXTRACT_HOLD_LIMIT 4096 // refused URLs set aside by one Extract call
+
+CUrlFrontier::CUrlFrontier()
+{
+}
+
+CUrlFrontier::~CUrlFrontier()
+{
+	Close();
+}
+
+bool CUrlFrontier::SetVisitedFilter(size_t nMemoryBytes, double rFalsePositiveRate)
+{
+	ASSERT(m_nVisitedCount == 0);
+	if (!m_pVisitedFilter.Create(nMemoryBytes, rFalsePositiveRate))
+		return false;
+	m_setVisited.clear();
+	return true;
+}
+
+unsigned __int64 CUrlFrontier::Fingerprint(const std::string& lpszURL)
+{
+	return CUrlCanonicalizer::Fingerprint(lpszURL);
+}
+
+bool CUrlFrontier::IsVisitedFingerprint(unsigned __int64 nHash) const
+{
+	if (!m_pVisitedFilter.IsCreated())
+		return (m_setVisited.find(nHash) != m_setVisited.end());
+
+	const bool bVisited = m_pVisitedFilter.ContainsHash(nHash);
+	if ((nHash % FILTER_SAMPLE_RATE) == 0)
+	{
+		if (m_setVisitedSample.find(nHash) == m_setVisitedSample.end())
+		{
+			m_nSampleProbes++;
+			if (bVisited)
+				m_nSampleFalsePositives++;
+		}
+	}
+	return bVisited;
+}
+
+void CUrlFrontier::InsertVisited(unsigned __int64 nHash)
+{
+	if (!m_pVisitedFilter.IsCreated())
+	{
+		m_setVisited.insert(nHash);
+		return;
+	}
+
+	m_pVisitedFilter.InsertHash(nHash);
+	if ((nHash % FILTER_SAMPLE_RATE) == 0)
+		m_setVisitedSample.insert(nHash);
+}
+
+std::string CUrlFrontier::GetURL(const CFrontierNode& pNode) const
+{
+	return std::string(m_arrArena.data() + pNode.m_nOffset, pNode.m_nLength);
+}
+
+void CUrlFrontier::CompactArena()
+{
+	// copy the live URLs to a fresh arena; the heap and held nodes are the only references
+	std::vector<char> arrArena;
+	arrArena.reserve(m_arrArena.size() - m_nArenaGarbage);
+	const auto CopyNode = [this, &arrArena](CFrontierNode& pNode) {
+		const unsigned __int64 nOffset = arrArena.size();
+		arrArena.insert(arrArena.end(), m_arrArena.begin() + pNode.m_nOffset, m_arrArena.begin() + pNode.m_nOffset + pNode.m_nLength);
+		pNode.m_nOffset = nOffset;
+	};
+	for (auto& pNode : m_arrHeap)
+		CopyNode(pNode);
+	for (auto& it : m_mapHeld)
+		for (auto& pNode : it.second)
+			CopyNode(pNode);
+	m_arrArena.swap(arrArena);
+	m_nArenaGarbage = 0;
+}
+
+unsigned __int64 CUrlFrontier::GetQueuedCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutexSpill);
+	return m_arrHeap.size() + m_nHeldCount + m_arrStaging.size() + m_nSpilledCount;
+}
+
+void CUrlFrontier::ExportMetrics(CCrawlerMetrics& pMetrics) const
+{
+	pMetrics.SetGauge("frontier_queued_urls", static_cast<double>(GetQueuedCount()));
+	pMetrics.SetGauge("frontier_head_urls", static_cast<double>(m_arrHeap.size()));
+	pMetrics.SetGauge("frontier_held_urls", static_cast<double>(m_nHeldCount));
+	pMetrics.SetGauge("frontier_held_hosts", static_cast<double>(m_mapHeld.size()));
+	pMetrics.SetGauge("frontier_arena_bytes", static_cast<double>(m_arrArena.size()));
+	pMetrics.SetGauge("frontier_visited_urls", static_cast<double>(m_nVisitedCount));
+	pMetrics.SetGauge("opic_pending_pages", static_cast<double>(m_mapCash.size()));
+	pMetrics.SetGauge("opic_cash_crawled", m_rCashCrawled);
+	pMetrics.SetGauge("opic_cash_lost", m_rCashLost);
+	if (m_pVisitedFilter.IsCreated())
+	{
+		pMetrics.SetGauge("visited_filter_bytes", static_cast<double>(m_pVisitedFilter.GetMemoryBytes()));
+		pMetrics.SetGauge("visited_filter_capacity", static_cast<double>(m_pVisitedFilter.GetCapacity()));
+		pMetrics.SetGauge("visited_filter_fp_rate_estimated", m_pVisitedFilter.GetEstimatedFalsePositiveRate());
+		pMetrics.SetGauge("visited_filter_fp_rate_measured", (m_nSampleProbes > 0) ?
+			static_cast<double>(m_nSampleFalsePositives) / static_cast<double>(m_nSampleProbes) : 0.0);
+	}
+	if (!m_strSpillDirectory.empty())
+	{
+		std::lock_guard<std::mutex> lock(m_mutexSpill);
+		pMetrics.SetGauge("frontier_spilled_urls", static_cast<double>(m_nSpilledCount));
+		pMetrics.SetGauge("frontier_staged_urls", static_cast<double>(m_arrStaging.size()));
+		pMetrics.SetGauge("frontier_segments", static_cast<double>(m_arrSegments.size()));
+	}
+}
+
+bool CUrlFrontier::SetSpillDirectory(const std::string& lpszDirectory, size_t nHeadCapacity)
+{
+	if (lpszDirectory.empty() || (nHeadCapacity < 2 * STAGING_BATCH) || !m_strSpillDirectory.empty())
+		return false;
+
+	std::error_code pError;
+	if (!std::filesystem::is_directory(lpszDirectory, pError))
+		return false;
+
+	m_strSpillDirectory = lpszDirectory;
+	m_nHeadCapacity = nHeadCapacity;
+	RemoveStaleSegments();
+	m_bStopSpill = false;
+	m_threadSpill = std::thread(&CUrlFrontier::SpillThreadProc, this);
+	return true;
+}
+
+void CUrlFrontier::RemoveStaleSegments()
+{
+	// segments left over from a previous run belong to a frontier that no longer exists,
+	// unless a restored checkpoint still reads from them
+	std::error_code pError;
+	for (const auto& it : std::filesystem::directory_iterator(m_strSpillDirectory, pError))
+	{
+		const std::string strName = it.path().filename().string();
+		if ((strName.rfind("frontier-", 0) != 0) || (it.path().extension() != ".seg"))
+			continue;
+		const bool bInUse = std::any_of(m_arrSegments.begin(), m_arrSegments.end(), [&it, &pError](const auto& pSegment) {
+			return std::filesystem::equivalent(it.path(), pSegment->GetPath(), pError);
+			});
+		if (!bInUse)
+			std::filesystem::remove(it.path(), pError);
+	}
+}
+
+void CUrlFrontier::RetireSegment(const std::shared_ptr<CFrontierSegment>& pSegment)
+{
+	pSegment->Close(!m_bRetainSegments);
+	if (m_bRetainSegments)
+		m_arrRetired.push_back(pSegment->GetPath());
+}
+
+void CUrlFrontier::PurgeRetiredSegments()
+{
+	std::lock_guard<std::mutex> lock(m_mutexSpill);
+	for (size_t nIndex = 0; nIndex < m_nRetiredAtSave; nIndex++)
+		::DeleteFileA(m_arrRetired[nIndex].c_str());
+	m_arrRetired.erase(m_arrRetired.begin(), m_arrRetired.begin() + m_nRetiredAtSave);
+	m_nRetiredAtSave = 0;
+}
+
+bool CUrlFrontier::Save(std::ostream& pStream)
+{
+	// freeze the cursors first, so the saved offsets match the staging buffer
+	std::lock_guard<std::mutex> lockCursors(m_mutexCursors);
+	std::lock_guard<std::mutex> lock(m_mutexSpill);
+
+	WriteCheckpointValue(pStream, m_nSequence);
+	WriteCheckpointValue(pStream, m_nVisitedCount);
+	WriteCheckpointValue(pStream, m_nNextSegment.load());
+
+	const unsigned char nFilter = m_pVisitedFilter.IsCreated() ? 1 : 0;
+	WriteCheckpointValue(pStream, nFilter);
+	std::vector<unsigned __int64> arrHashes;
+	if (nFilter != 0)
+	{
+		m_pVisitedFilter.Save(pStream);
+		arrHashes.assign(m_setVisitedSample.begin(), m_setVisitedSample.end());
+	}
+	else
+		arrHashes.assign(m_setVisited.begin(), m_setVisited.end());
+	WriteCheckpointValue(pStream, static_cast<unsigned __int64>(arrHashes.size()));
+	pStream.write(reinterpret_cast<const char*>(arrHashes.data()), arrHashes.size() * sizeof(unsigned __int64));
+	WriteCheckpointValue(pStream, m_nSampleProbes);
+	WriteCheckpointValue(pStream, m_nSampleFalsePositives);
+
+	WriteCheckpointValue(pStream, static_cast<unsigned __int64>(m_mapCash.size()));
+	for (const auto& it : m_mapCash)
+	{
+		WriteCheckpointValue(pStream, it.first);
+		WriteCheckpointValue(pStream, it.second);
+	}
+	WriteCheckpointValue(pStream, m_rCashCrawled);
+	WriteCheckpointValue(pStream, m_rCashLost);
+
+	// held URLs are written with the heap and go back into it on load
+	WriteCheckpointValue(pStream, static_cast<unsigned __int64>(m_arrHeap.size() + m_nHeldCount));
+	pStream.write(reinterpret_cast<const char*>(m_arrHeap.data()), m_arrHeap.size() * sizeof(CFrontierNode));
+	for (const auto& it : m_mapHeld)
+		pStream.write(reinterpret_cast<const char*>(it.second.data()), it.second.size() * sizeof(CFrontierNode));
+	WriteCheckpointValue(pStream, static_cast<unsigned __int64>(m_arrArena.size()));
+	pStream.write(m_arrArena.data(), m_arrArena.size());
+	WriteCheckpointValue(pStream, static_cast<unsigned __int64>(m_nArenaGarbage));
+
+	WriteCheckpointString(pStream, m_strSpillDirectory);
+	WriteCheckpointValue(pStream, static_cast<unsigned __int64>(m_nHeadCapacity));
+	// spills the thread has not written yet are saved as staged URLs
+	unsigned __int64 nPending = 0;
+	for (const auto& arrBatch : m_arrPendingSpills)
+		nPending += arrBatch.size();
+	WriteCheckpointValue(pStream, static_cast<unsigned __int64>(m_arrStaging.size()) + nPending);
+	auto pWriteEntry = [&pStream](const CFrontierEntry& pEntry) {
+		WriteCheckpointString(pStream, pEntry.m_strURL);
+		WriteCheckpointValue(pStream, pEntry.m_rCash);
+		WriteCheckpointValue(pStream, pEntry.m_nSequence);
+		};
+	std::for_each(m_arrStaging.begin(), m_arrStaging.end(), pWriteEntry);
+	for (const auto& arrBatch : m_arrPendingSpills)
+		std::for_each(arrBatch.begin(), arrBatch.end(), pWriteEntry);
+	unsigned __int64 nSegments = 0;
+	for (const auto& pSegment : m_arrSegments)
+		nSegments += pSegment->IsExhausted() ? 0 : 1;
+	WriteCheckpointValue(pStream, nSegments);
+	for (const auto& pSegment : m_arrSegments)
+	{
+		if (pSegment->IsExhausted())
+			continue;
+		WriteCheckpointString(pStream, pSegment->GetPath());
+		WriteCheckpointValue(pStream, pSegment->GetOffset());
+		WriteCheckpointValue(pStream, pSegment->GetRemaining());
+	}
+	WriteCheckpointValue(pStream, static_cast<unsigned __int64>(m_nSpilledCount - std::min<unsigned __int64>(m_nSpilledCount, nPending)));
+
+	m_nRetiredAtSave = m_arrRetired.size();
+	return pStream.good();
+}
+
+bool CUrlFrontier::Load(std::istream& pStream)
+{
+	ASSERT((m_nVisitedCount == 0) && m_arrHeap.empty() && m_strSpillDirectory.empty());
+	if (LoadState(pStream))
+		return true;
+	Clear();
+	return false;
+}
+
+bool CUrlFrontier::LoadState(std::istream& pStream)
+{
+	unsigned int nNextSegment = 0;
+	unsigned char nFilter = 0;
+	if (!ReadCheckpointValue(pStream, m_nSequence) || !ReadCheckpointValue(pStream, m_nVisitedCount) ||
+		!ReadCheckpointValue(pStream, nNextSegment) || !ReadCheckpointValue(pStream, nFilter))
+		return false;
+	m_nNextSegment = nNextSegment;
+	if ((nFilter != 0) && !m_pVisitedFilter.Load(pStream))
+		return false;
+
+	unsigned __int64 nCount = 0;
+	if (!ReadCheckpointValue(pStream, nCount) || !IsCheckpointCountValid(pStream, nCount, sizeof(unsigned __int64)))
+		return false;
+	std::vector<unsigned __int64> arrHashes(static_cast<size_t>(nCount));
+	pStream.read(reinterpret_cast<char*>(arrHashes.data()), arrHashes.size() * sizeof(unsigned __int64));
+	if (nFilter != 0)
+		m_setVisitedSample.insert(arrHashes.begin(), arrHashes.end());
+	else
+		m_setVisited.insert(arrHashes.begin(), arrHashes.end());
+	if (!ReadCheckpointValue(pStream, m_nSampleProbes) || !ReadCheckpointValue(pStream, m_nSampleFalsePositives))
+		return false;
+
+	if (!ReadCheckpointValue(pStream, nCount))
+		return false;
+	for (unsigned __int64 nIndex = 0; nIndex < nCount; nIndex++)
+	{
+		unsigned __int64 nFingerprint = 0;
+		double rCash = 0.0;
+		if (!ReadCheckpointValue(pStream, nFingerprint) || !ReadCheckpointValue(pStream, rCash))
+			return false;
+		m_mapCash[nFingerprint] = rCash;
+	}
+	if (!ReadCheckpointValue(pStream, m_rCashCrawled) || !ReadCheckpointValue(pStream, m_rCashLost))
+		return false;
+
+	if (!ReadCheckpointValue(pStream, nCount) || !IsCheckpointCountValid(pStream, nCount, sizeof(CFrontierNode)))
+		return false;
+	m_arrHeap.resize(static_cast<size_t>(nCount));
+	pStream.read(reinterpret_cast<char*>(m_arrHeap.data()), m_arrHeap.size() * sizeof(CFrontierNode));
+	if (!ReadCheckpointValue(pStream, nCount) || !IsCheckpointCountValid(pStream, nCount, sizeof(char)))
+		return false;
+	m_arrArena.resize(static_cast<size_t>(nCount));
+	pStream.read(m_arrArena.data(), m_arrArena.size());
+	if (!ReadCheckpointValue(pStream, nCount) || (nCount > m_arrArena.size()))
+		return false;
+	m_nArenaGarbage = static_cast<size_t>(nCount);
+	for (const auto& pNode : m_arrHeap)
+	{
+		if (pNode.m_nOffset + pNode.m_nLength > m_arrArena.size())
+			return false;
+	}
+	RebuildHeap();
+
+	std::string strSpillDirectory;
+	unsigned __int64 nHeadCapacity = 0;
+	if (!ReadCheckpointString(pStream, strSpillDirectory) || !ReadCheckpointValue(pStream, nHeadCapacity) ||
+		!ReadCheckpointValue(pStream, nCount))
+		return false;
+	for (unsigned __int64 nIndex = 0; nIndex < nCount; nIndex++)
+	{
+		CFrontierEntry pEntry;
+		if (!ReadCheckpointString(pStream, pEntry.m_strURL) || !ReadCheckpointValue(pStream, pEntry.m_rCash) ||
+			!ReadCheckpointValue(pStream, pEntry.m_nSequence))
+			return false;
+		m_arrStaging.push_back(std::move(pEntry));
+	}
+
+	unsigned __int64 nSpilled = 0;
+	unsigned __int64 nLost = 0;
+	if (!ReadCheckpointValue(pStream, nCount))
+		return false;
+	for (unsigned __int64 nIndex = 0; nIndex < nCount; nIndex++)
+	{
+		std::string strPath;
+		unsigned __int64 nOffset = 0;
+		unsigned __int64 nRemaining = 0;
+		if (!ReadCheckpointString(pStream, strPath) || !ReadCheckpointValue(pStream, nOffset) ||
+			!ReadCheckpointValue(pStream, nRemaining))
+			return false;
+		auto pSegment = std::make_shared<CFrontierSegment>();
+		if (pSegment->Open(strPath, nOffset, nRemaining))
+			m_arrSegments.push_back(pSegment);
+		else
+			nLost += nRemaining; // the file is gone: its URLs stay visited but will not be crawled
+	}
+	if (!ReadCheckpointValue(pStream, nSpilled))
+		return false;
+	m_nSpilledCount = nSpilled - std::min(nSpilled, nLost);
+
+	std::error_code pError;
+	if (!strSpillDirectory.empty() && std::filesystem::is_directory(strSpillDirectory, pError))
+	{
+		m_strSpillDirectory = strSpillDirectory;
+		m_nHeadCapacity = static_cast<size_t>(nHeadCapacity);
+		RemoveStaleSegments();
+		m_bStopSpill = false;
+		m_threadSpill = std::thread(&CUrlFrontier::SpillThreadProc, this);
+	}
+	else if (!m_arrSegments.empty() || !m_arrStaging.empty())
+	{
+		// no disk tier to read them back: fold the spilled URLs into the heap
+		for (auto& pSegment : m_arrSegments)
+		{
+			for (; !pSegment->IsExhausted(); pSegment->Next())
+				m_arrStaging.push_back(pSegment->Peek());
+			pSegment->Close(false);
+		}
+		m_arrSegments.clear();
+		m_nSpilledCount = 0;
+		for (const auto& pEntry : m_arrStaging)
+		{
+			CFrontierNode pNode;
+			pNode.m_nFingerprint = Fingerprint(pEntry.m_strURL);
+			pNode.m_nSequence = pEntry.m_nSequence;
+			pNode.m_nOffset = m_arrArena.size();
+			pNode.m_nLength = static_cast<unsigned int>(pEntry.m_strURL.length());
+			pNode.m_rCash = pEntry.m_rCash;
+			m_arrArena.insert(m_arrArena.end(), pEntry.m_strURL.begin(), pEntry.m_strURL.end());
+			m_arrHeap.push_back(pNode);
+		}
+		m_arrStaging.clear();
+		RebuildHeap();
+	}
+	return true;
+}
+
+void CUrlFrontier::Clear()
+{
+	Close();
+	m_arrHeap.clear();
+	m_mapPosition.clear();
+	m_mapHeld.clear();
+	m_nHeldCount = 0;
+	m_setVisited.clear();
+	m_pVisitedFilter = CBloomFilter();
+	m_arrArena.clear();
+	m_nArenaGarbage = 0;
+	m_nVisitedCount = 0;
+	m_nSequence = 0;
+	m_mapCash.clear();
+	m_rCashCrawled = 0.0;
+	m_rCashLost = 0.0;
+	m_setVisitedSample.clear();
+	m_nSampleProbes = 0;
+	m_nSampleFalsePositives = 0;
+	m_strSpillDirectory.clear();
+	m_nHeadCapacity = 0;
+	m_nNextSegment = 0;
+	m_arrSegments.clear();
+	m_arrStaging.clear();
+	m_arrPendingSpills.clear();
+	m_nSpilledCount = 0;
+	m_arrRetired.clear();
+	m_nRetiredAtSave = 0;
+}
+
+void CUrlFrontier::Close()
+{
+	if (m_threadSpill.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutexSpill);
+			m_bStopSpill = true;
+		}
+		m_eventSpill.notify_all();
+		m_threadSpill.join();
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutexSpill);
+	for (auto& pSegment : m_arrSegments)
+		pSegment->Close(false);
+}
+
+bool CUrlFrontier::Add(const std::string& lpszURL, double rCash)
+{
+	const unsigned __int64 nFingerprint = Fingerprint(lpszURL);
+	auto itCash = m_mapCash.find(nFingerprint);
+	if (itCash != m_mapCash.end())
+	{
+		// extracted but not crawled yet: the page still passes the cash on
+		itCash->second += rCash;
+		return false;
+	}
+	if (IsVisitedFingerprint(nFingerprint))
+	{
+		m_rCashLost += rCash;
+		return false; // URL already visited
+	}
+
+	auto it = m_mapPosition.find(nFingerprint);
+	if (it != m_mapPosition.end())
+	{
+		// cash only grows, so the entry can only move up; the position is in the
+		// main heap unless the URL is held under its host
+		const size_t nIndex = it->second;
+		std::vector<CFrontierNode>& arrHeap = ((nIndex < m_arrHeap.size()) && (m_arrHeap[nIndex].m_nFingerprint == nFingerprint)) ?
+			m_arrHeap : m_mapHeld[CPolitenessScheduler::GetHost(lpszURL)];
+		ASSERT((nIndex < arrHeap.size()) && (arrHeap[nIndex].m_nFingerprint == nFingerprint));
+		arrHeap[nIndex].m_rCash += rCash;
+		SiftUp(arrHeap, nIndex);
+		return true;
+	}
+
+	CFrontierNode pNode;
+	pNode.m_nFingerprint = nFingerprint;
+	pNode.m_nSequence = m_nSequence++;
+	pNode.m_nOffset = m_arrArena.size();
+	pNode.m_nLength = static_cast<unsigned int>(lpszURL.length());
+	pNode.m_rCash = rCash;
+	m_arrArena.insert(m_arrArena.end(), lpszURL.begin(), lpszURL.end());
+	PushHeap(m_arrHeap, pNode);
+
+	if ((m_nHeadCapacity > 0) && (m_arrHeap.size() + m_nHeldCount > m_nHeadCapacity))
+		Spill();
+	return true;
+}
+
+bool CUrlFrontier::Extract(std::string& lpszURL, const std::function<bool(const std::string&)>& pAccept)
+{
+	lpszURL = "";
+	// never waits for the disk: with both memory tiers empty the caller, which may hold
+	// a lock other threads need, gets nothing now and the spill thread refills the staging
+	std::unique_lock<std::mutex> lock(m_mutexSpill, std::defer_lock);
+	if (!m_strSpillDirectory.empty())
+		lock.lock();
+
+	// a refused URL leaves the heap for its host's held heap, so it is looked at
+	// once instead of on every call; ExtractHeld hands it out later
+	bool bFound = false;
+	for (size_t nHeld = 0; !bFound && (nHeld < EXTRACT_HOLD_LIMIT); nHeld++)
+	{
+		const bool bStaged = !m_arrStaging.empty() && (m_arrHeap.empty() || IsHigherPriority(m_arrStaging.front(), m_arrHeap[0]));
+		if (!bStaged && m_arrHeap.empty())
+			break;
+
+		std::string strURL = bStaged ? m_arrStaging.front().m_strURL : GetURL(m_arrHeap[0]);
+		bFound = !pAccept || pAccept(strURL);
+		if (bStaged && bFound)
+		{
+			const CFrontierEntry& pEntry = m_arrStaging.front();
+			const unsigned __int64 nFingerprint = Fingerprint(pEntry.m_strURL);
+			InsertVisited(nFingerprint);
+			m_mapCash[nFingerprint] = pEntry.m_rCash;
+			m_arrStaging.pop_front();
+		}
+		else if (bStaged)
+		{
+			CFrontierNode pNode;
+			pNode.m_nFingerprint = Fingerprint(strURL);
+			pNode.m_nSequence = m_arrStaging.front().m_nSequence;
+			pNode.m_nOffset = m_arrArena.size();
+			pNode.m_nLength = static_cast<unsigned int>(strURL.length());
+			pNode.m_rCash = m_arrStaging.front().m_rCash;
+			m_arrArena.insert(m_arrArena.end(), strURL.begin(), strURL.end());
+			m_arrStaging.pop_front();
+			Hold(CPolitenessScheduler::GetHost(strURL), pNode);
+		}
+		else if (bFound)
+			ExtractNode(PopHeap(m_arrHeap));
+		else
+			Hold(CPolitenessScheduler::GetHost(strURL), PopHeap(m_arrHeap));
+		if (bFound)
+		{
+			m_nVisitedCount++;
+			lpszURL = std::move(strURL);
+		}
+	}
+
+	if (lock.owns_lock() && (m_arrStaging.size() < STAGING_LOW) && (m_nSpilledCount > 0))
+		m_eventSpill.notify_all();
+	return bFound;
+}
+
+bool CUrlFrontier::ExtractHeld(const std::string& lpszHost, std::string& lpszURL)
+{
+	lpszURL = "";
+	auto it = m_mapHeld.find(lpszHost);
+	if (it == m_mapHeld.end())
+		return false;
+	const CFrontierNode pNode = PopHeap(it->second);
+	if (it->second.empty())
+		m_mapHeld.erase(it);
+	m_nHeldCount--;
+	lpszURL = GetURL(pNode);
+	ExtractNode(pNode);
+	m_nVisitedCount++;
+	return true;
+}
+
+void CUrlFrontier::ExtractNode(const CFrontierNode& pNode)
+{
+	InsertVisited(pNode.m_nFingerprint);
+	m_mapCash[pNode.m_nFingerprint] = pNode.m_rCash;
+	m_nArenaGarbage += pNode.m_nLength;
+	if ((m_nArenaGarbage > ARENA_SLACK) && (2 * m_nArenaGarbage > m_arrArena.size()))
+		CompactArena();
+}
+
+void CUrlFrontier::Hold(const std::string& lpszHost, const CFrontierNode& pNode)
+{
+	PushHeap(m_mapHeld[lpszHost], pNode);
+	m_nHeldCount++;
+}
+
+void CUrlFrontier::ReleaseHeld()
+{
+	if (m_mapHeld.empty())
+		return;
+	for (const auto& it : m_mapHeld)
+		m_arrHeap.insert(m_arrHeap.end(), it.second.begin(), it.second.end());
+	m_mapHeld.clear();
+	m_nHeldCount = 0;
+	RebuildHeap();
+}
+
+double CUrlFrontier::TakeCash(const std::string& lpszURL)
+{
+	auto it = m_mapCash.find(Fingerprint(lpszURL));
+	if (it == m_mapCash.end())
+		return 0.0;
+	const double rCash = it->second;
+	m_mapCash.erase(it);
+	m_rCashCrawled += rCash;
+	return rCash;
+}
+
+void CUrlFrontier::Swap(std::vector<CFrontierNode>& arrHeap, size_t nFirst, size_t nSecond)
+{
+	if (nFirst == nSecond)
+		return;
+	std::swap(arrHeap[nFirst], arrHeap[nSecond]);
+	m_mapPosition[arrHeap[nFirst].m_nFingerprint] = nFirst;
+	m_mapPosition[arrHeap[nSecond].m_nFingerprint] = nSecond;
+}
+
+CFrontierNode CUrlFrontier::PopHeap(std::vector<CFrontierNode>& arrHeap)
+{
+	Swap(arrHeap, 0, arrHeap.size() - 1);
+	const CFrontierNode pNode = arrHeap.back();
+	arrHeap.pop_back();
+	m_mapPosition.erase(pNode.m_nFingerprint);
+	if (!arrHeap.empty())
+		SiftDown(arrHeap, 0);
+	return pNode;
+}
+
+void CUrlFrontier::PushHeap(std::vector<CFrontierNode>& arrHeap, const CFrontierNode& pNode)
+{
+	arrHeap.push_back(pNode);
+	m_mapPosition[pNode.m_nFingerprint] = arrHeap.size() - 1;
+	SiftUp(arrHeap, arrHeap.size() - 1);
+}
+
+void CUrlFrontier::SiftUp(std::vector<CFrontierNode>& arrHeap, size_t nIndex)
+{
+	while (nIndex > 0)
+	{
+		const size_t nParent = (nIndex - 1) / 2;
+		if (!IsHigherPriority(arrHeap[nIndex], arrHeap[nParent]))
+			break;
+		Swap(arrHeap, nIndex, nParent);
+		nIndex = nParent;
+	}
+}
+
+void CUrlFrontier::SiftDown(std::vector<CFrontierNode>& arrHeap, size_t nIndex)
+{
+	const size_t nCount = arrHeap.size();
+	while (true)
+	{
+		const size_t nLeft = 2 * nIndex + 1;
+		const size_t nRight = nLeft + 1;
+		size_t nBest = nIndex;
+		if ((nLeft < nCount) && IsHigherPriority(arrHeap[nLeft], arrHeap[nBest]))
+			nBest = nLeft;
+		if ((nRight < nCount) && IsHigherPriority(arrHeap[nRight], arrHeap[nBest]))
+			nBest = nRight;
+		if (nBest == nIndex)
+			break;
+		Swap(arrHeap, nIndex, nBest);
+		nIndex = nBest;
+	}
+}
+
+void CUrlFrontier::RebuildHeap()
+{
+	m_mapPosition.clear();
+	m_mapPosition.reserve(m_arrHeap.size() + m_nHeldCount);
+	for (size_t nIndex = 0; nIndex < m_arrHeap.size(); nIndex++)
+		m_mapPosition[m_arrHeap[nIndex].m_nFingerprint] = nIndex;
+	for (const auto& it : m_mapHeld)
+		for (size_t nIndex = 0; nIndex < it.second.size(); nIndex++)
+			m_mapPosition[it.second[nIndex].m_nFingerprint] = nIndex;
+	for (size_t nIndex = m_arrHeap.size() / 2; nIndex-- > 0;)
+		SiftDown(m_arrHeap, nIndex);
+}
+
+void CUrlFrontier::Spill()
+{
+	ReleaseHeld();
+
+	// keep the better half in memory; the spill thread sorts and writes the rest
+	const size_t nKeep = m_nHeadCapacity / 2;
+	std::nth_element(m_arrHeap.begin(), m_arrHeap.begin() + nKeep, m_arrHeap.end(), IsHigherPriority<CFrontierNode, CFrontierNode>);
+
+	std::vector<CFrontierEntry> arrBatch;
+	arrBatch.reserve(m_arrHeap.size() - nKeep);
+	for (size_t nIndex = nKeep; nIndex < m_arrHeap.size(); nIndex++)
+	{
+		CFrontierEntry pEntry;
+		pEntry.m_strURL = GetURL(m_arrHeap[nIndex]);
+		pEntry.m_rCash = m_arrHeap[nIndex].m_rCash;
+		pEntry.m_nSequence = m_arrHeap[nIndex].m_nSequence;
+		arrBatch.push_back(std::move(pEntry));
+		InsertVisited(m_arrHeap[nIndex].m_nFingerprint);
+		m_nArenaGarbage += m_arrHeap[nIndex].m_nLength;
+	}
+	m_arrHeap.resize(nKeep);
+	CompactArena();
+	RebuildHeap();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutexSpill);
+		m_nSpilledCount += arrBatch.size();
+		m_arrPendingSpills.push_back(std::move(arrBatch));
+	}
+	m_eventSpill.notify_all();
+}
+
+void CUrlFrontier::SpillThreadProc()
+{
+	std::unique_lock<std::mutex> lock(m_mutexSpill);
+	while (true)
+	{
+		m_eventSpill.wait(lock, [this] {
+			return m_bStopSpill || !m_arrPendingSpills.empty() || (m_arrSegments.size() > m_nMergeThreshold) ||
+				((m_arrStaging.size() < STAGING_LOW) && (m_nSpilledCount > 0));
+			});
+		if (m_bStopSpill)
+			break;
+
+		lock.unlock();
+		bool bProgress = false;
+		{
+			std::lock_guard<std::mutex> lockCursors(m_mutexCursors);
+			bProgress = WritePendingSpills();
+			MergeSegments();
+			bProgress = RefillStaging() || bProgress;
+		}
+		lock.lock();
+
+		if (!bProgress && m_arrPendingSpills.empty() && (m_arrSegments.size() <= m_nMergeThreshold))
+		{
+			// nothing readable is left: the count must not keep the thread spinning
+			if (m_arrSegments.empty())
+				m_nSpilledCount = 0;
+			m_eventSpill.notify_all();
+		}
+	}
+}
+
+bool CUrlFrontier::WritePendingSpills()
+{
+	bool bWritten = false;
+	while (true)
+	{
+		std::vector<CFrontierEntry> arrBatch;
+		{
+			std::lock_guard<std::mutex> lock(m_mutexSpill);
+			if (m_arrPendingSpills.empty())
+				return bWritten;
+			arrBatch = std::move(m_arrPendingSpills.front());
+			m_arrPendingSpills.pop_front();
+		}
+		std::sort(arrBatch.begin(), arrBatch.end(), IsHigherPriority<CFrontierEntry, CFrontierEntry>);
+
+		char lpszName[0x20] = { 0, };
+		sprintf_s(lpszName, _countof(lpszName), "frontier-%08u.seg", m_nNextSegment++);
+		const std::string strPath = (std::filesystem::path(m_strSpillDirectory) / lpszName).string();
+
+		bool bSuccess = false;
+		CFrontierSegmentWriter pWriter;
+		if (pWriter.Open(strPath))
+		{
+			bSuccess = true;
+			for (size_t nIndex = 0; bSuccess && (nIndex < arrBatch.size()); nIndex++)
+				bSuccess = pWriter.Append(arrBatch[nIndex]);
+			bSuccess = pWriter.Close() && bSuccess;
+		}
+		auto pSegment = std::make_shared<CFrontierSegment>();
+		bSuccess = bSuccess && pSegment->Open(strPath);
+		if (!bSuccess)
+			::DeleteFileA(strPath.c_str());
+
+		std::lock_guard<std::mutex> lock(m_mutexSpill);
+		if (bSuccess)
+			m_arrSegments.push_back(pSegment);
+		else
+		{
+			// disk trouble: keep the URLs in memory, merged into the staging buffer
+			std::deque<CFrontierEntry> arrStaging;
+			std::merge(std::make_move_iterator(m_arrStaging.begin()), std::make_move_iterator(m_arrStaging.end()),
+				std::make_move_iterator(arrBatch.begin()), std::make_move_iterator(arrBatch.end()),
+				std::back_inserter(arrStaging), IsHigherPriority<CFrontierEntry, CFrontierEntry>);
+			m_arrStaging.swap(arrStaging);
+			m_nSpilledCount -= std::min<unsigned __int64>(m_nSpilledCount, arrBatch.size());
+		}
+		bWritten = true;
+	}
+}
+
+bool CUrlFrontier::RefillStaging()
+{
+	std::vector<std::shared_ptr<CFrontierSegment>> arrSegments;
+	{
+		std::lock_guard<std::mutex> lock(m_mutexSpill);
+		if (m_arrStaging.size() >= STAGING_LOW)
+			return true;
+		arrSegments = m_arrSegments;
+	}
+
+	// k-way merge over the segment cursors; only this thread moves them
+	std::vector<CFrontierEntry> arrBatch;
+	arrBatch.reserve(STAGING_BATCH);
+	while (arrBatch.size() < STAGING_BATCH)
+	{
+		CFrontierSegment* pBest = nullptr;
+		for (auto& pSegment : arrSegments)
+		{
+			if (!pSegment->IsExhausted() && ((pBest == nullptr) || IsHigherPriority(pSegment->Peek(), pBest->Peek())))
+				pBest = pSegment.get();
+		}
+		if (pBest == nullptr)
+			break;
+		arrBatch.push_back(pBest->Peek());
+		pBest->Next();
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutexSpill);
+	for (auto& pEntry : arrBatch)
+		m_arrStaging.push_back(std::move(pEntry));
+	m_nSpilledCount -= std::min<unsigned __int64>(m_nSpilledCount, arrBatch.size());
+	for (auto it = m_arrSegments.begin(); it != m_arrSegments.end();)
+	{
+		if ((*it)->IsExhausted())
+		{
+			// a truncated segment may end before its record count says so
+			m_nSpilledCount -= std::min<unsigned __int64>(m_nSpilledCount, (*it)->GetRemaining());
+			RetireSegment(*it);
+			it = m_arrSegments.erase(it);
+		}
+		else
+			it++;
+	}
+	m_eventSpill.notify_all();
+	return !arrBatch.empty();
+}
+
+bool CUrlFrontier::MergeSegments()
+{
+	std::vector<std::shared_ptr<CFrontierSegment>> arrSegments;
+	{
+		std::lock_guard<std::mutex> lock(m_mutexSpill);
+		if (m_arrSegments.size() <= m_nMergeThreshold)
+			return false;
+		arrSegments = m_arrSegments;
+	}
+
+	char lpszName[0x20] = { 0, };
+	sprintf_s(lpszName, _countof(lpszName), "frontier-m%07u.seg", m_nNextSegment++);
+	const std::string strPath = (std::filesystem::path(m_strSpillDirectory) / lpszName).string();
+
+	CFrontierSegmentWriter pWriter;
+	if (!pWriter.Open(strPath))
+	{
+		m_nMergeThreshold *= 2; // cannot write: stop retrying on every wake-up
+		return false;
+	}
+	// the cursors are saved so the inputs can be rewound if the merged file is no good
+	std::vector<std::pair<unsigned __int64, unsigned __int64>> arrCursors;
+	unsigned __int64 nInputs = 0;
+	for (auto& pSegment : arrSegments)
+	{
+		arrCursors.emplace_back(pSegment->GetOffset(), pSegment->GetRemaining());
+		nInputs += pSegment->GetRemaining();
+	}
+	bool bWritten = true;
+	while (bWritten)
+	{
+		CFrontierSegment* pBest = nullptr;
+		for (auto& pSegment : arrSegments)
+		{
+			if (!pSegment->IsExhausted() && ((pBest == nullptr) || IsHigherPriority(pSegment->Peek(), pBest->Peek())))
+				pBest = pSegment.get();
+		}
+		if (pBest == nullptr)
+			break;
+		bWritten = pWriter.Append(pBest->Peek());
+		pBest->Next();
+	}
+	bWritten = pWriter.Close() && bWritten;
+
+	auto pMerged = std::make_shared<CFrontierSegment>();
+	if (!bWritten || !pMerged->Open(strPath) || (pMerged->GetRemaining() != nInputs))
+	{
+		// keep the inputs, back at the records they were at before the merge
+		pMerged->Close(false);
+		::DeleteFileA(strPath.c_str());
+		m_nMergeThreshold *= 2;
+		for (size_t nIndex = 0; nIndex < arrSegments.size(); nIndex++)
+		{
+			const std::string strInput = arrSegments[nIndex]->GetPath();
+			if ((arrCursors[nIndex].second > 0) && !arrSegments[nIndex]->Open(strInput, arrCursors[nIndex].first, arrCursors[nIndex].second))
+			{
+				std::lock_guard<std::mutex> lock(m_mutexSpill);
+				m_nSpilledCount -= std::min<unsigned __int64>(m_nSpilledCount, arrCursors[nIndex].second);
+			}
+		}
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutexSpill);
+	for (auto& pSegment : arrSegments)
+	{
+		m_arrSegments.erase(std::find(m_arrSegments.begin(), m_arrSegments.end(), pSegment));
+		RetireSegment(pSegment);
+	}
+	m_arrSegments.insert(m_arrSegments.begin(), pMerged);
+	return true;
+}
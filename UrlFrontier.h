@@ -0,0 +1,270 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file UrlFrontier.h
+ * @brief Declaration of the URL frontier: a visited set (exact or Bloom filter)
+ *        plus an addressable max-heap ordered by OPIC cash, which can spill
+ *        its low-priority tail to disk segments.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <unordered_map>
+#include <unordered_set>
+#include "BloomFilter.h"
+#include "FrontierSegment.h"
+
+class CCrawlerMetrics;
+
+/**
+ * @struct CFrontierNode
+ * @brief Entry of the in-memory heap; the URL text itself lives in the frontier's string arena.
+ */
+struct CFrontierNode
+{
+	unsigned __int64 m_nFingerprint = 0; ///< CUrlCanonicalizer::Fingerprint of the URL
+	unsigned __int64 m_nSequence = 0;
+	unsigned __int64 m_nOffset = 0;      ///< Start of the URL in the arena
+	unsigned int m_nLength = 0;
+	double m_rCash = 0.0;                ///< OPIC cash received from the pages linking here
+};
+
+/**
+ * @class CUrlFrontier
+ * @brief Queue of URLs waiting to be crawled, ordered by OPIC cash.
+ *
+ * OPIC (On-line Page Importance Computation) estimates importance while crawling:
+ * the seed starts with some cash, and every crawled page splits the cash it holds
+ * among its outlinks. A queued URL's priority is the cash it has received, so a
+ * link from a page that many important pages point to weighs more than a link
+ * from a page nobody links to. The cash of an extracted URL is kept until its
+ * page is crawled (TakeCash), and keeps growing while it waits in a back queue.
+ *
+ * URLs are expected in canonical form and are identified by their 64-bit
+ * fingerprint: the heap and the visited set hold fingerprints, and each queued
+ * URL's text is stored once in a shared arena. Every fingerprint in the heap has
+ * its position recorded in a hash map, so more cash raises its priority in
+ * O(log n) and the best URL is popped in O(log n). A URL refused by Extract's
+ * filter moves to a small heap of its host, so a busy host's URLs are passed over
+ * once rather than on every call, and ExtractHeld serves them when the host is free.
+ * Among URLs with equal cash the one discovered first is crawled first.
+ * The visited set is an exact hash set by default; SetVisitedFilter trades it for
+ * a Bloom filter of fixed size, which may occasionally drop a new URL as visited.
+ *
+ * With a spill directory configured the heap is only the in-memory head of the
+ * queue: when it outgrows its capacity the lower half is handed to a background
+ * thread, which sorts it into a segment file, merges segments and keeps a small staging
+ * buffer filled with the best spilled URLs. Extract only touches memory: when both
+ * the head and the staging buffer have run dry it finds nothing until the thread has
+ * read more from the segments. Spilled URLs are recorded in
+ * the visited set and stop collecting cash; ordering across the memory/disk
+ * boundary is therefore approximate.
+ */
+class CUrlFrontier
+{
+public:
+	CUrlFrontier();
+	~CUrlFrontier();
+
+public:
+	/**
+	 * @brief Queues a URL, or adds to its cash if it is already queued.
+	 * @param lpszURL The URL to add.
+	 * @param rCash The share of the linking page's cash that this link carries.
+	 * @return true if the URL was queued or its cash increased, false if it was already extracted.
+	 */
+	bool Add(const std::string& lpszURL, double rCash);
+
+	/**
+	 * @brief Removes the URL with the most cash from the queue and marks it as visited.
+	 *        Its cash is kept for TakeCash.
+	 * @param[out] lpszURL The extracted URL.
+	 * @param pAccept If set, URLs it refuses are set aside with their cash under their host,
+	 *        until ExtractHeld asks for them; they are not looked at again by Extract.
+	 * @return true if a URL was extracted, false if no URL was accepted or none is in memory
+	 *         right now; only IsEmpty tells whether spilled URLs are left.
+	 */
+	bool Extract(std::string& lpszURL, const std::function<bool(const std::string&)>& pAccept = nullptr);
+
+	/**
+	 * @brief Removes the best of the URLs that Extract set aside for a host, and marks it as visited.
+	 * @param lpszHost The host, as returned by CPolitenessScheduler::GetHost.
+	 * @param[out] lpszURL The extracted URL.
+	 * @return true if a URL was extracted, false if none is held for the host.
+	 */
+	bool ExtractHeld(const std::string& lpszHost, std::string& lpszURL);
+
+	/**
+	 * @brief Hands over the cash of an extracted URL whose page is being crawled,
+	 *        so it can be split among the page's outlinks.
+	 * @return The cash, or 0 if the URL holds none.
+	 */
+	double TakeCash(const std::string& lpszURL);
+
+	/**
+	 * @brief Switches the visited set from an exact hash set to a Bloom filter.
+	 *        Must be called before the first URL is extracted.
+	 * @param nMemoryBytes Memory budget of the filter, in bytes.
+	 * @param rFalsePositiveRate Target false positive rate.
+	 * @return true if the filter was created.
+	 */
+	bool SetVisitedFilter(size_t nMemoryBytes, double rFalsePositiveRate);
+
+	/**
+	 * @brief Enables spilling to disk and starts the background merge/refill thread.
+	 * @param lpszDirectory Existing directory for the segment files.
+	 * @param nHeadCapacity Maximum number of URLs kept in the in-memory heap.
+	 * @return true if spilling was enabled.
+	 */
+	bool SetSpillDirectory(const std::string& lpszDirectory, size_t nHeadCapacity);
+
+	/**
+	 * @brief Stops the background thread and closes the segment files.
+	 */
+	void Close();
+
+	/**
+	 * @brief Stops the background thread and forgets every queued and visited URL.
+	 *        Segment files are left on disk.
+	 */
+	void Clear();
+
+	/**
+	 * @brief Writes the queue, the visited set and the list of segment cursors to a checkpoint.
+	 * @param pStream The checkpoint stream.
+	 * @return true if the frontier was written.
+	 */
+	bool Save(std::ostream& pStream);
+
+	/**
+	 * @brief Restores a frontier written by Save, including its visited set mode and
+	 *        spill directory, and restarts the background thread if it had one.
+	 *        Must be called before the frontier is used.
+	 * @param pStream The checkpoint stream.
+	 * @return true if the frontier was restored; otherwise the frontier is left empty.
+	 */
+	bool Load(std::istream& pStream);
+
+	/**
+	 * @brief Keeps merged and consumed segment files on disk, because a checkpoint
+	 *        may still reference them, until PurgeRetiredSegments is called.
+	 */
+	void SetRetainSegments(bool bRetain) { m_bRetainSegments = bRetain; }
+
+	/**
+	 * @brief Deletes the segment files retired before the last Save, once that
+	 *        checkpoint has replaced the previous one.
+	 */
+	void PurgeRetiredSegments();
+
+	/**
+	 * @brief Checks whether a URL has already been extracted for crawling.
+	 *        With a Bloom filter this may report a new URL as visited.
+	 */
+	bool IsVisited(const std::string& lpszURL) const { return IsVisitedFingerprint(Fingerprint(lpszURL)); }
+	bool IsVisitedFingerprint(unsigned __int64 nFingerprint) const;
+
+	/**
+	 * @brief Computes the key under which a canonical URL is queued and marked as visited.
+	 */
+	static unsigned __int64 Fingerprint(const std::string& lpszURL);
+
+	/**
+	 * @brief Publishes queue size, visited count and filter statistics.
+	 */
+	void ExportMetrics(CCrawlerMetrics& pMetrics) const;
+
+	/**
+	 * @brief Gives access to the visited filter so it can be saved with the crawl state.
+	 */
+	CBloomFilter& GetVisitedFilter() { return m_pVisitedFilter; }
+
+	unsigned __int64 GetQueuedCount() const;
+	unsigned __int64 GetVisitedCount() const { return m_nVisitedCount; }
+	bool IsEmpty() const { return (GetQueuedCount() == 0); }
+
+protected:
+	void InsertVisited(unsigned __int64 nFingerprint);
+	std::string GetURL(const CFrontierNode& pNode) const;
+	void CompactArena();
+	void Swap(std::vector<CFrontierNode>& arrHeap, size_t nFirst, size_t nSecond);
+	void SiftUp(std::vector<CFrontierNode>& arrHeap, size_t nIndex);
+	void SiftDown(std::vector<CFrontierNode>& arrHeap, size_t nIndex);
+	CFrontierNode PopHeap(std::vector<CFrontierNode>& arrHeap);
+	void PushHeap(std::vector<CFrontierNode>& arrHeap, const CFrontierNode& pNode);
+	void RebuildHeap();
+	void ExtractNode(const CFrontierNode& pNode);
+	void Hold(const std::string& lpszHost, const CFrontierNode& pNode);
+	void ReleaseHeld();
+
+	void Spill();
+	void SpillThreadProc();
+	bool LoadState(std::istream& pStream);
+	void RetireSegment(const std::shared_ptr<CFrontierSegment>& pSegment);
+	void RemoveStaleSegments();
+	bool WritePendingSpills();
+	bool RefillStaging();
+	bool MergeSegments();
+
+protected:
+	std::vector<CFrontierNode> m_arrHeap;                   ///< Binary max-heap of queued URLs
+	std::unordered_map<unsigned __int64, size_t> m_mapPosition; ///< Fingerprint to index in the main or held heap
+	std::unordered_map<std::string, std::vector<CFrontierNode>> m_mapHeld; ///< Per-host heaps of URLs refused by Extract
+	size_t m_nHeldCount = 0;                                ///< URLs in the held heaps
+	std::unordered_set<unsigned __int64> m_setVisited;     ///< Fingerprints already extracted (exact mode)
+	std::vector<char> m_arrArena;                           ///< Text of the queued URLs, back to back
+	size_t m_nArenaGarbage = 0;                             ///< Arena bytes of URLs no longer queued
+	CBloomFilter m_pVisitedFilter;                          ///< URLs already extracted (filter mode)
+	unsigned __int64 m_nVisitedCount = 0;                   ///< Number of URLs extracted
+	unsigned __int64 m_nSequence = 0;                       ///< Discovery counter used for tie-breaking
+	std::unordered_map<unsigned __int64, double> m_mapCash; ///< Cash of extracted URLs not crawled yet
+	double m_rCashCrawled = 0.0;                            ///< Cash handed over by TakeCash so far
+	double m_rCashLost = 0.0;                               ///< Cash sent to pages already crawled or spilled
+
+	// Filter mode keeps an exact copy of a 1/FILTER_SAMPLE_RATE sample of the visited
+	// hashes, so the real false positive rate can be measured on the sampled lookups.
+	std::unordered_set<unsigned __int64> m_setVisitedSample;
+	mutable unsigned __int64 m_nSampleProbes = 0;          ///< Sampled lookups of unvisited URLs
+	mutable unsigned __int64 m_nSampleFalsePositives = 0;  ///< ... that the filter reported as visited
+
+	// Disk tier; m_mutexSpill guards the segment list, the staging buffer, the pending
+	// spills and the retired files, m_mutexCursors is held while the background thread
+	// writes segments or moves cursors.
+	std::string m_strSpillDirectory;
+	size_t m_nHeadCapacity = 0;
+	std::atomic<unsigned int> m_nNextSegment{ 0 };
+	size_t m_nMergeThreshold = 16;                          ///< Segment count that triggers a merge
+	std::vector<std::shared_ptr<CFrontierSegment>> m_arrSegments;
+	std::deque<CFrontierEntry> m_arrStaging;               ///< Best spilled URLs, in priority order
+	std::deque<std::vector<CFrontierEntry>> m_arrPendingSpills; ///< Spilled URLs not written to a segment yet
+	std::atomic<unsigned __int64> m_nSpilledCount{ 0 };    ///< URLs still stored in segments or pending
+	std::vector<std::string> m_arrRetired;                  ///< Segment files kept for the last checkpoint
+	size_t m_nRetiredAtSave = 0;                            ///< Retired files the last Save no longer needs
+	bool m_bRetainSegments = false;
+	mutable std::mutex m_mutexSpill;
+	std::mutex m_mutexCursors;
+	std::condition_variable m_eventSpill;
+	std::thread m_threadSpill;
+	bool m_bStopSpill = false;
+};
@@ -0,0 +1,308 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file WarcArchive.cpp
+ * @brief Implements the WARC file reader and writer.
+ */
+
+#include "stdafx.h"
+#include "WarcArchive.h"
+#include "HttpFetcher.h"
+#include "UrlCanonicalizer.h"
+#include "CrawlerMetrics.h"
+#include <filesystem>
+#include <random>
+#include <algorithm>
+
+#define WARC_VERSION "WARC/1.1"
+#define WARC_MAX_RECORD (1ULL << 31) // larger records are skipped rather than read into memory
+
+/**
+ * @brief Splits a "Name: value" header line; the name is lowercased and both parts are trimmed.
+ */
+static bool SplitHeaderLine(std::string_view lpszLine, std::string& strName, std::string_view& strValue)
+{
+	const size_t nColon = lpszLine.find(':');
+	if (nColon == std::string_view::npos)
+		return false;
+	strName.assign(lpszLine.substr(0, nColon));
+	std::transform(strName.begin(), strName.end(), strName.begin(), [](char ch) { return (char)tolower((unsigned char)ch); });
+	strValue = lpszLine.substr(nColon + 1);
+	const size_t nFirst = strValue.find_first_not_of(" \t");
+	const size_t nLast = strValue.find_last_not_of(" \t\r");
+	strValue = (nFirst == std::string_view::npos) ? std::string_view() : strValue.substr(nFirst, nLast - nFirst + 1);
+	return true;
+}
+
+CWarcArchive::CWarcArchive()
+{
+}
+
+CWarcArchive::~CWarcArchive()
+{
+}
+
+bool CWarcArchive::Open(const std::string& lpszPath)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_arrFiles.clear();
+	m_mapRecords.clear();
+
+	std::error_code pError;
+	if (!std::filesystem::is_directory(lpszPath, pError))
+		return IndexFile(lpszPath);
+
+	// in name order, so records of later files replace those of earlier ones
+	std::vector<std::string> arrPaths;
+	for (const auto& it : std::filesystem::directory_iterator(lpszPath, pError))
+	{
+		if (it.is_regular_file(pError) && (it.path().extension() == ".warc"))
+			arrPaths.push_back(it.path().string());
+	}
+	std::sort(arrPaths.begin(), arrPaths.end());
+	bool bIndexed = false;
+	for (const auto& it : arrPaths)
+		bIndexed = IndexFile(it) || bIndexed;
+	return bIndexed;
+}
+
+bool CWarcArchive::IndexFile(const std::string& lpszPath)
+{
+	auto pFile = std::make_unique<std::ifstream>(lpszPath, std::ios::binary);
+	if (!pFile->is_open())
+		return false;
+	if (pFile->peek() == 0x1F)
+	{
+		gCrawlerMetrics.AddCounter("warc_compressed_files"); // gzip: not supported
+		return false;
+	}
+
+	const size_t nFile = m_arrFiles.size();
+	std::string strLine, strName, strType, strTarget, strContentType;
+	std::string_view strValue;
+	while (std::getline(*pFile, strLine))
+	{
+		if (strLine.empty() || (strLine == "\r"))
+			continue; // the CRLF pair that ends each record
+		if (!strLine.starts_with("WARC/"))
+			break; // not a record header: the rest of the file cannot be trusted
+
+		unsigned __int64 nLength = 0;
+		strType.clear();
+		strTarget.clear();
+		strContentType.clear();
+		while (std::getline(*pFile, strLine) && !strLine.empty() && (strLine != "\r"))
+		{
+			if (!SplitHeaderLine(strLine, strName, strValue))
+				continue;
+			if (strName == "warc-type")
+				strType = strValue;
+			else if (strName == "warc-target-uri")
+				strTarget = strValue;
+			else if (strName == "content-type")
+				strContentType = strValue;
+			else if (strName == "content-length")
+				nLength = strtoull(std::string(strValue).c_str(), nullptr, 10);
+		}
+		const std::streamoff nBlock = pFile->tellg();
+		if ((nBlock < 0) || !*pFile)
+			break;
+
+		// WARC 1.0 writers sometimes bracket the URI
+		if ((strTarget.length() >= 2) && (strTarget.front() == '<') && (strTarget.back() == '>'))
+			strTarget = strTarget.substr(1, strTarget.length() - 2);
+		if ((strType == "response") && !strTarget.empty() && strContentType.starts_with("application/http") && (nLength <= WARC_MAX_RECORD))
+		{
+			std::string strCanonical;
+			if (!CUrlCanonicalizer::Canonicalize(strTarget, strCanonical))
+				strCanonical = strTarget;
+			CRecord& pRecord = m_mapRecords[CUrlCanonicalizer::Fingerprint(strCanonical)];
+			pRecord.m_nFile = nFile;
+			pRecord.m_nOffset = static_cast<unsigned __int64>(nBlock);
+			pRecord.m_nLength = nLength;
+		}
+		pFile->seekg(nBlock + static_cast<std::streamoff>(nLength));
+	}
+	pFile->clear();
+	m_arrFiles.push_back(std::move(pFile));
+	return true;
+}
+
+bool CWarcArchive::Create(const std::string& lpszPath)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_pOutput.open(lpszPath, std::ios::binary | std::ios::app);
+	if (!m_pOutput.is_open())
+		return false;
+	m_pOutput.seekp(0, std::ios::end);
+	if (m_pOutput.tellp() == 0)
+	{
+		const std::string strFields = "software: WebSearchEngine\r\nformat: WARC File Format 1.1\r\n";
+		m_pOutput << WARC_VERSION "\r\nWARC-Type: warcinfo\r\nWARC-Record-ID: <urn:uuid:" << NewRecordID() <<
+			">\r\nContent-Type: application/warc-fields\r\nContent-Length: " << strFields.length() << "\r\n\r\n" << strFields << "\r\n\r\n";
+	}
+	return m_pOutput.good();
+}
+
+CWarcArchive::Status CWarcArchive::Read(const std::string& lpszURL, CFetchResult& pResult, unsigned __int64 nMaxLength)
+{
+	const unsigned __int64 nFingerprint = CUrlCanonicalizer::Fingerprint(lpszURL);
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_mapRecords.find(nFingerprint);
+		if (it == m_mapRecords.end())
+			return Status::NOT_FOUND;
+		if ((nMaxLength > 0) && (it->second.m_nLength > nMaxLength))
+			return Status::TOO_LARGE; // decided before the buffer grows to the record's size
+
+		const size_t nLength = static_cast<size_t>(it->second.m_nLength);
+		if (pResult.m_arrBuffer.size() < nLength)
+			pResult.m_arrBuffer.resize(nLength);
+		std::ifstream& pFile = *m_arrFiles[it->second.m_nFile];
+		pFile.clear();
+		pFile.seekg(static_cast<std::streamoff>(it->second.m_nOffset));
+		if (!pFile.read(pResult.m_arrBuffer.data(), static_cast<std::streamsize>(nLength)))
+			return Status::NOT_FOUND;
+		pResult.m_nLength = nLength;
+	}
+	return ParseMessage(pResult) ? Status::READ : Status::NOT_FOUND;
+}
+
+bool CWarcArchive::ParseMessage(CFetchResult& pResult)
+{
+	// status line and headers, then the body, which is moved to the front of the buffer
+	const std::string_view pMessage(pResult.m_arrBuffer.data(), pResult.m_nLength);
+	size_t nBody = pMessage.find("\r\n\r\n");
+	nBody = (nBody == std::string_view::npos) ? pMessage.find("\n\n") : nBody;
+	if ((nBody == std::string_view::npos) || !pMessage.starts_with("HTTP/"))
+		return false;
+	const std::string_view pHeader = pMessage.substr(0, nBody);
+	nBody += (pMessage[nBody] == '\r') ? 4 : 2;
+
+	const size_t nSpace = pHeader.find(' ');
+	if (nSpace == std::string_view::npos)
+		return false;
+	pResult.m_nStatusCode = static_cast<DWORD>(atoi(std::string(pHeader.substr(nSpace + 1, 3)).c_str()));
+
+	bool bChunked = false;
+	std::string strName;
+	std::string_view strValue;
+	for (size_t nLine = pHeader.find('\n'); nLine != std::string_view::npos;)
+	{
+		const size_t nNext = pHeader.find('\n', nLine + 1);
+		if (SplitHeaderLine(pHeader.substr(nLine + 1, (nNext == std::string_view::npos) ? std::string_view::npos : nNext - nLine - 1), strName, strValue))
+		{
+			if (strName == "content-type")
+				pResult.m_strContentType = strValue;
+			else if (strName == "etag")
+				pResult.m_strETag = strValue;
+			else if (strName == "last-modified")
+				pResult.m_strLastModified = strValue;
+			else if ((strName == "transfer-encoding") && (strValue.find("chunked") != std::string_view::npos))
+				bChunked = true;
+			else if ((strName == "content-encoding") && (strValue != "identity"))
+			{
+				gCrawlerMetrics.AddCounter("warc_encoded_bodies"); // would need inflating
+				return false;
+			}
+		}
+		nLine = nNext;
+	}
+
+	memmove(pResult.m_arrBuffer.data(), pResult.m_arrBuffer.data() + nBody, pResult.m_nLength - nBody);
+	pResult.m_nLength -= nBody;
+	return !bChunked || DecodeChunked(pResult);
+}
+
+bool CWarcArchive::DecodeChunked(CFetchResult& pResult)
+{
+	// in place: the decoded body is never longer than the chunked one
+	char* pBuffer = pResult.m_arrBuffer.data();
+	size_t nRead = 0, nWrite = 0;
+	while (nRead < pResult.m_nLength)
+	{
+		const char* pLineEnd = static_cast<const char*>(memchr(pBuffer + nRead, '\n', pResult.m_nLength - nRead));
+		if (pLineEnd == nullptr)
+			return false;
+		const size_t nChunk = static_cast<size_t>(strtoull(std::string(static_cast<const char*>(pBuffer + nRead), pLineEnd).c_str(), nullptr, 16));
+		nRead = pLineEnd - pBuffer + 1;
+		if (nChunk == 0)
+			break;
+		if (nChunk > pResult.m_nLength - nRead)
+			return false;
+		memmove(pBuffer + nWrite, pBuffer + nRead, nChunk);
+		nWrite += nChunk;
+		nRead += nChunk;
+		if ((nRead < pResult.m_nLength) && (pBuffer[nRead] == '\r'))
+			nRead++;
+		if ((nRead < pResult.m_nLength) && (pBuffer[nRead] == '\n'))
+			nRead++;
+	}
+	pResult.m_nLength = nWrite;
+	return true;
+}
+
+bool CWarcArchive::Write(const CFetchResult& pResult)
+{
+	const std::string_view pBody = pResult.GetBody();
+	std::string strMessage = "HTTP/1.1 " + std::to_string(pResult.m_nStatusCode) + " \r\n";
+	if (!pResult.m_strContentType.empty())
+		strMessage += "Content-Type: " + pResult.m_strContentType + "\r\n";
+	if (!pResult.m_strETag.empty())
+		strMessage += "ETag: " + pResult.m_strETag + "\r\n";
+	if (!pResult.m_strLastModified.empty())
+		strMessage += "Last-Modified: " + pResult.m_strLastModified + "\r\n";
+	strMessage += "Content-Length: " + std::to_string(pBody.length()) + "\r\n\r\n";
+
+	SYSTEMTIME pNow;
+	::GetSystemTime(&pNow);
+	char lpszDate[32] = { 0, };
+	sprintf_s(lpszDate, _countof(lpszDate), "%04u-%02u-%02uT%02u:%02u:%02uZ",
+		pNow.wYear, pNow.wMonth, pNow.wDay, pNow.wHour, pNow.wMinute, pNow.wSecond);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_pOutput.is_open())
+		return false;
+	m_pOutput << WARC_VERSION "\r\nWARC-Type: response\r\nWARC-Record-ID: <urn:uuid:" << NewRecordID() <<
+		">\r\nWARC-Date: " << lpszDate << "\r\nWARC-Target-URI: " << pResult.m_strURL <<
+		"\r\nContent-Type: application/http;msgtype=response\r\nContent-Length: " << (strMessage.length() + pBody.length()) << "\r\n\r\n";
+	m_pOutput << strMessage;
+	m_pOutput.write(pBody.data(), static_cast<std::streamsize>(pBody.length()));
+	m_pOutput << "\r\n\r\n";
+	m_nWritten++;
+	return m_pOutput.good();
+}
+
+std::string CWarcArchive::NewRecordID()
+{
+	// random (version 4) UUID
+	static thread_local std::mt19937_64 pEngine(std::random_device{}());
+	const unsigned __int64 nHigh = (pEngine() & 0xFFFFFFFFFFFF0FFFULL) | 0x0000000000004000ULL;
+	const unsigned __int64 nLow = (pEngine() & 0x3FFFFFFFFFFFFFFFULL) | 0x8000000000000000ULL;
+	char lpszID[40] = { 0, };
+	sprintf_s(lpszID, _countof(lpszID), "%08x-%04x-%04x-%04x-%012llx",
+		static_cast<unsigned int>(nHigh >> 32), static_cast<unsigned int>((nHigh >> 16) & 0xFFFF), static_cast<unsigned int>(nHigh & 0xFFFF),
+		static_cast<unsigned int>(nLow >> 48), nLow & 0xFFFFFFFFFFFFULL);
+	return lpszID;
+}
+
+void CWarcArchive::ExportMetrics(CCrawlerMetrics& pMetrics) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_arrFiles.empty())
+		pMetrics.SetGauge("warc_indexed_records", static_cast<double>(m_mapRecords.size()));
+	if (m_pOutput.is_open())
+		pMetrics.SetGauge("warc_written_records", static_cast<double>(m_nWritten));
+}
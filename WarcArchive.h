@@ -0,0 +1,104 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file WarcArchive.h
+ * @brief Declaration of the WARC file reader and writer used to record and replay crawls.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <fstream>
+#include <unordered_map>
+
+class CFetchResult;
+class CCrawlerMetrics;
+
+/**
+ * @class CWarcArchive
+ * @brief Response records of web crawls in the WARC 1.1 format (ISO 28500).
+ *
+ * Open indexes the "response" records of one .warc file, or of every .warc file
+ * in a directory, by the fingerprint of their canonical target URI; Read then
+ * finds a URL in constant time and reads only its record. When a URL was
+ * recorded more than once the last record wins. Create appends to a file, and
+ * Write stores each response with its decoded body, so a recorded crawl replays
+ * exactly. Compressed (.warc.gz) files and content-encoded bodies are not
+ * supported. Safe to use from any thread.
+ */
+class CWarcArchive
+{
+public:
+	CWarcArchive();
+	~CWarcArchive();
+
+public:
+	/**
+	 * @brief Indexes an archive for reading.
+	 * @param lpszPath A .warc file, or a directory whose .warc files are all indexed.
+	 * @return false if nothing could be read.
+	 */
+	bool Open(const std::string& lpszPath);
+
+	/**
+	 * @brief Opens a file to record responses into; records are appended to an existing file.
+	 */
+	bool Create(const std::string& lpszPath);
+
+	/// Outcome of Read.
+	enum class Status
+	{
+		READ,        ///< The response is in the fetch result
+		NOT_FOUND,   ///< The URL is not in the archive, or its record cannot be read
+		TOO_LARGE    ///< The record is longer than the limit and was left unread
+	};
+
+	/**
+	 * @brief Reads the response recorded for a URL into a fetch result.
+	 * @param nMaxLength Longest record to read, in bytes, headers included; 0 for no limit.
+	 */
+	Status Read(const std::string& lpszURL, CFetchResult& pResult, unsigned __int64 nMaxLength = 0);
+
+	/**
+	 * @brief Appends a received response as a WARC response record.
+	 */
+	bool Write(const CFetchResult& pResult);
+
+	void ExportMetrics(CCrawlerMetrics& pMetrics) const;
+
+protected:
+	/// Where the HTTP message of a response record is stored.
+	struct CRecord
+	{
+		size_t m_nFile = 0;
+		unsigned __int64 m_nOffset = 0;
+		unsigned __int64 m_nLength = 0;
+	};
+
+	bool IndexFile(const std::string& lpszPath);
+	static bool ParseMessage(CFetchResult& pResult);
+	static bool DecodeChunked(CFetchResult& pResult);
+	static std::string NewRecordID();
+
+protected:
+	mutable std::mutex m_mutex;
+	std::vector<std::unique_ptr<std::ifstream>> m_arrFiles;      ///< Indexed files, read under the lock
+	std::unordered_map<unsigned __int64, CRecord> m_mapRecords;   ///< Keyed by URL fingerprint
+	std::ofstream m_pOutput;
+	unsigned __int64 m_nWritten = 0;                             ///< Records appended by Write
+};
@@ -31,6 +31,9 @@ WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
 #endif
 
 DWORD WINAPI CrawlingThreadProc(LPVOID lpParam);
+DWORD WINAPI CrawlingWorkerProc(LPVOID lpParam);
+
+#define DNS_PREFETCH_INTERVAL 500 // milliseconds between two prefetches of the hosts scheduled next
 
 // CAboutDlg dialog used for App About
 
@@ -246,17 +249,89 @@ BOOL CWebSearchEngineDlg::OnInitDialog()
 	nRet = m_pConnection.DriverConnect(const_cast<SQLTCHAR*>(reinterpret_cast<const SQLTCHAR*>(m_sConnectionInString)), m_sConnectionOutString);
 	ODBC_CHECK_RETURN_FALSE(nRet, m_pConnection);
 
-	m_pWebpageCounter.SetWindowText(_T("0"));
-	m_pKeywordCounter.SetWindowText(_T("0"));
+	CString strCheckpoint = pWinApp->GetProfileString(REGKEY_SECTION, REGKEY_CHECKPOINT, DEFAULT_CHECKPOINT);
+	if (strCheckpoint.IsEmpty())
+	{
+		TCHAR lpszLocalAppData[MAX_PATH + 1] = { 0, };
+		if (::GetEnvironmentVariable(_T("LOCALAPPDATA"), lpszLocalAppData, MAX_PATH) > 0)
+		{
+			strCheckpoint = CString(lpszLocalAppData) + _T("\\WebSearchEngine");
+			::CreateDirectory(strCheckpoint, nullptr);
+			strCheckpoint += _T("\\crawl.ckpt");
+		}
+	}
+	ConfigureCrawlCheckpoint(std::string(CStringA(strCheckpoint)),
+		pWinApp->GetProfileInt(REGKEY_SECTION, REGKEY_CHECKPOINTINTERVAL, DEFAULT_CHECKPOINTINTERVAL));
+
+	// a restored crawl keeps the frontier settings it was started with
+	const CheckpointState nCheckpoint = LoadCrawlCheckpoint();
+	if (nCheckpoint == CheckpointState::UNREADABLE)
+	{
+		// only a missing checkpoint means a fresh crawl: the stored pages are kept for the user to decide
+		MessageBox(_T("Cannot load the crawl checkpoint:\n") + strCheckpoint +
+			_T("\n\nThe database was left unchanged. Move or delete the checkpoint file to start a new crawl."), _T("Error"), MB_OK | MB_ICONERROR);
+		EndDialog(IDCANCEL);
+		return FALSE;
+	}
+	const bool bResumed = (nCheckpoint == CheckpointState::RESUMED);
+	if (!bResumed)
+	{
+		const UINT nVisitedFilter = pWinApp->GetProfileInt(REGKEY_SECTION, REGKEY_VISITEDFILTER, DEFAULT_VISITEDFILTER);
+		const UINT nFalsePositive = pWinApp->GetProfileInt(REGKEY_SECTION, REGKEY_FALSEPOSITIVE, DEFAULT_FALSEPOSITIVE);
+		VERIFY(ConfigureVisitedFilter(nVisitedFilter, nFalsePositive));
+		const CString strSpillDirectory = pWinApp->GetProfileString(REGKEY_SECTION, REGKEY_SPILLDIRECTORY, DEFAULT_SPILLDIRECTORY);
+		const UINT nFrontierHead = pWinApp->GetProfileInt(REGKEY_SECTION, REGKEY_FRONTIERHEAD, DEFAULT_FRONTIERHEAD);
+		VERIFY(ConfigureFrontierSpill(std::string(CStringA(strSpillDirectory)), nFrontierHead));
+	}
+	ConfigurePoliteness(pWinApp->GetProfileInt(REGKEY_SECTION, REGKEY_BACKQUEUES, DEFAULT_BACKQUEUES),
+		pWinApp->GetProfileInt(REGKEY_SECTION, REGKEY_HOSTDELAY, DEFAULT_HOSTDELAY));
+	ConfigureSpiderTraps(pWinApp->GetProfileInt(REGKEY_SECTION, REGKEY_HOSTBUDGET, DEFAULT_HOSTBUDGET),
+		pWinApp->GetProfileInt(REGKEY_SECTION, REGKEY_PATTERNBUDGET, DEFAULT_PATTERNBUDGET),
+		pWinApp->GetProfileInt(REGKEY_SECTION, REGKEY_MAXDEPTH, DEFAULT_MAXDEPTH));
+	m_nCrawlerThreads = pWinApp->GetProfileInt(REGKEY_SECTION, REGKEY_CRAWLERTHREADS, DEFAULT_CRAWLERTHREADS);
+	m_nCrawlerThreads = std::max<UINT>(1, std::min<UINT>(m_nCrawlerThreads, MAXIMUM_WAIT_OBJECTS));
+	m_nFetchInFlight = std::max<UINT>(1, pWinApp->GetProfileInt(REGKEY_SECTION, REGKEY_FETCHINFLIGHT, DEFAULT_FETCHINFLIGHT));
+	m_nConnectionsPerHost = pWinApp->GetProfileInt(REGKEY_SECTION, REGKEY_CONNECTIONSPERHOST, DEFAULT_CONNECTIONSPERHOST);
+	m_nIdleTimeout = pWinApp->GetProfileInt(REGKEY_SECTION, REGKEY_IDLETIMEOUT, DEFAULT_IDLETIMEOUT);
+	m_nMaxBodySize = pWinApp->GetProfileInt(REGKEY_SECTION, REGKEY_MAXBODYSIZE, DEFAULT_MAXBODYSIZE);
+	m_strWarcReplay = pWinApp->GetProfileString(REGKEY_SECTION, REGKEY_WARCREPLAY, DEFAULT_WARCREPLAY);
+	m_strWarcRecord = pWinApp->GetProfileString(REGKEY_SECTION, REGKEY_WARCRECORD, DEFAULT_WARCRECORD);
+	const CString strDnsServer = pWinApp->GetProfileString(REGKEY_SECTION, REGKEY_DNSSERVER, DEFAULT_DNSSERVER);
+	VERIFY(ConfigureResolver(pWinApp->GetProfileInt(REGKEY_SECTION, REGKEY_NEGATIVETTL, DEFAULT_NEGATIVETTL),
+		std::string(CStringA(strDnsServer))));
+	ConfigureRobots(pWinApp->GetProfileInt(REGKEY_SECTION, REGKEY_ROBOTSCACHE, DEFAULT_ROBOTSCACHE));
+
+	__int64 nWebpages = 0, nKeywords = 0;
+	GetCrawlCounters(nWebpages, nKeywords);
+	m_pWebpageCounter.SetWindowText(std::to_wstring(nWebpages).c_str());
+	m_pKeywordCounter.SetWindowText(std::to_wstring(nKeywords).c_str());
 
 	CGenericStatement pGenericStatement;
-	VERIFY(pGenericStatement.Execute(m_pConnection, _T("DROP TABLE IF EXISTS `occurrence`;")));
-	VERIFY(pGenericStatement.Execute(m_pConnection, _T("DROP TABLE IF EXISTS `keyword`;")));
-	VERIFY(pGenericStatement.Execute(m_pConnection, _T("DROP TABLE IF EXISTS `webpage`;")));
-	VERIFY(pGenericStatement.Execute(m_pConnection, _T("CREATE TABLE `webpage` (`webpage_id` BIGINT NOT NULL AUTO_INCREMENT, `url` VARCHAR(256) NOT NULL, `title` VARCHAR(256) NOT NULL, `content` LONGTEXT NOT NULL, PRIMARY KEY(`webpage_id`)) ENGINE=InnoDB CHARACTER SET utf8 COLLATE utf8_general_ci;")));
-	VERIFY(pGenericStatement.Execute(m_pConnection, _T("CREATE TABLE `keyword` (`keyword_id` BIGINT NOT NULL AUTO_INCREMENT, `name` VARCHAR(256) NOT NULL, PRIMARY KEY(`keyword_id`)) ENGINE=InnoDB CHARACTER SET utf8 COLLATE utf8_general_ci;")));
-	VERIFY(pGenericStatement.Execute(m_pConnection, _T("CREATE TABLE `occurrence` (`webpage_id` BIGINT NOT NULL, `keyword_id` BIGINT NOT NULL, `counter` BIGINT NOT NULL, `pagerank` REAL NOT NULL, PRIMARY KEY(`webpage_id`, `keyword_id`), FOREIGN KEY webpage_fk(webpage_id) REFERENCES webpage(webpage_id), FOREIGN KEY keyword_fk(keyword_id) REFERENCES keyword(keyword_id)) ENGINE=InnoDB CHARACTER SET utf8 COLLATE utf8_general_ci;")));
-	VERIFY(pGenericStatement.Execute(m_pConnection, _T("CREATE UNIQUE INDEX index_name ON `keyword`(`name`);")));
+	if (bResumed)
+	{
+		// rows written after the checkpoint belong to pages that will be crawled again
+		CString strStatement;
+		strStatement.Format(_T("DELETE FROM `occurrence` WHERE `webpage_id` > %I64d OR `keyword_id` > %I64d;"), nWebpages, nKeywords);
+		VERIFY(pGenericStatement.Execute(m_pConnection, strStatement));
+		strStatement.Format(_T("DELETE FROM `webpage` WHERE `webpage_id` > %I64d;"), nWebpages);
+		VERIFY(pGenericStatement.Execute(m_pConnection, strStatement));
+		strStatement.Format(_T("DELETE FROM `keyword` WHERE `keyword_id` > %I64d;"), nKeywords);
+		VERIFY(pGenericStatement.Execute(m_pConnection, strStatement));
+		strStatement.Format(_T("ALTER TABLE `webpage` AUTO_INCREMENT = %I64d;"), nWebpages + 1);
+		VERIFY(pGenericStatement.Execute(m_pConnection, strStatement));
+		strStatement.Format(_T("ALTER TABLE `keyword` AUTO_INCREMENT = %I64d;"), nKeywords + 1);
+		VERIFY(pGenericStatement.Execute(m_pConnection, strStatement));
+	}
+	else
+	{
+		VERIFY(pGenericStatement.Execute(m_pConnection, _T("DROP TABLE IF EXISTS `occurrence`;")));
+		VERIFY(pGenericStatement.Execute(m_pConnection, _T("DROP TABLE IF EXISTS `keyword`;")));
+		VERIFY(pGenericStatement.Execute(m_pConnection, _T("DROP TABLE IF EXISTS `webpage`;")));
+		VERIFY(pGenericStatement.Execute(m_pConnection, _T("CREATE TABLE `webpage` (`webpage_id` BIGINT NOT NULL AUTO_INCREMENT, `url` VARCHAR(256) NOT NULL, `title` VARCHAR(256) NOT NULL, `content` LONGTEXT NOT NULL, PRIMARY KEY(`webpage_id`)) ENGINE=InnoDB CHARACTER SET utf8 COLLATE utf8_general_ci;")));
+		VERIFY(pGenericStatement.Execute(m_pConnection, _T("CREATE TABLE `keyword` (`keyword_id` BIGINT NOT NULL AUTO_INCREMENT, `name` VARCHAR(256) NOT NULL, PRIMARY KEY(`keyword_id`)) ENGINE=InnoDB CHARACTER SET utf8 COLLATE utf8_general_ci;")));
+		VERIFY(pGenericStatement.Execute(m_pConnection, _T("CREATE TABLE `occurrence` (`webpage_id` BIGINT NOT NULL, `keyword_id` BIGINT NOT NULL, `counter` BIGINT NOT NULL, `pagerank` REAL NOT NULL, PRIMARY KEY(`webpage_id`, `keyword_id`), FOREIGN KEY webpage_fk(webpage_id) REFERENCES webpage(webpage_id), FOREIGN KEY keyword_fk(keyword_id) REFERENCES keyword(keyword_id)) ENGINE=InnoDB CHARACTER SET utf8 COLLATE utf8_general_ci;")));
+		VERIFY(pGenericStatement.Execute(m_pConnection, _T("CREATE UNIQUE INDEX index_name ON `keyword`(`name`);")));
+	}
 
 	m_hThread = ::CreateThread(nullptr, 0, (LPTHREAD_START_ROUTINE)CrawlingThreadProc, this, 0, &m_nThreadID);
 
@@ -364,31 +439,112 @@ HCURSOR CWebSearchEngineDlg::OnQueryDragIcon()
 
 DWORD WINAPI CrawlingThreadProc(LPVOID lpParam)
 {
-	std::string lpszURL, lpszFilename;
+	HANDLE hWorkers[MAXIMUM_WAIT_OBJECTS] = { nullptr, };
+	DWORD nWorkers = 0;
 	if (lpParam != NULL)
 	{
 		CWebSearchEngineDlg* pWebSearchEngineDlg = (CWebSearchEngineDlg*)lpParam;
+		CHttpFetcher pFetcher;
+		pFetcher.Configure(pWebSearchEngineDlg->m_nConnectionsPerHost, pWebSearchEngineDlg->m_nIdleTimeout);
+		pFetcher.SetMaxBodySize(static_cast<size_t>(pWebSearchEngineDlg->m_nMaxBodySize) * 1024);
+		// a replayed crawl never touches the network, not even to resolve hosts
+		if (!pWebSearchEngineDlg->m_strWarcReplay.IsEmpty())
+		{
+			const bool bReplaying = pFetcher.SetReplayArchive(std::string(CStringA(pWebSearchEngineDlg->m_strWarcReplay)));
+			ASSERT(bReplaying);
+			SetOfflineCrawl(bReplaying);
+		}
+		if (!pWebSearchEngineDlg->m_strWarcRecord.IsEmpty())
+			VERIFY(pFetcher.SetRecordArchive(std::string(CStringA(pWebSearchEngineDlg->m_strWarcRecord))));
+		pWebSearchEngineDlg->m_pFetcher = &pFetcher;
 		pWebSearchEngineDlg->m_bThreadRunning = true;
 		pWebSearchEngineDlg->m_pProgress.SetMarquee(TRUE, 30);
 		AddURLToFrontier("https://en.wikipedia.org/");
-		while (pWebSearchEngineDlg->m_bThreadRunning)
+		for (UINT nIndex = 0; nIndex < pWebSearchEngineDlg->m_nCrawlerThreads; nIndex++)
+		{
+			hWorkers[nWorkers] = ::CreateThread(nullptr, 0, (LPTHREAD_START_ROUTINE)CrawlingWorkerProc, pWebSearchEngineDlg, 0, nullptr);
+			if (hWorkers[nWorkers] != nullptr)
+				nWorkers++;
+		}
+
+		// this thread keeps the fetcher busy; the workers process the pages it downloads
+		std::string lpszURL;
+		std::string strRobotsURL;
+		std::deque<std::string> arrWaiting; // extracted URLs whose host is being resolved or whose robots.txt is being fetched
+		ULONGLONG nLastMetrics = ::GetTickCount64();
+		ULONGLONG nLastPrefetch = 0;
+		while (pWebSearchEngineDlg->m_bThreadRunning && (nWorkers > 0))
 		{
-			if (ExtractURLFromFrontier(lpszURL))
+			// robots.txt files go ahead of the pages waiting for them
+			while (TakeRobotsFetch(strRobotsURL))
+			{
+				if (!pFetcher.Submit(strRobotsURL, FETCH_TAG_ROBOTS, false))
+					CompleteRobotsFetch(strRobotsURL, false, 0, std::string_view());
+			}
+
+			// hand the URLs that have become ready to the fetcher
+			for (size_t nIndex = arrWaiting.size(); nIndex > 0; nIndex--)
+			{
+				std::string strURL = std::move(arrWaiting.front());
+				arrWaiting.pop_front();
+				const FetchReadiness nReadiness = PrepareURLForFetch(strURL, false);
+				if (nReadiness == FetchReadiness::WAIT)
+					arrWaiting.push_back(std::move(strURL));
+				else if ((nReadiness == FetchReadiness::DROP) || !pFetcher.Submit(strURL))
+					ReleaseURLToFrontier(strURL);
+			}
+			if (::GetTickCount64() - nLastPrefetch >= DNS_PREFETCH_INTERVAL)
+			{
+				PrefetchFrontierHosts();
+				nLastPrefetch = ::GetTickCount64();
+			}
+
+			const size_t nInFlight = pFetcher.GetPendingCount() + arrWaiting.size();
+			if (IsCheckpointDue())
+			{
+				// a checkpoint needs every fetch finished and every page processed
+				if (nInFlight == 0)
+					SaveCrawlCheckpoint(false);
+				else
+					::Sleep(10);
+			}
+			else if (nInFlight < pWebSearchEngineDlg->m_nFetchInFlight)
 			{
-				pWebSearchEngineDlg->m_pCrawling.SetWindowText(CString(lpszURL.c_str()));
-				if (DownloadURLToFile(lpszURL, lpszFilename))
+				if (ExtractURLFromFrontier(lpszURL))
 				{
-					if (!ProcessHTML(pWebSearchEngineDlg, lpszFilename, lpszURL))
-					{
-						break;
-					}
+					const FetchReadiness nReadiness = PrepareURLForFetch(lpszURL, true);
+					if (nReadiness == FetchReadiness::WAIT)
+						arrWaiting.push_back(lpszURL);
+					else if ((nReadiness == FetchReadiness::DROP) || !pFetcher.Submit(lpszURL))
+						ReleaseURLToFrontier(lpszURL);
 				}
+				else if ((nInFlight == 0) && IsFrontierEmpty())
+					break;
 			}
 			else
-				break;
+				::Sleep(10);
+
+			if (::GetTickCount64() - nLastMetrics >= 60 * 1000)
+			{
+				DumpCrawlerMetrics(&pFetcher);
+				nLastMetrics = ::GetTickCount64();
+			}
 		}
 
+		// cancelled downloads come back as failed results and their URLs go back to the frontier
 		pWebSearchEngineDlg->m_bThreadRunning = false;
+		for (const auto& it : arrWaiting)
+			ReturnURLToFrontier(it);
+		pFetcher.Cancel();
+		CancelResolver();
+		::WaitForMultipleObjects(nWorkers, hWorkers, TRUE, INFINITE);
+		for (DWORD nIndex = 0; nIndex < nWorkers; nIndex++)
+			::CloseHandle(hWorkers[nIndex]);
+
+		pWebSearchEngineDlg->m_pCrawling.SetWindowText(_T("saving crawl checkpoint..."));
+		SaveCrawlCheckpoint(true);
+		DumpCrawlerMetrics(&pFetcher);
+		pWebSearchEngineDlg->m_pFetcher = nullptr;
 		pWebSearchEngineDlg->m_pProgress.SetMarquee(FALSE, 30);
 	}
 
@@ -396,6 +552,56 @@ DWORD WINAPI CrawlingThreadProc(LPVOID lpParam)
 	return 0;
 }
 
+DWORD WINAPI CrawlingWorkerProc(LPVOID lpParam)
+{
+	std::unique_ptr<CFetchResult> pResult;
+	CWebSearchEngineDlg* pWebSearchEngineDlg = (CWebSearchEngineDlg*)lpParam;
+	CHttpFetcher* pFetcher = pWebSearchEngineDlg->m_pFetcher;
+	while (true)
+	{
+		if (!pFetcher->WaitForResult(pResult, 100))
+		{
+			// stop once the crawl is over and every download has been handed out
+			if (!pWebSearchEngineDlg->m_bThreadRunning && (pFetcher->GetPendingCount() == 0))
+				break;
+			continue;
+		}
+		if (pResult->m_nTag == FETCH_TAG_ROBOTS)
+		{
+			// a cancelled robots.txt fetch is forgotten, not taken for an unreachable site
+			if (pWebSearchEngineDlg->m_bThreadRunning)
+				CompleteRobotsFetch(pResult->m_strURL, pResult->m_bReceived, pResult->m_nStatusCode, pResult->GetBody());
+			else
+				DiscardRobotsFetch(pResult->m_strURL);
+			pFetcher->Recycle(std::move(pResult));
+			continue;
+		}
+
+		bool bProcessed = true;
+		EnterCrawlPage();
+		if (pWebSearchEngineDlg->m_bThreadRunning)
+		{
+			pWebSearchEngineDlg->m_pCrawling.SetWindowText(CString(pResult->m_strURL.c_str()));
+			const double rCash = ReleaseURLToFrontier(*pResult);
+			if (pResult->IsSuccess())
+				bProcessed = ProcessHTML(pWebSearchEngineDlg, pResult->GetBody(), pResult->m_strURL, rCash);
+		}
+		else
+			ReturnURLToFrontier(pResult->m_strURL);
+		LeaveCrawlPage();
+		pFetcher->Recycle(std::move(pResult));
+
+		if (!bProcessed)
+		{
+			// the database is gone: stop the crawl
+			pWebSearchEngineDlg->m_bThreadRunning = false;
+		}
+	}
+
+	::ExitThread(0);
+	return 0;
+}
+
 BOOL WaitWithMessageLoop(HANDLE hEvent, DWORD dwTimeout)
 {
 	DWORD dwRet;
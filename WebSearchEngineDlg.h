@@ -18,9 +18,12 @@ WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
 #pragma once
 
 #include "ODBCWrappers.h"
+#include <atomic>
 #include "afxwin.h"
 #include "afxcmn.h"
 
+class CHttpFetcher;
+
 // CWebSearchEngineDlg dialog
 class CWebSearchEngineDlg : public CDialogEx
 {
@@ -42,7 +45,7 @@ protected:
 
 // Implementation
 public:
-	bool m_bThreadRunning;
+	std::atomic<bool> m_bThreadRunning;
 	HICON m_hIcon;
 	CODBC::CEnvironment m_pEnvironment;
 	CODBC::CConnection m_pConnection;
@@ -50,6 +53,14 @@ public:
 	TCHAR m_sConnectionInString[0x100] = { 0, };
 	DWORD m_nThreadID = 0;
 	HANDLE m_hThread = nullptr;
+	UINT m_nCrawlerThreads = 1;
+	UINT m_nFetchInFlight = 1;
+	UINT m_nConnectionsPerHost = 2;
+	UINT m_nIdleTimeout = 30;
+	UINT m_nMaxBodySize = 0;
+	CString m_strWarcReplay;
+	CString m_strWarcRecord;
+	CHttpFetcher* m_pFetcher = nullptr;
 
 protected:
 	// Generated message map functions
@@ -21,15 +21,28 @@ WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
 #include "stdafx.h"
 #include "WebSearchEngineExt.h"
 #include "HtmlToText.h"
+#include "UrlFrontier.h"
+#include "UrlCanonicalizer.h"
+#include "PolitenessScheduler.h"
+#include "ConcurrentFrontier.h"
+#include "CrawlerMetrics.h"
+#include "CrawlCheckpoint.h"
+#include "UrlDictionary.h"
+#include "SpiderTrapDetector.h"
+#include "DnsResolver.h"
+#include "RobotsCache.h"
 #include "ODBCWrappers.h"
 #include <string>
 #include <vector>
+#include <array>
 #include <map>
 #include <codecvt>
 #include <iostream>
 #include <fstream>
 #include <algorithm>
 #include <cctype>
+#include <mutex>
+#include <shared_mutex>
 #include <Windows.h>
 
 #include <Urlmon.h>
@@ -40,10 +53,13 @@ WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
 #endif
 
  // Global data structures for URL and keyword management
-FrontierArray gFrontierOlder;   ///< List of already visited URLs
-FrontierArray gFrontierArray;   ///< Queue of URLs to visit
-FrontierScore gFrontierScore;   ///< Score (priority) for each URL in the frontier
-WebpageIndex gWebpageID;        ///< Mapping from webpage URL to unique ID
+CUrlFrontier gFrontier;         ///< Visited set and priority queue of URLs to visit
+CPolitenessScheduler gScheduler(gFrontier); ///< Per-host back queues fed from the frontier
+CConcurrentFrontier gConcurrentFrontier(gFrontier, gScheduler); ///< Thread-safe access for the crawler threads
+CSpiderTrapDetector gTrapDetector; ///< Keeps near-infinite URL spaces out of the frontier
+CUrlDictionary gWebpageID;      ///< Mapping between stored webpage URLs and their IDs
+CDnsResolver gResolver;         ///< Resolves hosts ahead of their fetches
+CRobotsCache gRobots;           ///< robots.txt rules of the recently crawled sites
 KeywordIndex gKeywordID;        ///< Mapping from keyword to unique ID
 KeywordArray gWordArray;        ///< List of all discovered keywords
 
@@ -52,6 +68,29 @@ std::vector<std::wstring> gDataMiningTerms; ///< Terms to be used for data minin
 static __int64 gCurrentWebpageID = 0; ///< Counter for assigning unique webpage IDs
 static __int64 gCurrentKeywordID = 0; ///< Counter for assigning unique keyword IDs
 
+static bool gOfflineCrawl = false;           ///< Responses are replayed, hosts are not resolved
+
+static std::string gCheckpointPath;          ///< Crawl checkpoint file
+static ULONGLONG gCheckpointInterval = 0;    ///< Milliseconds between periodic checkpoints, 0 to save only on stop
+static ULONGLONG gLastCheckpoint = 0;        ///< Tick count of the last checkpoint
+
+static std::shared_mutex gCrawlGate;          ///< Held shared by each page in progress, exclusively by checkpoints
+static std::atomic<int> gActivePages{ 0 };    ///< Pages between EnterCrawlPage and LeaveCrawlPage
+static std::mutex gIndexLock;                 ///< Serializes the database and keyword index updates
+
+#define POLITENESS_SLICE 100 // longest wait inside ExtractURLFromFrontier, in milliseconds
+
+/// File extensions of links that never lead to HTML, sorted for binary search
+static const std::string_view gSkippedExtensions[] = {
+	"3g2", "3gp", "7z", "ai", "aif", "apk", "arj", "avi", "bat", "bin", "bmp", "cda", "com", "csv",
+	"dat", "db", "dbf", "deb", "dmg", "doc", "docx", "email", "eml", "emlx", "exe", "flv", "fnt", "fon",
+	"gadget", "gif", "gz", "h264", "ico", "iso", "jar", "jpeg", "jpg", "log", "m4v", "mdb", "mid", "midi",
+	"mov", "mp3", "mp4", "mpa", "mpeg", "mpg", "msg", "msi", "odp", "ods", "odt", "oft", "ogg", "ost", "otf",
+	"pdf", "pkg", "png", "pps", "ppt", "pptx", "ps", "psd", "pst", "rar", "rpm", "rtf", "sql", "svg", "swf",
+	"tar", "tex", "tif", "tiff", "toast", "ttf", "txt", "vcd", "vcf", "vob", "wav", "webm", "webp", "wma",
+	"wmv", "wpd", "wpl", "wsf", "xls", "xlsx", "xml", "z", "zip"
+};
+
 #define DELIMITERS _T("\t\n\r\"\' !?#$%&|(){}[]*/+-:;<>=.,")
 
 /**
@@ -84,116 +123,464 @@ std::string wstring_to_utf8(const std::wstring& str)
 }
 
 /**
- * @brief Adds a new URL to the frontier if it has not been visited or queued.
- *        Increases the score if already in the queue.
+ * @brief Checks whether the path of a canonical URL ends in the extension of a non-HTML file.
+ */
+static bool HasSkippedExtension(const std::string& lpszURL)
+{
+	size_t nStart = lpszURL.find("://");
+	nStart = (nStart == std::string::npos) ? 0 : nStart + 3;
+	const size_t nPath = lpszURL.find('/', nStart);
+	if (nPath == std::string::npos)
+		return false;
+	const size_t nEnd = std::min(lpszURL.find_first_of("?#", nPath), lpszURL.length());
+	const size_t nDot = lpszURL.find_last_of("./", nEnd - 1);
+	if ((nDot == std::string::npos) || (lpszURL[nDot] != '.') || (nEnd - nDot - 1 > 8))
+		return false;
+
+	std::string strExtension = lpszURL.substr(nDot + 1, nEnd - nDot - 1);
+	std::transform(strExtension.begin(), strExtension.end(), strExtension.begin(),
+		[](char ch) { return (char)tolower((unsigned char)ch); });
+	return std::binary_search(std::begin(gSkippedExtensions), std::end(gSkippedExtensions), std::string_view(strExtension));
+}
+
+/**
+ * @brief Canonicalizes a URL and adds it to the frontier if it has not been visited or queued.
+ *        Adds to its cash if already in the queue.
  * @param lpszURL The URL to add.
- * @return true if the operation succeeded.
+ * @param rCash The OPIC cash the link carries.
+ * @return true if the operation succeeded, false if the URL cannot be crawled.
  */
-bool AddURLToFrontier(const std::string& lpszURL)
+bool AddURLToFrontier(const std::string& lpszURL, double rCash)
 {
-	bool found = false;
-	for (auto it = gFrontierOlder.begin(); it != gFrontierOlder.end(); it++)
+	// called for every outlink: counted through handles, not by name under the metrics lock
+	static const CCrawlerCounter pRejectedByCanonicalizer = gCrawlerMetrics.GetCounter("urls_rejected_by_canonicalizer");
+	static const CCrawlerCounter pRewrittenByCanonicalizer = gCrawlerMetrics.GetCounter("urls_rewritten_by_canonicalizer");
+	static const CCrawlerCounter pRejectedByExtension = gCrawlerMetrics.GetCounter("urls_rejected_by_extension");
+	static const CCrawlerCounter pRejectedByRobots = gCrawlerMetrics.GetCounter("urls_rejected_by_robots");
+	static const auto arrRejectedAsTrap = [] {
+		std::array<CCrawlerCounter, static_cast<size_t>(CSpiderTrapDetector::Verdict::HOST_BUDGET) + 1> arrCounters;
+		for (size_t nVerdict = 0; nVerdict < arrCounters.size(); nVerdict++)
+			arrCounters[nVerdict] = gCrawlerMetrics.GetCounter(std::string("urls_rejected_as_") +
+				CSpiderTrapDetector::GetVerdictName(static_cast<CSpiderTrapDetector::Verdict>(nVerdict)));
+		return arrCounters;
+	}();
+
+	std::string strCanonical;
+	if (!CUrlCanonicalizer::Canonicalize(lpszURL, strCanonical))
 	{
-		if (lpszURL.compare(it->c_str()) == 0)
-		{
-			return true; // URL already visited
-		}
+		pRejectedByCanonicalizer.Add();
+		return false;
 	}
-	for (auto it = gFrontierArray.begin(); it != gFrontierArray.end(); it++)
+	if (strCanonical != lpszURL)
+		pRewrittenByCanonicalizer.Add();
+	if (HasSkippedExtension(strCanonical))
 	{
-		if (lpszURL.compare(it->c_str()) == 0)
-		{
-			found = true;
-			gFrontierScore[lpszURL]++;
-			break;
-		}
+		pRejectedByExtension.Add();
+		return false;
+	}
+	// sites whose robots.txt is not known yet are checked again when the URL is fetched
+	unsigned int nCrawlDelay = 0;
+	if (gRobots.Check(strCanonical, nCrawlDelay, false) == CRobotsCache::Verdict::DISALLOWED)
+	{
+		pRejectedByRobots.Add();
+		return false;
 	}
-	if (!found)
+	// last gate: an admitted URL is charged to its host and pattern budgets
+	const CSpiderTrapDetector::Verdict nVerdict = gTrapDetector.Check(strCanonical);
+	if (nVerdict != CSpiderTrapDetector::Verdict::ADMIT)
 	{
-		gFrontierArray.push_back(lpszURL);
-		gFrontierScore[lpszURL] = 1;
+		arrRejectedAsTrap[static_cast<size_t>(nVerdict)].Add();
+		return false;
 	}
+	gConcurrentFrontier.Add(std::move(strCanonical), rCash);
 	return true;
 }
 
 /**
- * @brief Extracts the next URL from the frontier, prioritizing by score.
- *        Removes the URL from the queue and score map, and adds it to the visited list.
+ * @brief Extracts the next URL from the calling thread's batch, prioritizing by OPIC cash
+ *        among the hosts that politeness allows to be fetched now.
+ *        Waits briefly when every queued host is still cooling down.
  * @param[out] lpszURL The extracted URL.
- * @return true if a URL was extracted, false if the frontier is empty.
+ * @return true if a URL was extracted, false if none is ready (see IsFrontierEmpty).
  */
 bool ExtractURLFromFrontier(std::string& lpszURL)
 {
-	lpszURL = "";
-	int score = 0;
-	if (gFrontierArray.size() > 0)
-	{
-		for (std::string it : gFrontierArray)
-		{
-			if (lpszURL.empty()) // select the first element
-			{
-				lpszURL = it;
-				score = gFrontierScore[it];
-			}
-			else
-			{
-				if (score < gFrontierScore[it]) // update the selection if necessary
-				{
-					lpszURL = it;
-					score = gFrontierScore[it];
-				}
-			}
-		}
+	ULONGLONG nWait = 0;
+	if (gConcurrentFrontier.Extract(lpszURL, nWait))
+		return true;
+	// nothing ready: either hosts are cooling down or other threads are still adding links
+	::Sleep(static_cast<DWORD>((nWait == 0) ? POLITENESS_SLICE : std::min<ULONGLONG>(nWait, POLITENESS_SLICE)));
+	return gConcurrentFrontier.Extract(lpszURL, nWait);
+}
 
-		// remove selected element from frontier
-		for (auto it = gFrontierArray.begin(); it != gFrontierArray.end(); it++)
-		{
-			if (lpszURL.compare(it->c_str()) == 0)
-			{
-				gFrontierArray.erase(it);
-				break;
-			}
-		}
-		for (auto it = gFrontierScore.begin(); it != gFrontierScore.end(); it++)
-		{
-			if (lpszURL.compare(it->first.c_str()) == 0)
-			{
-				gFrontierScore.erase(it);
-				break;
-			}
-		}
+/**
+ * @brief Tells the politeness scheduler that an extracted URL was dropped without being fetched.
+ * @param lpszURL The URL returned by ExtractURLFromFrontier.
+ * @return The OPIC cash of the page.
+ */
+double ReleaseURLToFrontier(const std::string& lpszURL)
+{
+	return gConcurrentFrontier.Release(lpszURL, 0);
+}
+
+/**
+ * @brief Tells the politeness scheduler that the fetch of an extracted URL has finished.
+ * @param pResult The completed fetch.
+ * @return The OPIC cash of the page.
+ */
+double ReleaseURLToFrontier(const CFetchResult& pResult)
+{
+	CPolitenessScheduler::Outcome nOutcome = CPolitenessScheduler::Outcome::SUCCESS;
+	if ((pResult.m_nStatusCode == HTTP_STATUS_SERVICE_UNAVAIL) || (pResult.m_nStatusCode == 429)) // 429 Too Many Requests
+		nOutcome = CPolitenessScheduler::Outcome::THROTTLED;
+	else if (pResult.m_nStatusCode == 0)
+		nOutcome = CPolitenessScheduler::Outcome::FAILED; // no answer; rejected answers still count as answers
+	return gConcurrentFrontier.Release(pResult.m_strURL, pResult.m_nFetchTime, nOutcome, pResult.m_nRetryAfter);
+}
+
+/**
+ * @brief Gives back an extracted URL whose fetch was cancelled, so the next run crawls it.
+ * @param lpszURL The URL returned by ExtractURLFromFrontier.
+ */
+void ReturnURLToFrontier(const std::string& lpszURL)
+{
+	gConcurrentFrontier.Return(lpszURL);
+}
+
+/**
+ * @brief Checks whether there is nothing left to crawl: no URL is queued and
+ *        no page that could still add links is being processed.
+ */
+bool IsFrontierEmpty()
+{
+	return (gActivePages == 0) && gConcurrentFrontier.IsEmpty();
+}
+
+/**
+ * @brief Marks the start of a page in the calling crawler thread; checkpoints wait for it to end.
+ */
+void EnterCrawlPage()
+{
+	gCrawlGate.lock_shared();
+	gActivePages++;
+}
+
+/**
+ * @brief Marks the end of the page started by EnterCrawlPage.
+ */
+void LeaveCrawlPage()
+{
+	gActivePages--;
+	gCrawlGate.unlock_shared();
+}
 
-		gFrontierOlder.push_back(lpszURL);
+/**
+ * @brief Sets the per-host politeness parameters.
+ * @param nBackQueues Number of hosts scheduled at the same time.
+ * @param nMinimumDelay Minimum delay between two fetches from the same host, in milliseconds.
+ */
+void ConfigurePoliteness(UINT nBackQueues, UINT nMinimumDelay)
+{
+	gScheduler.Configure(nBackQueues, nMinimumDelay);
+}
+
+/**
+ * @brief Switches the visited URL set to a Bloom filter with a fixed memory budget.
+ * @param nMemoryMB Memory budget in megabytes; 0 keeps the exact hash set.
+ * @param nFalsePositivePPM Target false positive rate, in parts per million.
+ * @return true if the visited set was configured.
+ */
+bool ConfigureVisitedFilter(UINT nMemoryMB, UINT nFalsePositivePPM)
+{
+	if (nMemoryMB == 0)
 		return true;
+	return gFrontier.SetVisitedFilter(static_cast<size_t>(nMemoryMB) * 1024 * 1024, nFalsePositivePPM / 1000000.0);
+}
+
+/**
+ * @brief Lets the frontier spill its low-priority tail to segment files on disk.
+ * @param lpszDirectory Directory for the segment files; empty keeps the frontier in memory.
+ * @param nHeadCapacity Maximum number of URLs kept in memory.
+ * @return true if the frontier was configured.
+ */
+bool ConfigureFrontierSpill(const std::string& lpszDirectory, UINT nHeadCapacity)
+{
+	if (lpszDirectory.empty())
+		return true;
+	return gFrontier.SetSpillDirectory(lpszDirectory, nHeadCapacity);
+}
+
+/**
+ * @brief Sets the limits that keep spider traps out of the frontier.
+ * @param nHostBudget Distinct URLs admitted per host; 0 for no limit.
+ * @param nPatternBudget Distinct URLs admitted per host and URL pattern; 0 for no limit.
+ * @param nMaxDepth Maximum number of path segments; 0 for no limit.
+ */
+void ConfigureSpiderTraps(UINT nHostBudget, UINT nPatternBudget, UINT nMaxDepth)
+{
+	gTrapDetector.Configure(nHostBudget, nPatternBudget, nMaxDepth);
+}
+
+/**
+ * @brief Sets up the crawler's host name resolver.
+ * @param nNegativeTTL Seconds a nonexistent host stays cached.
+ * @param lpszServer IPv4 address, with an optional ":port", of the DNS server; empty for the system resolver.
+ * @return false if the server address is invalid; the system resolver is used then.
+ */
+bool ConfigureResolver(UINT nNegativeTTL, const std::string& lpszServer)
+{
+	return gResolver.Configure(nNegativeTTL, lpszServer);
+}
+
+/**
+ * @brief Cancels the host lookups in flight and waits for them to end.
+ */
+void CancelResolver()
+{
+	gResolver.Cancel();
+}
+
+/**
+ * @brief Tells the crawler that every response comes from a WARC archive,
+ *        so host names are not resolved and hosts get no delay between fetches.
+ */
+void SetOfflineCrawl(bool bOffline)
+{
+	gOfflineCrawl = bOffline;
+	gScheduler.EnableDelays(!bOffline);
+}
+
+/**
+ * @brief Sets how many sites keep their robots.txt rules in memory.
+ */
+void ConfigureRobots(UINT nCapacity)
+{
+	gRobots.Configure(nCapacity);
+}
+
+/**
+ * @brief Checks without blocking whether an extracted URL can be fetched now: its host
+ *        must resolve and its robots.txt must allow it. Starts the lookups that are missing.
+ * @param lpszURL The URL returned by ExtractURLFromFrontier.
+ * @param bFirstAttempt false when polling a URL that was reported as WAIT.
+ */
+FetchReadiness PrepareURLForFetch(const std::string& lpszURL, bool bFirstAttempt)
+{
+	const std::string strHost = CPolitenessScheduler::GetHost(lpszURL);
+	const CDnsResolver::Status nStatus = gOfflineCrawl ? CDnsResolver::Status::RESOLVED : gResolver.Lookup(strHost, bFirstAttempt);
+	if (nStatus == CDnsResolver::Status::PENDING)
+		return FetchReadiness::WAIT;
+	if (nStatus == CDnsResolver::Status::NOT_FOUND)
+	{
+		gCrawlerMetrics.AddCounter("urls_dropped_unresolved");
+		return FetchReadiness::DROP;
 	}
-	return false;
+
+	unsigned int nCrawlDelay = 0;
+	const CRobotsCache::Verdict nVerdict = gRobots.Check(lpszURL, nCrawlDelay, true);
+	if (nVerdict == CRobotsCache::Verdict::UNKNOWN)
+		return FetchReadiness::WAIT;
+	if (nVerdict == CRobotsCache::Verdict::DISALLOWED)
+	{
+		gCrawlerMetrics.AddCounter("urls_dropped_by_robots");
+		return FetchReadiness::DROP;
+	}
+	// the host is busy with this URL, so the delay is in place when it is released
+	if (nCrawlDelay != 0)
+		gConcurrentFrontier.SetHostDelay(strHost, nCrawlDelay);
+	return FetchReadiness::FETCH;
+}
+
+/**
+ * @brief Takes the next robots.txt URL to download, tagged FETCH_TAG_ROBOTS.
+ * @return false if no robots.txt is waiting to be fetched.
+ */
+bool TakeRobotsFetch(std::string& lpszRobotsURL)
+{
+	return gRobots.TakeFetch(lpszRobotsURL);
+}
+
+/**
+ * @brief Stores the rules of a downloaded robots.txt.
+ */
+void CompleteRobotsFetch(const std::string& lpszRobotsURL, bool bReceived, DWORD nStatusCode, std::string_view pBody)
+{
+	gRobots.Complete(lpszRobotsURL, bReceived, nStatusCode, pBody);
+}
+
+/**
+ * @brief Forgets a robots.txt download that was cancelled, so it is fetched again later.
+ */
+void DiscardRobotsFetch(const std::string& lpszRobotsURL)
+{
+	gRobots.Discard(lpszRobotsURL);
 }
 
 /**
- * @brief Downloads a web page from a URL and saves it to a temporary file.
- * @param lpszURL The URL to download.
- * @param[out] lpszFilename The path to the downloaded file.
- * @return true if the download succeeded, false otherwise.
+ * @brief Starts resolving the hosts the politeness scheduler will fetch from next.
  */
-bool DownloadURLToFile(const std::string& lpszURL, std::string& lpszFilename)
+void PrefetchFrontierHosts()
 {
-	char lpszTempPath[MAX_PATH + 1] = { 0, };
-	char lpszTempFile[MAX_PATH + 1] = { 0, };
+	if (gOfflineCrawl)
+		return;
+	std::vector<std::string> arrHosts;
+	gConcurrentFrontier.GetQueuedHosts(arrHosts);
+	for (const auto& it : arrHosts)
+		gResolver.Prefetch(it);
+}
 
-	const DWORD dwTempPath = GetTempPathA(sizeof(lpszTempPath) - 1, lpszTempPath);
-	if (dwTempPath > 0)
+/**
+ * @brief Publishes frontier, URL dictionary and fetcher statistics and writes all crawler metrics to the debug output.
+ * @param pFetcher The crawl's fetcher; may be nullptr.
+ */
+void DumpCrawlerMetrics(const CHttpFetcher* pFetcher)
+{
+	if (pFetcher != nullptr)
+		pFetcher->ExportMetrics(gCrawlerMetrics);
+	gConcurrentFrontier.ExportMetrics(gCrawlerMetrics);
+	gTrapDetector.ExportMetrics(gCrawlerMetrics);
+	gResolver.ExportMetrics(gCrawlerMetrics);
+	gRobots.ExportMetrics(gCrawlerMetrics);
 	{
-		lpszTempPath[dwTempPath] = '\0';
-		if (GetTempFileNameA(lpszTempPath, "map", 0, lpszTempFile) != 0)
-		{
-			if (URLDownloadToFileA(NULL, lpszURL.c_str(), lpszTempFile, 0, NULL) == S_OK)
-			{
-				lpszFilename = lpszTempFile;
-				return true;
-			}
-		}
+		std::lock_guard<std::mutex> lock(gIndexLock);
+		gWebpageID.ExportMetrics(gCrawlerMetrics);
 	}
-	return false;
+	OutputDebugStringA(gCrawlerMetrics.Format().c_str());
+}
+
+/**
+ * @brief Sets where and how often the crawl state is checkpointed.
+ * @param lpszPath Path of the checkpoint file.
+ * @param nInterval Seconds between periodic checkpoints; 0 saves only when the crawl stops.
+ */
+void ConfigureCrawlCheckpoint(const std::string& lpszPath, UINT nInterval)
+{
+	gCheckpointPath = lpszPath;
+	gCheckpointInterval = static_cast<ULONGLONG>(nInterval) * 1000;
+	gLastCheckpoint = ::GetTickCount64();
+	// merged and consumed segments must outlive the checkpoint that still reads them
+	gFrontier.SetRetainSegments(!gCheckpointPath.empty());
+}
+
+/**
+ * @brief Restores the crawl state saved by SaveCrawlCheckpoint.
+ *        Must be called before the frontier is configured or used.
+ * @return RESUMED if the crawl resumes from the checkpoint, NONE if there is no checkpoint
+ *         and the crawl starts from scratch, UNREADABLE if a checkpoint exists but cannot be loaded.
+ */
+CheckpointState LoadCrawlCheckpoint()
+{
+	if (gCheckpointPath.empty() || (::GetFileAttributesA(gCheckpointPath.c_str()) == INVALID_FILE_ATTRIBUTES))
+		return CheckpointState::NONE;
+	// from here on the database belongs to the checkpoint: failing must not start a fresh crawl
+	CCrawlCheckpoint pCheckpoint;
+	if (!pCheckpoint.Open(gCheckpointPath))
+		return CheckpointState::UNREADABLE;
+
+	std::istream& pStream = pCheckpoint.GetInput();
+	bool bLoaded = ReadCheckpointValue(pStream, gCurrentWebpageID) && ReadCheckpointValue(pStream, gCurrentKeywordID);
+
+	unsigned __int64 nCount = 0;
+	__int64 nID = 0;
+	std::string strText;
+	bLoaded = bLoaded && ReadCheckpointValue(pStream, nCount);
+	for (unsigned __int64 nIndex = 0; bLoaded && (nIndex < nCount); nIndex++)
+	{
+		bLoaded = ReadCheckpointValue(pStream, nID) && ReadCheckpointString(pStream, strText);
+		if (bLoaded)
+			gKeywordID[utf8_to_wstring(strText)] = nID;
+	}
+	bLoaded = bLoaded && gWebpageID.Load(pStream);
+	bLoaded = bLoaded && ReadCheckpointValue(pStream, nCount);
+	for (unsigned __int64 nIndex = 0; bLoaded && (nIndex < nCount); nIndex++)
+	{
+		bLoaded = ReadCheckpointString(pStream, strText);
+		if (bLoaded)
+			gDataMiningTerms.push_back(utf8_to_wstring(strText));
+	}
+	bLoaded = bLoaded && gTrapDetector.Load(pStream);
+	bLoaded = bLoaded && gConcurrentFrontier.Load(pStream);
+	bLoaded = bLoaded && pCheckpoint.IsInputComplete();
+	if (!bLoaded)
+	{
+		gFrontier.Clear();
+		gTrapDetector.Clear();
+		gCurrentWebpageID = 0;
+		gCurrentKeywordID = 0;
+		gKeywordID.clear();
+		gWebpageID.Clear();
+		gDataMiningTerms.clear();
+		return CheckpointState::UNREADABLE;
+	}
+
+	// the keyword list keeps discovery order
+	std::vector<std::pair<__int64, std::wstring>> arrKeywords;
+	arrKeywords.reserve(gKeywordID.size());
+	for (const auto& it : gKeywordID)
+		arrKeywords.emplace_back(it.second, it.first);
+	std::sort(arrKeywords.begin(), arrKeywords.end());
+	gWordArray.clear();
+	for (auto& it : arrKeywords)
+		gWordArray.push_back(std::move(it.second));
+	return CheckpointState::RESUMED;
+}
+
+/**
+ * @brief Checks whether the periodic checkpoint interval has elapsed.
+ */
+bool IsCheckpointDue()
+{
+	return !gCheckpointPath.empty() && (gCheckpointInterval != 0) && (::GetTickCount64() - gLastCheckpoint >= gCheckpointInterval);
+}
+
+/**
+ * @brief Writes the crawl state to the checkpoint file, after the pages in progress
+ *        have ended. Must not be called between EnterCrawlPage and LeaveCrawlPage.
+ * @param bForce true to save now, false to save only if the checkpoint interval has elapsed.
+ * @return true if a checkpoint was written.
+ */
+bool SaveCrawlCheckpoint(bool bForce)
+{
+	const ULONGLONG nNow = ::GetTickCount64();
+	if (gCheckpointPath.empty() || (!bForce && ((gCheckpointInterval == 0) || (nNow - gLastCheckpoint < gCheckpointInterval))))
+		return false;
+	gLastCheckpoint = nNow;
+
+	std::unique_lock<std::shared_mutex> lock(gCrawlGate);
+	CCrawlCheckpoint pCheckpoint;
+	if (!pCheckpoint.Create(gCheckpointPath))
+		return false;
+
+	std::ostream& pStream = pCheckpoint.GetOutput();
+	WriteCheckpointValue(pStream, gCurrentWebpageID);
+	WriteCheckpointValue(pStream, gCurrentKeywordID);
+	WriteCheckpointValue(pStream, static_cast<unsigned __int64>(gKeywordID.size()));
+	for (const auto& it : gKeywordID)
+	{
+		WriteCheckpointValue(pStream, it.second);
+		WriteCheckpointString(pStream, wstring_to_utf8(it.first));
+	}
+	gWebpageID.Save(pStream);
+	WriteCheckpointValue(pStream, static_cast<unsigned __int64>(gDataMiningTerms.size()));
+	for (const auto& it : gDataMiningTerms)
+		WriteCheckpointString(pStream, wstring_to_utf8(it));
+	gTrapDetector.Save(pStream);
+	if (!gConcurrentFrontier.Save(pStream) || !pCheckpoint.Commit())
+		return false;
+
+	gFrontier.PurgeRetiredSegments();
+	gCrawlerMetrics.AddCounter("crawl_checkpoints");
+	gCrawlerMetrics.SetGauge("crawl_checkpoint_ms", static_cast<double>(::GetTickCount64() - nNow));
+	return true;
+}
+
+/**
+ * @brief Returns the number of webpages and keywords stored so far.
+ */
+void GetCrawlCounters(__int64& nWebpages, __int64& nKeywords)
+{
+	nWebpages = gCurrentWebpageID;
+	nKeywords = gCurrentKeywordID;
 }
 
 /**
@@ -280,165 +667,229 @@ static inline std::wstring to_upper(std::wstring s)
 }
 
 /**
- * @brief Processes an HTML file: extracts the title, hyperlinks, and plain text,
+ * @class CPageVisitor
+ * @brief Collects the title, hyperlinks and robots directives of a page while it is converted to text.
+ */
+class CPageVisitor : public CHtmlVisitor
+{
+public:
+	void OnTitle(std::string_view title) override
+	{
+		m_strTitle = title;
+	}
+
+	void OnLink(std::string_view href, std::string_view anchorText) override
+	{
+		(void)anchorText;
+		if (!href.starts_with('#'))
+			m_arrLinks.emplace_back(href);
+	}
+
+	void OnMeta(std::string_view name, std::string_view content) override
+	{
+		if ((name.length() != 6) || (_strnicmp(name.data(), "robots", 6) != 0))
+			return;
+		// a comma and/or whitespace separated list of directives, compared as whole words
+		auto IsDirective = [](std::string_view token, const char* lpszDirective) {
+			return (token.length() == strlen(lpszDirective)) && (_strnicmp(token.data(), lpszDirective, token.length()) == 0);
+			};
+		size_t nStart = content.find_first_not_of(", \t\r\n");
+		while (nStart != std::string_view::npos)
+		{
+			const size_t nEnd = content.find_first_of(", \t\r\n", nStart);
+			const std::string_view token = content.substr(nStart, nEnd - nStart);
+			if (IsDirective(token, "noindex") || IsDirective(token, "none"))
+				m_bNoIndex = true;
+			if (IsDirective(token, "nofollow") || IsDirective(token, "none"))
+				m_bNoFollow = true;
+			nStart = content.find_first_not_of(", \t\r\n", nEnd);
+		}
+	}
+
+public:
+	std::string m_strTitle;
+	std::vector<std::string> m_arrLinks;   ///< Raw href values, in page order
+	bool m_bNoIndex = false;                ///< <meta name="robots" content="noindex">
+	bool m_bNoFollow = false;               ///< <meta name="robots" content="nofollow">
+};
+
+/**
+ * @brief Processes an HTML page: extracts the title, hyperlinks, and plain text,
  *        updates the database with webpage and keyword information, and manages data mining terms.
  * @param pWebSearchEngineDlg Pointer to the main dialog for UI and database access.
- * @param lpszFilename Path to the HTML file to process.
+ * @param pHtmlContent The downloaded page; only read during the call.
  * @param lpszURL The URL of the processed page.
+ * @param rCash The OPIC cash of the page, split evenly among its hyperlinks.
  * @return true if processing succeeded, false otherwise.
  */
-bool ProcessHTML(CWebSearchEngineDlg* pWebSearchEngineDlg, const std::string& lpszFilename, const std::string& lpszURL)
+bool ProcessHTML(CWebSearchEngineDlg* pWebSearchEngineDlg, std::string_view pHtmlContent, const std::string& lpszURL, double rCash)
 {
 	CString strMessage;
-	CHtmlToText pHtmlToText;
-	std::ifstream pHtmlFile(lpszFilename);
-	std::string pHtmlContent;
-	if (pHtmlFile.is_open())
-	{
-		pHtmlFile.seekg(0, std::ios::end);
-		pHtmlContent.reserve(static_cast<unsigned int>(pHtmlFile.tellg()));
-		pHtmlFile.seekg(0, std::ios::beg);
-
-		pHtmlContent.assign((std::istreambuf_iterator<char>(pHtmlFile)),
-			std::istreambuf_iterator<char>());
-		pHtmlFile.close();
+	// one pass over the fetch buffer yields the text, the title and the links; each worker
+	// thread keeps its converter and text buffer, so steady-state pages do not allocate
+	thread_local CHtmlToText pHtmlToText;
+	thread_local std::string pConvertedText;
+	CPageVisitor pPageVisitor;
+	pHtmlToText.Convert(pHtmlContent, pConvertedText, &pPageVisitor);
+	if (pHtmlToText.IsTruncated())
+		gCrawlerMetrics.AddCounter("pages_parse_budget_exceeded");
+	const std::wstring pTitle = trim(utf8_to_wstring(UnquoteHTML(pPageVisitor.m_strTitle))).substr(0, 0x100 - 1);
+	if (pTitle.length() == 0)
+		return true;
 
-		std::wstring pTitle;
-		std::size_t found = pHtmlContent.find("<title>", 0);
-		if (std::string::npos != found)
+	// collect the hyperlinks first: the page's cash is split evenly among them
+	std::vector<std::string> arrHyperlinks;
+	if (pPageVisitor.m_bNoFollow)
+	{
+		gCrawlerMetrics.AddCounter("pages_nofollow");
+		pPageVisitor.m_arrLinks.clear();
+	}
+	for (const auto& href : pPageVisitor.m_arrLinks)
+	{
+		// attribute values may hold entities, as in "?a=1&amp;b=2"
+		std::string hyperlink = (href.find('&') != std::string::npos) ? UnquoteHTML(href) : href;
+		if (hyperlink.length() >= MAX_URL_LENGTH)
+			continue;
+		// OutputDebugString(CString(hyperlink.c_str()) + _T("\n"));
+		TCHAR lpszRelativeURL[MAX_URL_LENGTH] = { 0 };
+		TCHAR lpszAbsoluteURL[MAX_URL_LENGTH] = { 0 };
+		TCHAR lpszDomainURL[MAX_URL_LENGTH] = { 0 };
+		DWORD dwLength = MAX_URL_LENGTH;
+		wcscpy_s(lpszRelativeURL, _countof(lpszRelativeURL), CString(hyperlink.c_str()));
+		wcscpy_s(lpszDomainURL, _countof(lpszDomainURL), CString(lpszURL.c_str()));
+		if (CoInternetCombineUrl(lpszDomainURL, lpszRelativeURL, 0, lpszAbsoluteURL, MAX_URL_LENGTH, &dwLength, 0) == S_OK)
 		{
-			found += 7;
-			const std::size_t last_char = pHtmlContent.find("</title>", found);
-			if (std::string::npos != last_char)
-			{
-				pTitle = trim(utf8_to_wstring(UnquoteHTML(pHtmlContent.substr(found, last_char - found)))).substr(0, 0x100 - 1);
-			}
+			lpszAbsoluteURL[dwLength] = '\0';
+			// OutputDebugString(CString(lpszAbsoluteURL) + _T("\n"));
+			hyperlink = CStringA(lpszAbsoluteURL);
+			if (hyperlink.length() < 0x100)
+				arrHyperlinks.push_back(std::move(hyperlink));
 		}
-		if (pTitle.length() == 0)
-			return true;
+	}
+	for (const auto& hyperlink : arrHyperlinks)
+		AddURLToFrontier(hyperlink, rCash / static_cast<double>(arrHyperlinks.size()));
+	if (pPageVisitor.m_bNoIndex)
+	{
+		gCrawlerMetrics.AddCounter("pages_noindex");
+		return true;
+	}
 
-		found = pHtmlContent.find("<a href=\"", 0);
-		while (std::string::npos != found)
+	// links are parsed in parallel, the index is updated by one thread at a time
+	std::lock_guard<std::mutex> lock(gIndexLock);
+	const std::wstring& pURL = utf8_to_wstring(lpszURL);
+	OutputDebugString(CString(pURL.c_str()) + _T("\n"));
+	// OutputDebugString(CString(pTitle.c_str()) + _T("\n"));
+	std::wstring pPlainText = trim(utf8_to_wstring(UnquoteHTML(pConvertedText)));
+	findAndReplaceAll(pPlainText, _T("\t"), _T(" "));
+	findAndReplaceAll(pPlainText, _T("\n"), _T(" "));
+	findAndReplaceAll(pPlainText, _T("\r"), _T(" "));
+	while (findAndReplaceAll(pPlainText, _T("  "), _T(" ")) > 0);
+	pPlainText = pPlainText.substr(0, 0x10000 - 1);
+	OutputDebugString(CString(pPlainText.c_str()) + _T("\n"));
+
+	SQLRETURN nRet = 0;
+	CWebpageInsert pWebpageInsert;
+	if (!pWebpageInsert.Execute(pWebSearchEngineDlg->m_pConnection, pURL, pTitle, pPlainText)) // add webpage to database
+	{
+		pWebSearchEngineDlg->m_pProgress.SetMarquee(FALSE, 30);
+		do {
+			::MessageBeep(0xFFFFFFFF);
+			nRet = pWebSearchEngineDlg->m_pConnection.Disconnect();
+			::Sleep(30 * 1000);
+			nRet = pWebSearchEngineDlg->m_pConnection.DriverConnect(const_cast<SQLTCHAR*>(reinterpret_cast<const SQLTCHAR*>(pWebSearchEngineDlg->m_sConnectionInString)), pWebSearchEngineDlg->m_sConnectionOutString);
+		} while (!SQL_SUCCEEDED(nRet));
+		if (!pWebpageInsert.Execute(pWebSearchEngineDlg->m_pConnection, pURL, pTitle, pPlainText))
 		{
-			found += 9;
-			const std::size_t last_char = pHtmlContent.find('\"', found);
-			if (std::string::npos != last_char)
-			{
-				std::string hyperlink = pHtmlContent.substr(found, last_char - found);
-				std::size_t diez = hyperlink.find('#');
-				if (std::string::npos != diez)
-				{
-					hyperlink = hyperlink.substr(0, diez);
-				}
-				// OutputDebugString(CString(hyperlink.c_str()) + _T("\n"));
-				TCHAR lpszRelativeURL[MAX_URL_LENGTH] = { 0 };
-				TCHAR lpszAbsoluteURL[MAX_URL_LENGTH] = { 0 };
-				TCHAR lpszDomainURL[MAX_URL_LENGTH] = { 0 };
-				DWORD dwLength = MAX_URL_LENGTH;
-				wcscpy_s(lpszRelativeURL, _countof(lpszRelativeURL), CString(hyperlink.c_str()));
-				wcscpy_s(lpszDomainURL, _countof(lpszDomainURL), CString(lpszURL.c_str()));
-				if (CoInternetCombineUrl(lpszDomainURL, lpszRelativeURL, 0, lpszAbsoluteURL, MAX_URL_LENGTH, &dwLength, 0) == S_OK)
-				{
-					lpszAbsoluteURL[dwLength] = '\0';
-					// OutputDebugString(CString(lpszAbsoluteURL) + _T("\n"));
-					hyperlink = CStringA(lpszAbsoluteURL);
-					if (hyperlink.length() < 0x100)
-						AddURLToFrontier(hyperlink);
-				}
-			}
-			found = pHtmlContent.find("<a href=\"", found);
+			pWebSearchEngineDlg->MessageBox(_T("Cannot insert webpage into the database"), _T("Error"), MB_OK);
+			return false;
 		}
+		pWebSearchEngineDlg->m_pProgress.SetMarquee(TRUE, 30);
+	}
+	gWebpageID.Insert(lpszURL, ++gCurrentWebpageID);
+	pWebSearchEngineDlg->m_pWebpageCounter.SetWindowText(std::to_wstring(gCurrentWebpageID).c_str());
 
-		const std::wstring& pURL = utf8_to_wstring(lpszURL);
-		OutputDebugString(CString(pURL.c_str()) + _T("\n"));
-		// OutputDebugString(CString(pTitle.c_str()) + _T("\n"));
-		std::wstring pPlainText = trim(utf8_to_wstring(UnquoteHTML(pHtmlToText.Convert(pHtmlContent))));
-		findAndReplaceAll(pPlainText, _T("\t"), _T(" "));
-		findAndReplaceAll(pPlainText, _T("\n"), _T(" "));
-		findAndReplaceAll(pPlainText, _T("\r"), _T(" "));
-		while (findAndReplaceAll(pPlainText, _T("  "), _T(" ")) > 0);
-		pPlainText = pPlainText.substr(0, 0x10000 - 1);
-		OutputDebugString(CString(pPlainText.c_str()) + _T("\n"));
-
-		SQLRETURN nRet = 0;
-		CWebpageInsert pWebpageInsert;
-		if (!pWebpageInsert.Execute(pWebSearchEngineDlg->m_pConnection, pURL, pTitle, pPlainText)) // add webpage to database
+	const std::wstring pLowerCaseText = to_lower(pPlainText);
+	// Skip delimiters at beginning.
+	std::size_t lastPos = pLowerCaseText.find_first_not_of(DELIMITERS, 0);
+	// Find first "non-delimiter".
+	std::size_t pos = pLowerCaseText.find_first_of(DELIMITERS, lastPos);
+
+	while ((std::string::npos != pos) || (std::string::npos != lastPos))
+	{
+		// Found a token, add it to the vector.
+		const std::wstring pKeyword = pLowerCaseText.substr(lastPos, pos - lastPos);
+		// Skip delimiters.  Note the "not_of"
+		lastPos = pLowerCaseText.find_first_not_of(DELIMITERS, pos);
+		// Find next "non-delimiter"
+		pos = pLowerCaseText.find_first_of(DELIMITERS, lastPos);
+
+		if (pKeyword.length() == 0)
+			continue;
+
+		if (pKeyword.find_first_not_of(_T("abcdefghijklmnopqrstuvwxyz")) != std::string::npos)
+			continue;
+
+		OutputDebugString(CString(pKeyword.c_str()) + _T("\n"));
+		bool already_added = false;
+		for (auto it = gWordArray.begin(); it != gWordArray.end(); it++)
 		{
-			pWebSearchEngineDlg->m_pProgress.SetMarquee(FALSE, 30);
-			do {
-				::MessageBeep(0xFFFFFFFF);
-				nRet = pWebSearchEngineDlg->m_pConnection.Disconnect();
-				::Sleep(30 * 1000);
-				nRet = pWebSearchEngineDlg->m_pConnection.DriverConnect(const_cast<SQLTCHAR*>(reinterpret_cast<const SQLTCHAR*>(pWebSearchEngineDlg->m_sConnectionInString)), pWebSearchEngineDlg->m_sConnectionOutString);
-			} while (!SQL_SUCCEEDED(nRet));
-			if (!pWebpageInsert.Execute(pWebSearchEngineDlg->m_pConnection, pURL, pTitle, pPlainText))
+			if (pKeyword.compare(it->c_str()) == 0)
 			{
-				pWebSearchEngineDlg->MessageBox(_T("Cannot insert webpage into the database"), _T("Error"), MB_OK);
-				return false;
+				already_added = true;
+				break;
 			}
-			pWebSearchEngineDlg->m_pProgress.SetMarquee(TRUE, 30);
 		}
-		gWebpageID[pURL] = ++gCurrentWebpageID;
-		pWebSearchEngineDlg->m_pWebpageCounter.SetWindowText(std::to_wstring(gCurrentWebpageID).c_str());
-
-		const std::wstring pLowerCaseText = to_lower(pPlainText);
-		// Skip delimiters at beginning.
-		std::size_t lastPos = pLowerCaseText.find_first_not_of(DELIMITERS, 0);
-		// Find first "non-delimiter".
-		std::size_t pos = pLowerCaseText.find_first_of(DELIMITERS, lastPos);
 
-		while ((std::string::npos != pos) || (std::string::npos != lastPos))
+		if (!already_added)
 		{
-			// Found a token, add it to the vector.
-			const std::wstring pKeyword = pLowerCaseText.substr(lastPos, pos - lastPos);
-			// Skip delimiters.  Note the "not_of"
-			lastPos = pLowerCaseText.find_first_not_of(DELIMITERS, pos);
-			// Find next "non-delimiter"
-			pos = pLowerCaseText.find_first_of(DELIMITERS, lastPos);
-
-			if (pKeyword.length() == 0)
-				continue;
-
-			if (pKeyword.find_first_not_of(_T("abcdefghijklmnopqrstuvwxyz")) != std::string::npos)
-				continue;
-
-			OutputDebugString(CString(pKeyword.c_str()) + _T("\n"));
-			bool already_added = false;
-			for (auto it = gWordArray.begin(); it != gWordArray.end(); it++)
+			gWordArray.push_back(pKeyword);
+
+			CKeywordInsert pKeywordInsert;
+			if (!pKeywordInsert.Execute(pWebSearchEngineDlg->m_pConnection, pKeyword)) // add keyword to database
 			{
-				if (pKeyword.compare(it->c_str()) == 0)
+				pWebSearchEngineDlg->m_pProgress.SetMarquee(FALSE, 30);
+				do {
+					::MessageBeep(0xFFFFFFFF);
+					nRet = pWebSearchEngineDlg->m_pConnection.Disconnect();
+					::Sleep(30 * 1000);
+					nRet = pWebSearchEngineDlg->m_pConnection.DriverConnect(const_cast<SQLTCHAR*>(reinterpret_cast<const SQLTCHAR*>(pWebSearchEngineDlg->m_sConnectionInString)), pWebSearchEngineDlg->m_sConnectionOutString);
+				} while (!SQL_SUCCEEDED(nRet));
+				if (!pKeywordInsert.Execute(pWebSearchEngineDlg->m_pConnection, pKeyword))
 				{
-					already_added = true;
-					break;
+					pWebSearchEngineDlg->MessageBox(_T("Cannot insert keyword into the database"), _T("Error"), MB_OK);
+					return false;
 				}
+				pWebSearchEngineDlg->m_pProgress.SetMarquee(TRUE, 30);
 			}
+			gKeywordID[pKeyword] = ++gCurrentKeywordID;
+			pWebSearchEngineDlg->m_pKeywordCounter.SetWindowText(std::to_wstring(gCurrentKeywordID).c_str());
 
-			if (!already_added)
+			COccurrenceInsert pOccurrenceInsert;
+			if (!pOccurrenceInsert.Execute(pWebSearchEngineDlg->m_pConnection, gCurrentWebpageID, gCurrentKeywordID, 1))
 			{
-				gWordArray.push_back(pKeyword);
-
-				CKeywordInsert pKeywordInsert;
-				if (!pKeywordInsert.Execute(pWebSearchEngineDlg->m_pConnection, pKeyword)) // add keyword to database
+				pWebSearchEngineDlg->m_pProgress.SetMarquee(FALSE, 30);
+				do {
+					::MessageBeep(0xFFFFFFFF);
+					nRet = pWebSearchEngineDlg->m_pConnection.Disconnect();
+					::Sleep(30 * 1000);
+					nRet = pWebSearchEngineDlg->m_pConnection.DriverConnect(const_cast<SQLTCHAR*>(reinterpret_cast<const SQLTCHAR*>(pWebSearchEngineDlg->m_sConnectionInString)), pWebSearchEngineDlg->m_sConnectionOutString);
+				} while (!SQL_SUCCEEDED(nRet));
+				if (!pOccurrenceInsert.Execute(pWebSearchEngineDlg->m_pConnection, gCurrentWebpageID, gCurrentKeywordID, 1))
 				{
-					pWebSearchEngineDlg->m_pProgress.SetMarquee(FALSE, 30);
-					do {
-						::MessageBeep(0xFFFFFFFF);
-						nRet = pWebSearchEngineDlg->m_pConnection.Disconnect();
-						::Sleep(30 * 1000);
-						nRet = pWebSearchEngineDlg->m_pConnection.DriverConnect(const_cast<SQLTCHAR*>(reinterpret_cast<const SQLTCHAR*>(pWebSearchEngineDlg->m_sConnectionInString)), pWebSearchEngineDlg->m_sConnectionOutString);
-					} while (!SQL_SUCCEEDED(nRet));
-					if (!pKeywordInsert.Execute(pWebSearchEngineDlg->m_pConnection, pKeyword))
-					{
-						pWebSearchEngineDlg->MessageBox(_T("Cannot insert keyword into the database"), _T("Error"), MB_OK);
-						return false;
-					}
-					pWebSearchEngineDlg->m_pProgress.SetMarquee(TRUE, 30);
+					pWebSearchEngineDlg->MessageBox(_T("Cannot insert occurrence into the database"), _T("Error"), MB_OK);
+					return false;
 				}
-				gKeywordID[pKeyword] = ++gCurrentKeywordID;
-				pWebSearchEngineDlg->m_pKeywordCounter.SetWindowText(std::to_wstring(gCurrentKeywordID).c_str());
-
-				COccurrenceInsert pOccurrenceInsert;
-				if (!pOccurrenceInsert.Execute(pWebSearchEngineDlg->m_pConnection, gCurrentWebpageID, gCurrentKeywordID, 1))
+				pWebSearchEngineDlg->m_pProgress.SetMarquee(TRUE, 30);
+			}
+		}
+		else
+		{
+			const __int64 nKeywordID = gKeywordID[pKeyword];
+			COccurrenceInsert pOccurrenceInsert;
+			if (!pOccurrenceInsert.Execute(pWebSearchEngineDlg->m_pConnection, gCurrentWebpageID, nKeywordID, 1))
+			{
+				COccurrenceUpdate pOccurrenceUpdate;
+				if (!pOccurrenceUpdate.Execute(pWebSearchEngineDlg->m_pConnection, gCurrentWebpageID, nKeywordID))
 				{
 					pWebSearchEngineDlg->m_pProgress.SetMarquee(FALSE, 30);
 					do {
@@ -447,81 +898,55 @@ bool ProcessHTML(CWebSearchEngineDlg* pWebSearchEngineDlg, const std::string& lp
 						::Sleep(30 * 1000);
 						nRet = pWebSearchEngineDlg->m_pConnection.DriverConnect(const_cast<SQLTCHAR*>(reinterpret_cast<const SQLTCHAR*>(pWebSearchEngineDlg->m_sConnectionInString)), pWebSearchEngineDlg->m_sConnectionOutString);
 					} while (!SQL_SUCCEEDED(nRet));
-					if (!pOccurrenceInsert.Execute(pWebSearchEngineDlg->m_pConnection, gCurrentWebpageID, gCurrentKeywordID, 1))
+					if (!pOccurrenceUpdate.Execute(pWebSearchEngineDlg->m_pConnection, gCurrentWebpageID, nKeywordID))
 					{
-						pWebSearchEngineDlg->MessageBox(_T("Cannot insert occurrence into the database"), _T("Error"), MB_OK);
+						pWebSearchEngineDlg->MessageBox(_T("Cannot update occurrence into the database"), _T("Error"), MB_OK);
 						return false;
 					}
 					pWebSearchEngineDlg->m_pProgress.SetMarquee(TRUE, 30);
 				}
 			}
-			else
-			{
-				const __int64 nKeywordID = gKeywordID[pKeyword];
-				COccurrenceInsert pOccurrenceInsert;
-				if (!pOccurrenceInsert.Execute(pWebSearchEngineDlg->m_pConnection, gCurrentWebpageID, nKeywordID, 1))
-				{
-					COccurrenceUpdate pOccurrenceUpdate;
-					if (!pOccurrenceUpdate.Execute(pWebSearchEngineDlg->m_pConnection, gCurrentWebpageID, nKeywordID))
-					{
-						pWebSearchEngineDlg->m_pProgress.SetMarquee(FALSE, 30);
-						do {
-							::MessageBeep(0xFFFFFFFF);
-							nRet = pWebSearchEngineDlg->m_pConnection.Disconnect();
-							::Sleep(30 * 1000);
-							nRet = pWebSearchEngineDlg->m_pConnection.DriverConnect(const_cast<SQLTCHAR*>(reinterpret_cast<const SQLTCHAR*>(pWebSearchEngineDlg->m_sConnectionInString)), pWebSearchEngineDlg->m_sConnectionOutString);
-						} while (!SQL_SUCCEEDED(nRet));
-						if (!pOccurrenceUpdate.Execute(pWebSearchEngineDlg->m_pConnection, gCurrentWebpageID, nKeywordID))
-						{
-							pWebSearchEngineDlg->MessageBox(_T("Cannot update occurrence into the database"), _T("Error"), MB_OK);
-							return false;
-						}
-						pWebSearchEngineDlg->m_pProgress.SetMarquee(TRUE, 30);
-					}
-				}
-			}
+		}
 
-			already_added = false;
-			for (auto it = gDataMiningTerms.begin(); it != gDataMiningTerms.end(); it++)
+		already_added = false;
+		for (auto it = gDataMiningTerms.begin(); it != gDataMiningTerms.end(); it++)
+		{
+			if (pKeyword.compare(it->c_str()) == 0)
 			{
-				if (pKeyword.compare(it->c_str()) == 0)
-				{
-					already_added = true;
-					break;
-				}
+				already_added = true;
+				break;
 			}
-			if (!already_added)
-				gDataMiningTerms.push_back(pKeyword);
 		}
+		if (!already_added)
+			gDataMiningTerms.push_back(pKeyword);
+	}
 
-		if ((gCurrentWebpageID % 1000) == 0)
+	if ((gCurrentWebpageID % 1000) == 0)
+	{
+		for (auto it = gDataMiningTerms.begin(); it != gDataMiningTerms.end(); it++)
 		{
-			for (auto it = gDataMiningTerms.begin(); it != gDataMiningTerms.end(); it++)
-			{
-				strMessage.Format(_T("applying data mining for '%s'..."), it->c_str());
-				pWebSearchEngineDlg->m_pCrawling.SetWindowText(strMessage);
+			strMessage.Format(_T("applying data mining for '%s'..."), it->c_str());
+			pWebSearchEngineDlg->m_pCrawling.SetWindowText(strMessage);
 
-				CDataMiningUpdate pDataMiningUpdate;
+			CDataMiningUpdate pDataMiningUpdate;
+			if (!pDataMiningUpdate.Execute(pWebSearchEngineDlg->m_pConnection, *it))
+			{
+				pWebSearchEngineDlg->m_pProgress.SetMarquee(FALSE, 30);
+				do {
+					::MessageBeep(0xFFFFFFFF);
+					nRet = pWebSearchEngineDlg->m_pConnection.Disconnect();
+					::Sleep(30 * 1000);
+					nRet = pWebSearchEngineDlg->m_pConnection.DriverConnect(const_cast<SQLTCHAR*>(reinterpret_cast<const SQLTCHAR*>(pWebSearchEngineDlg->m_sConnectionInString)), pWebSearchEngineDlg->m_sConnectionOutString);
+				} while (!SQL_SUCCEEDED(nRet));
 				if (!pDataMiningUpdate.Execute(pWebSearchEngineDlg->m_pConnection, *it))
 				{
-					pWebSearchEngineDlg->m_pProgress.SetMarquee(FALSE, 30);
-					do {
-						::MessageBeep(0xFFFFFFFF);
-						nRet = pWebSearchEngineDlg->m_pConnection.Disconnect();
-						::Sleep(30 * 1000);
-						nRet = pWebSearchEngineDlg->m_pConnection.DriverConnect(const_cast<SQLTCHAR*>(reinterpret_cast<const SQLTCHAR*>(pWebSearchEngineDlg->m_sConnectionInString)), pWebSearchEngineDlg->m_sConnectionOutString);
-					} while (!SQL_SUCCEEDED(nRet));
-					if (!pDataMiningUpdate.Execute(pWebSearchEngineDlg->m_pConnection, *it))
-					{
-						pWebSearchEngineDlg->MessageBox(_T("Cannot apply data mining to the database"), _T("Error"), MB_OK);
-						return false;
-					}
-					pWebSearchEngineDlg->m_pProgress.SetMarquee(TRUE, 30);
+					pWebSearchEngineDlg->MessageBox(_T("Cannot apply data mining to the database"), _T("Error"), MB_OK);
+					return false;
 				}
+				pWebSearchEngineDlg->m_pProgress.SetMarquee(TRUE, 30);
 			}
-			gDataMiningTerms.clear();
 		}
-		return true;
+		gDataMiningTerms.clear();
 	}
-	return false;
+	return true;
 }
@@ -26,45 +26,225 @@ WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
 #include "stdafx.h"
 #include "ODBCWrappers.h"
 #include "WebSearchEngineDlg.h"
+#include "HttpFetcher.h"
+#include "DnsResolver.h"
+#include <string_view>
 
  // Type aliases for core data structures used in the search engine
-typedef std::vector<std::string> FrontierArray;           ///< List of URLs (frontier)
-typedef std::map<std::string, int> FrontierScore;         ///< URL to score mapping
-typedef std::map<std::wstring, __int64> WebpageIndex;     ///< Webpage URL to ID mapping
 typedef std::map<std::wstring, __int64> KeywordIndex;     ///< Keyword to ID mapping
 typedef std::vector<std::wstring> KeywordArray;           ///< List of keywords
 
+#define OPIC_SEED_CASH 1.0 // OPIC cash given to a seed URL
+
+#define FETCH_TAG_ROBOTS 1 // CHttpFetcher::Submit tag of a robots.txt download; pages use 0
+
+/// What the crawler does next with an extracted URL.
+enum class FetchReadiness
+{
+	WAIT,   ///< Its host is being resolved or its robots.txt fetched: ask again later
+	DROP,   ///< Its host does not exist or robots.txt disallows it: release it unfetched
+	FETCH
+};
+
+/// What LoadCrawlCheckpoint found.
+enum class CheckpointState
+{
+	NONE,       ///< No checkpoint file: a fresh crawl
+	RESUMED,    ///< The crawl continues from the checkpoint
+	UNREADABLE  ///< A checkpoint exists but is damaged or from another version: nothing was restored
+};
+
 /**
- * @brief Adds a new URL to the frontier if not already visited or present.
+ * @brief Canonicalizes a URL and adds it to the frontier if not already visited or present.
  * @param lpszURL The URL to add.
- * @return true if added or already present, false on error.
+ * @param rCash The OPIC cash the link carries; seeds get OPIC_SEED_CASH.
+ * @return true if added or already present, false if the URL cannot be crawled.
  */
-bool AddURLToFrontier(const std::string& lpszURL);
+bool AddURLToFrontier(const std::string& lpszURL, double rCash = OPIC_SEED_CASH);
 
 /**
- * @brief Extracts the next URL from the frontier, prioritizing by score.
+ * @brief Extracts the next URL from the calling thread's batch, prioritizing by OPIC cash
+ *        among the hosts that politeness allows to be fetched now.
+ *        Waits briefly when every queued host is still cooling down.
  * @param[out] lpszURL The extracted URL.
- * @return true if a URL was extracted, false if the frontier is empty.
+ * @return true if a URL was extracted, false if none is ready (see IsFrontierEmpty).
  */
 bool ExtractURLFromFrontier(std::string& lpszURL);
 
 /**
- * @brief Downloads a web page from a URL and saves it to a temporary file.
- * @param lpszURL The URL to download.
- * @param[out] lpszFilename The path to the downloaded file.
- * @return true if the download succeeded, false otherwise.
+ * @brief Tells the politeness scheduler that an extracted URL was dropped without being fetched.
+ * @param lpszURL The URL returned by ExtractURLFromFrontier.
+ * @return The OPIC cash of the page.
+ */
+double ReleaseURLToFrontier(const std::string& lpszURL);
+
+/**
+ * @brief Tells the politeness scheduler that the fetch of an extracted URL has finished,
+ * adapting the host's rate to the response time, to 429/503 answers and to Retry-After.
+ * @param pResult The completed fetch.
+ * @return The OPIC cash of the page, to be passed to ProcessHTML.
+ */
+double ReleaseURLToFrontier(const CFetchResult& pResult);
+
+/**
+ * @brief Gives back an extracted URL whose fetch was cancelled, so the next run crawls it.
+ * @param lpszURL The URL returned by ExtractURLFromFrontier.
+ */
+void ReturnURLToFrontier(const std::string& lpszURL);
+
+/**
+ * @brief Checks whether there is nothing left to crawl: no URL is queued and
+ *        no page that could still add links is being processed.
+ */
+bool IsFrontierEmpty();
+
+/**
+ * @brief Marks the start of a page in the calling crawler thread; checkpoints wait for it to end.
+ */
+void EnterCrawlPage();
+
+/**
+ * @brief Marks the end of the page started by EnterCrawlPage.
+ */
+void LeaveCrawlPage();
+
+/**
+ * @brief Sets the per-host politeness parameters.
+ * @param nBackQueues Number of hosts scheduled at the same time.
+ * @param nMinimumDelay Minimum delay between two fetches from the same host, in milliseconds.
+ */
+void ConfigurePoliteness(UINT nBackQueues, UINT nMinimumDelay);
+
+/**
+ * @brief Switches the visited URL set to a Bloom filter with a fixed memory budget.
+ * @param nMemoryMB Memory budget in megabytes; 0 keeps the exact hash set.
+ * @param nFalsePositivePPM Target false positive rate, in parts per million.
+ * @return true if the visited set was configured.
+ */
+bool ConfigureVisitedFilter(UINT nMemoryMB, UINT nFalsePositivePPM);
+
+/**
+ * @brief Lets the frontier spill its low-priority tail to segment files on disk.
+ * @param lpszDirectory Directory for the segment files; empty keeps the frontier in memory.
+ * @param nHeadCapacity Maximum number of URLs kept in memory.
+ * @return true if the frontier was configured.
+ */
+bool ConfigureFrontierSpill(const std::string& lpszDirectory, UINT nHeadCapacity);
+
+/**
+ * @brief Sets the limits that keep spider traps out of the frontier.
+ * @param nHostBudget Distinct URLs admitted per host; 0 for no limit.
+ * @param nPatternBudget Distinct URLs admitted per host and URL pattern; 0 for no limit.
+ * @param nMaxDepth Maximum number of path segments; 0 for no limit.
+ */
+void ConfigureSpiderTraps(UINT nHostBudget, UINT nPatternBudget, UINT nMaxDepth);
+
+/**
+ * @brief Sets up the crawler's host name resolver.
+ * @param nNegativeTTL Seconds a nonexistent host stays cached.
+ * @param lpszServer IPv4 address, with an optional ":port", of the DNS server; empty for the system resolver.
+ * @return false if the server address is invalid; the system resolver is used then.
+ */
+bool ConfigureResolver(UINT nNegativeTTL, const std::string& lpszServer);
+
+/**
+ * @brief Cancels the host lookups in flight and waits for them to end.
+ */
+void CancelResolver();
+
+/**
+ * @brief Tells the crawler that every response comes from a WARC archive,
+ *        so host names are not resolved and hosts get no delay between fetches.
+ */
+void SetOfflineCrawl(bool bOffline);
+
+/**
+ * @brief Sets how many sites keep their robots.txt rules in memory.
+ */
+void ConfigureRobots(UINT nCapacity);
+
+/**
+ * @brief Checks without blocking whether an extracted URL can be fetched now: its host
+ *        must resolve and its robots.txt must allow it. Starts the lookups that are missing.
+ * @param lpszURL The URL returned by ExtractURLFromFrontier.
+ * @param bFirstAttempt false when polling a URL that was reported as WAIT.
+ */
+FetchReadiness PrepareURLForFetch(const std::string& lpszURL, bool bFirstAttempt);
+
+/**
+ * @brief Takes the next robots.txt URL to download, tagged FETCH_TAG_ROBOTS.
+ * @return false if no robots.txt is waiting to be fetched.
+ */
+bool TakeRobotsFetch(std::string& lpszRobotsURL);
+
+/**
+ * @brief Stores the rules of a downloaded robots.txt.
+ * @param lpszRobotsURL The URL given by TakeRobotsFetch.
+ * @param bReceived false if the download failed; the site is then treated as unreachable.
+ * @param nStatusCode HTTP status of the response.
+ * @param pBody Body of the response.
+ */
+void CompleteRobotsFetch(const std::string& lpszRobotsURL, bool bReceived, DWORD nStatusCode, std::string_view pBody);
+
+/**
+ * @brief Forgets a robots.txt download that was cancelled, so it is fetched again later.
+ */
+void DiscardRobotsFetch(const std::string& lpszRobotsURL);
+
+/**
+ * @brief Starts resolving the hosts the politeness scheduler will fetch from next.
+ */
+void PrefetchFrontierHosts();
+
+/**
+ * @brief Publishes frontier statistics and writes all crawler metrics to the debug output.
+ * @param pFetcher The crawl's fetcher, whose statistics are published too; may be nullptr.
+ */
+void DumpCrawlerMetrics(const CHttpFetcher* pFetcher = nullptr);
+
+/**
+ * @brief Sets where and how often the crawl state is checkpointed.
+ * @param lpszPath Path of the checkpoint file.
+ * @param nInterval Seconds between periodic checkpoints; 0 saves only when the crawl stops.
+ */
+void ConfigureCrawlCheckpoint(const std::string& lpszPath, UINT nInterval);
+
+/**
+ * @brief Restores the crawl state saved by SaveCrawlCheckpoint.
+ *        Must be called before the frontier is configured or used.
+ * @return RESUMED if the crawl resumes from the checkpoint, NONE if there is no checkpoint
+ *         and the crawl starts from scratch, UNREADABLE if a checkpoint exists but cannot be loaded.
+ */
+CheckpointState LoadCrawlCheckpoint();
+
+/**
+ * @brief Checks whether the periodic checkpoint interval has elapsed.
+ */
+bool IsCheckpointDue();
+
+/**
+ * @brief Writes the crawl state to the checkpoint file, after the pages in progress
+ *        have ended. Must not be called between EnterCrawlPage and LeaveCrawlPage.
+ * @param bForce true to save now, false to save only if the checkpoint interval has elapsed.
+ * @return true if a checkpoint was written.
+ */
+bool SaveCrawlCheckpoint(bool bForce);
+
+/**
+ * @brief Returns the number of webpages and keywords stored so far.
  */
-bool DownloadURLToFile(const std::string& lpszURL, std::string& lpszFilename);
+void GetCrawlCounters(__int64& nWebpages, __int64& nKeywords);
 
 /**
- * @brief Processes an HTML file: extracts title, hyperlinks, and plain text,
+ * @brief Processes an HTML page: extracts title, hyperlinks, and plain text,
  *        updates the database with webpage and keyword information.
  * @param pWebSearchEngineDlg Pointer to the main dialog for UI and database access.
- * @param lpszFilename Path to the HTML file to process.
+ * @param pHtmlContent The downloaded page; only read during the call.
  * @param lpszURL The URL of the processed page.
+ * @param rCash The OPIC cash of the page, split evenly among its hyperlinks.
  * @return true if processing succeeded, false otherwise.
  */
-bool ProcessHTML(CWebSearchEngineDlg* pWebSearchEngineDlg, const std::string& lpszFilename, const std::string& lpszURL);
+bool ProcessHTML(CWebSearchEngineDlg* pWebSearchEngineDlg, std::string_view pHtmlContent, const std::string& lpszURL, double rCash);
 
 /**
  * @class CGenericStatement
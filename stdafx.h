@@ -86,6 +86,27 @@ WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
 #define REGKEY_FILENAME _T("filename")
 #define REGKEY_USERNAME _T("username")
 #define REGKEY_PASSWORD _T("password")
+#define REGKEY_VISITEDFILTER _T("visited_filter_mb")
+#define REGKEY_FALSEPOSITIVE _T("visited_filter_fp_ppm")
+#define REGKEY_SPILLDIRECTORY _T("frontier_spill_dir")
+#define REGKEY_FRONTIERHEAD _T("frontier_head_urls")
+#define REGKEY_BACKQUEUES _T("politeness_back_queues")
+#define REGKEY_HOSTDELAY _T("politeness_delay_ms")
+#define REGKEY_CHECKPOINT _T("crawl_checkpoint")
+#define REGKEY_CHECKPOINTINTERVAL _T("crawl_checkpoint_sec")
+#define REGKEY_CRAWLERTHREADS _T("crawler_threads")
+#define REGKEY_HOSTBUDGET _T("trap_host_budget")
+#define REGKEY_PATTERNBUDGET _T("trap_pattern_budget")
+#define REGKEY_MAXDEPTH _T("trap_max_depth")
+#define REGKEY_FETCHINFLIGHT _T("fetch_in_flight")
+#define REGKEY_CONNECTIONSPERHOST _T("fetch_connections_per_host")
+#define REGKEY_IDLETIMEOUT _T("fetch_idle_timeout_sec")
+#define REGKEY_MAXBODYSIZE _T("fetch_max_body_kb")
+#define REGKEY_DNSSERVER _T("dns_server")
+#define REGKEY_NEGATIVETTL _T("dns_negative_ttl_sec")
+#define REGKEY_ROBOTSCACHE _T("robots_cache_hosts")
+#define REGKEY_WARCREPLAY _T("warc_replay")
+#define REGKEY_WARCRECORD _T("warc_record")
 
 #define DEFAULT_DBTYPE DB_MYSQL
 #define DEFAULT_HOSTNAME _T("localhost")
@@ -94,6 +115,27 @@ WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
 #define DEFAULT_FILENAME _T("")
 #define DEFAULT_USERNAME _T("root")
 #define DEFAULT_PASSWORD _T("")
+#define DEFAULT_VISITEDFILTER 0 /*exact visited set*/
+#define DEFAULT_FALSEPOSITIVE 1000 /*parts per million*/
+#define DEFAULT_SPILLDIRECTORY _T("") /*keep the whole frontier in memory*/
+#define DEFAULT_FRONTIERHEAD 1000000
+#define DEFAULT_BACKQUEUES 64
+#define DEFAULT_HOSTDELAY 1000
+#define DEFAULT_CHECKPOINT _T("") /*%LOCALAPPDATA%\WebSearchEngine\crawl.ckpt*/
+#define DEFAULT_CHECKPOINTINTERVAL 300
+#define DEFAULT_CRAWLERTHREADS 4
+#define DEFAULT_HOSTBUDGET 100000
+#define DEFAULT_PATTERNBUDGET 5000
+#define DEFAULT_MAXDEPTH 16
+#define DEFAULT_FETCHINFLIGHT 256
+#define DEFAULT_CONNECTIONSPERHOST 2
+#define DEFAULT_IDLETIMEOUT 30
+#define DEFAULT_MAXBODYSIZE 8192
+#define DEFAULT_DNSSERVER _T("") /*system resolver*/
+#define DEFAULT_NEGATIVETTL 300
+#define DEFAULT_ROBOTSCACHE 16384
+#define DEFAULT_WARCREPLAY _T("") /*fetch from the network*/
+#define DEFAULT_WARCRECORD _T("") /*do not record*/
 
 #define MAX_URL_LENGTH 0x1000
 
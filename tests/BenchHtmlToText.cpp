@@ -0,0 +1,57 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file BenchHtmlToText.cpp
+ * @brief Measures CHtmlToText throughput on a synthetic page, converting into a reused buffer.
+ *
+ * Usage: BenchHtmlToText [page size in MB], 16 by default.
+ */
+
+#include "stdafx.h"
+#include "HtmlToText.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#define BENCH_ROUNDS 20 // conversions timed
+
+int main(int argc, char* argv[])
+{
+	const size_t nPageSize = ((argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 16) * 1024 * 1024;
+	static const char* const lpszParagraphs[] = {
+		"<p class=\"intro\">Lorem ipsum dolor sit amet, consectetur adipiscing elit,\n sed do <b>eiusmod</b> tempor incididunt ut labore et dolore magna aliqua.</p>\n",
+		"<div id=\"nav\"><ul><li><a href=\"/one\">One</a></li><li><a href=\"/two\">Two</a></li></ul></div>\n",
+		"<table><tr><td>Ut enim ad minim veniam,</td><td>quis nostrud exercitation ullamco laboris</td></tr></table>\n",
+		"<script>var a = 1; if (a < 2) { a++; }</script><p>Duis aute irure dolor in reprehenderit in voluptate velit esse.</p>\n",
+	};
+	std::string strPage = "<html><head><title>Benchmark</title></head><body>\n";
+	for (size_t nIndex = 0; strPage.length() < nPageSize; nIndex++)
+		strPage += lpszParagraphs[nIndex % (sizeof(lpszParagraphs) / sizeof(lpszParagraphs[0]))];
+	strPage += "</body></html>\n";
+
+	CHtmlToText pConverter;
+	CHtmlVisitor pVisitor;
+	std::string strText;
+	pConverter.Convert(strPage, strText, &pVisitor);
+	const auto tStart = std::chrono::steady_clock::now();
+	for (int nRound = 0; nRound < BENCH_ROUNDS; nRound++)
+		pConverter.Convert(strPage, strText, &pVisitor);
+	const double rSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+
+	std::printf("%zu bytes of HTML -> %zu bytes of text%s\n", strPage.length(), strText.length(), pConverter.IsTruncated() ? " (truncated)" : "");
+	std::printf("%.1f MB/s\n", static_cast<double>(strPage.length()) * BENCH_ROUNDS / rSeconds / 1e6);
+	return 0;
+}
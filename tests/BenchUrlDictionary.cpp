@@ -0,0 +1,114 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file BenchUrlDictionary.cpp
+ * @brief Compares the memory and lookup time of CUrlDictionary with the
+ *        std::map<std::wstring, __int64> it replaced. The map's memory is counted
+ *        by its allocator, the dictionary's by GetMemoryBytes.
+ *
+ * Usage: BenchUrlDictionary [URL count], 2000000 by default.
+ */
+
+#include "stdafx.h"
+#include "UrlDictionary.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+static size_t gAllocatedBytes = 0; ///< Bytes currently allocated by CCountingAllocator
+
+/// Standard allocator that keeps count of the bytes it has handed out.
+template <class T>
+struct CCountingAllocator
+{
+	typedef T value_type;
+
+	CCountingAllocator() = default;
+	template <class U> CCountingAllocator(const CCountingAllocator<U>&) {}
+
+	T* allocate(size_t nCount)
+	{
+		gAllocatedBytes += nCount * sizeof(T);
+		return std::allocator<T>().allocate(nCount);
+	}
+	void deallocate(T* pMemory, size_t nCount)
+	{
+		gAllocatedBytes -= nCount * sizeof(T);
+		std::allocator<T>().deallocate(pMemory, nCount);
+	}
+
+	template <class U> bool operator==(const CCountingAllocator<U>&) const { return true; }
+};
+
+/// The std::map<std::wstring, __int64> that CUrlDictionary replaced, with its allocations counted.
+typedef std::basic_string<wchar_t, std::char_traits<wchar_t>, CCountingAllocator<wchar_t>> CountedWString;
+typedef std::map<CountedWString, __int64, std::less<CountedWString>, CCountingAllocator<std::pair<const CountedWString, __int64>>> CountedURLMap;
+
+static std::string MakeURL(size_t nIndex)
+{
+	static const char* lpszSites[] = { "https://en.wikipedia.org/wiki/Article_", "https://www.example.com/products/category/item-", "http://news.example.org/2024/05/story?id=", "https://forum.example.net/threads/topic." };
+	return lpszSites[nIndex % 4] + std::to_string(nIndex / 4 * 2654435761u % 1000000007u);
+}
+
+static double Seconds(std::chrono::steady_clock::time_point tStart)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t nCount = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+	std::vector<std::string> arrURLs;
+	arrURLs.reserve(nCount);
+	for (size_t nIndex = 0; nIndex < nCount; nIndex++)
+		arrURLs.push_back(MakeURL(nIndex));
+
+	auto tStart = std::chrono::steady_clock::now();
+	CountedURLMap mapURLs;
+	for (size_t nIndex = 0; nIndex < nCount; nIndex++)
+		mapURLs.emplace(CountedWString(arrURLs[nIndex].begin(), arrURLs[nIndex].end()), static_cast<__int64>(nIndex));
+	const double rMapInsert = Seconds(tStart);
+	const size_t nMapBytes = gAllocatedBytes;
+	tStart = std::chrono::steady_clock::now();
+	size_t nFound = 0;
+	for (size_t nIndex = 0; nIndex < nCount; nIndex++)
+		nFound += mapURLs.count(CountedWString(arrURLs[nIndex].begin(), arrURLs[nIndex].end()));
+	const double rMapLookup = Seconds(tStart);
+	mapURLs.clear();
+
+	tStart = std::chrono::steady_clock::now();
+	CUrlDictionary pDictionary;
+	for (size_t nIndex = 0; nIndex < nCount; nIndex++)
+		pDictionary.Insert(arrURLs[nIndex], static_cast<__int64>(nIndex));
+	pDictionary.Merge();
+	const double rDictionaryInsert = Seconds(tStart);
+	const size_t nDictionaryBytes = pDictionary.GetMemoryBytes();
+	tStart = std::chrono::steady_clock::now();
+	__int64 nID = 0;
+	for (size_t nIndex = 0; nIndex < nCount; nIndex++)
+		nFound += pDictionary.Lookup(arrURLs[nIndex], nID) ? 1 : 0;
+	const double rDictionaryLookup = Seconds(tStart);
+
+	std::printf("%zu URLs, %zu found\n", nCount, nFound);
+	std::printf("std::map<std::wstring>: %6.1f bytes/URL, insert %6.2f s, lookup %6.2f s\n",
+		static_cast<double>(nMapBytes) / nCount, rMapInsert, rMapLookup);
+	std::printf("CUrlDictionary:         %6.1f bytes/URL, insert %6.2f s, lookup %6.2f s\n",
+		static_cast<double>(nDictionaryBytes) / nCount, rDictionaryInsert, rDictionaryLookup);
+	return 0;
+}
@@ -0,0 +1,101 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file TestBloomFilter.cpp
+ * @brief Checks that CBloomFilter has no false negatives, keeps close to its target
+ *        false positive rate, and rejects damaged saved filters.
+ */
+
+#include "stdafx.h"
+#include "BloomFilter.h"
+#include "TestCheck.h"
+#include <sstream>
+#include <string>
+
+#define BLOOM_HEADER_HASHES 12   // offset of the probe count in a saved filter
+#define BLOOM_HEADER_WORDS 40    // offset of the word count in a saved filter
+
+static std::string MakeKey(int nIndex)
+{
+	return "https://www.example.com/page/" + std::to_string(nIndex);
+}
+
+int main()
+{
+	const int nKeys = 100000;
+	const double rTarget = 0.01;
+	CBloomFilter pFilter;
+	CHECK(!pFilter.IsCreated());
+	CHECK(!pFilter.Contains(MakeKey(0)));
+	CHECK(!pFilter.Create(4, rTarget));
+	CHECK(!pFilter.Create(1024, 0.0));
+	CHECK(!pFilter.Create(1024, 1.0));
+
+	// sized so that nKeys is the capacity at the target rate
+	CHECK(pFilter.Create(120 * 1024, rTarget));
+	CHECK(pFilter.GetCapacity() >= static_cast<unsigned __int64>(nKeys));
+	for (int nIndex = 0; nIndex < nKeys; nIndex++)
+		pFilter.Insert(MakeKey(nIndex));
+	CHECK(pFilter.GetInsertedCount() == static_cast<unsigned __int64>(nKeys));
+
+	int nFalseNegatives = 0, nFalsePositives = 0;
+	for (int nIndex = 0; nIndex < nKeys; nIndex++)
+		nFalseNegatives += pFilter.Contains(MakeKey(nIndex)) ? 0 : 1;
+	for (int nIndex = nKeys; nIndex < 2 * nKeys; nIndex++)
+		nFalsePositives += pFilter.Contains(MakeKey(nIndex)) ? 1 : 0;
+	const double rMeasured = static_cast<double>(nFalsePositives) / nKeys;
+	CHECK(nFalseNegatives == 0);
+	CHECK(rMeasured < 2 * rTarget);
+	CHECK((pFilter.GetEstimatedFalsePositiveRate() > rTarget / 2) && (pFilter.GetEstimatedFalsePositiveRate() < 2 * rTarget));
+	std::printf("false positive rate %.4f, estimated %.4f, target %.4f\n", rMeasured, pFilter.GetEstimatedFalsePositiveRate(), rTarget);
+
+	// the hash is part of the saved format and must not change between builds
+	CHECK(CBloomFilter::Hash("https://www.example.com/") == 0x92D1D7CB6D6FA8F3ULL);
+
+	std::stringstream pStream;
+	CHECK(pFilter.Save(pStream));
+	const std::string strSaved = pStream.str();
+	CBloomFilter pLoaded;
+	CHECK(pLoaded.Load(pStream));
+	CHECK(pLoaded.GetMemoryBytes() == pFilter.GetMemoryBytes());
+	CHECK(pLoaded.GetInsertedCount() == pFilter.GetInsertedCount());
+	int nDifferences = 0;
+	for (int nIndex = 0; nIndex < 2 * nKeys; nIndex++)
+		nDifferences += (pLoaded.Contains(MakeKey(nIndex)) != pFilter.Contains(MakeKey(nIndex))) ? 1 : 0;
+	CHECK(nDifferences == 0);
+
+	// a filter without probes would report every key as present
+	std::string strDamaged = strSaved;
+	std::memset(&strDamaged[BLOOM_HEADER_HASHES], 0, sizeof(unsigned int));
+	std::istringstream pNoProbes(strDamaged);
+	CHECK(!pLoaded.Load(pNoProbes));
+	CHECK(!pLoaded.IsCreated() && !pLoaded.Contains(MakeKey(0)));
+
+	// a word count beyond the end of the stream is rejected before it is allocated
+	strDamaged = strSaved;
+	const unsigned __int64 nHugeWords = 1ULL << 60;
+	std::memcpy(&strDamaged[BLOOM_HEADER_WORDS], &nHugeWords, sizeof(nHugeWords));
+	std::istringstream pHugeWords(strDamaged);
+	CHECK(!pLoaded.Load(pHugeWords));
+	CHECK(!pLoaded.IsCreated());
+
+	for (size_t nLength : { size_t(0), size_t(10), size_t(BLOOM_HEADER_WORDS + 4), strSaved.size() - 1 })
+	{
+		std::istringstream pTruncated(strSaved.substr(0, nLength));
+		CHECK(!pLoaded.Load(pTruncated));
+		CHECK(!pLoaded.IsCreated());
+	}
+	return TEST_RESULT();
+}
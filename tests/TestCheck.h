@@ -0,0 +1,32 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file TestCheck.h
+ * @brief Minimal assertion helpers shared by the component tests.
+ */
+
+#pragma once
+
+#include <cstdio>
+
+static int gTestFailures = 0; ///< Failed checks in this test program
+
+/// Reports a failed condition without stopping the test, so one run lists every failure.
+#define CHECK(x) \
+	do { if (!(x)) { std::fprintf(stderr, "%s(%d): CHECK failed: %s\n", __FILE__, __LINE__, #x); gTestFailures++; } } while (0)
+
+/// Exit status of a test program: 0 if every check passed.
+#define TEST_RESULT() \
+	((gTestFailures == 0) ? 0 : (std::fprintf(stderr, "%d check(s) failed\n", gTestFailures), 1))
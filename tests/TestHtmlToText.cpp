@@ -0,0 +1,249 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file TestHtmlToText.cpp
+ * @brief Checks the text CHtmlToText produces and the page structure it reports.
+ */
+
+#include "stdafx.h"
+#include "HtmlToText.h"
+#include "TestCheck.h"
+#include <string>
+#include <vector>
+
+/// Records every callback as one line, so a page's structure can be compared as a whole.
+class CRecordingVisitor : public CHtmlVisitor
+{
+public:
+	void OnTitle(std::string_view title) override { m_arrEvents.push_back("title[" + std::string(title) + "]"); }
+	void OnLink(std::string_view href, std::string_view anchorText) override { m_arrEvents.push_back("link[" + std::string(href) + "][" + std::string(anchorText) + "]"); }
+	void OnMeta(std::string_view name, std::string_view content) override { m_arrEvents.push_back("meta[" + std::string(name) + "][" + std::string(content) + "]"); }
+
+	std::vector<std::string> m_arrEvents;
+};
+
+/// Text outside <pre> as Convert should write it: tabs, CRs and LFs become spaces.
+static std::string MapWhitespace(std::string strText)
+{
+	for (char& ch : strText)
+	{
+		if ((ch == '\t') || (ch == '\r') || (ch == '\n'))
+			ch = ' ';
+	}
+	return strText;
+}
+
+static void TestTextRuns()
+{
+	CHtmlToText pConverter;
+	std::string strText;
+	pConverter.Convert("a\tb\r\nc  d", strText);
+	CHECK(strText == "a b  c  d");
+	pConverter.Convert("<p>x</p><pre>\n  a\tb\r\n</pre>y\tz", strText);
+	CHECK(strText == "\nx\n   a\tb\r\n\ny z");
+
+	// a tag at every offset of runs shorter and longer than the vector width,
+	// so each kernel and the scalar tail see the '<' in every lane
+	static const char szAlphabet[] = "abcdefgh \t\r\n.,;&>/";
+	unsigned int nSeed = 1;
+	int nMismatches = 0;
+	for (size_t nLength : { 1, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 1000 })
+	{
+		std::string strRun(nLength, ' ');
+		for (char& ch : strRun)
+		{
+			nSeed = nSeed * 1103515245 + 12345;
+			ch = szAlphabet[(nSeed >> 16) % (sizeof(szAlphabet) - 1)];
+		}
+		for (size_t nOffset = 0; nOffset <= nLength; nOffset++)
+		{
+			const std::string strPage = strRun.substr(0, nOffset) + "<b>" + strRun.substr(nOffset);
+			pConverter.Convert(strPage, strText);
+			nMismatches += (strText == MapWhitespace(strRun.substr(0, nOffset)) + ' ' + MapWhitespace(strRun.substr(nOffset))) ? 0 : 1;
+		}
+	}
+	CHECK(nMismatches == 0);
+}
+
+static void TestTagSeparators()
+{
+	struct TAG_SEPARATOR
+	{
+		const char* lpszTag;
+		const char* lpszText; ///< Converted "a<tag>b"
+	};
+	static const TAG_SEPARATOR arrTags[] = {
+		{ "address", "a\nb" }, { "blockquote", "a\nb" }, { "div", "a\nb" }, { "dl", "a\nb" }, { "fieldset", "a\nb" },
+		{ "form", "a\nb" }, { "h1", "a\nb" }, { "/h1", "a\nb" }, { "h6", "a\nb" }, { "/h6", "a\nb" }, { "p", "a\nb" },
+		{ "/p", "a\nb" }, { "table", "a\nb" }, { "/table", "a\nb" }, { "ul", "a\nb" }, { "/ul", "a\nb" }, { "ol", "a\nb" },
+		{ "/ol", "a\nb" }, { "/li", "a\nb" }, { "br", "a\nb" }, { "br/", "a\nb" }, { "/td", "a\tb" }, { "/tr", "a\nb" },
+		{ "/pre", "a\nb" }, { "body", "a b" }, { "/body", "a " }, { "a href=x", "a b" }, { "/a", "a b" }, { "meta", "a b" },
+		// names that are not in the table, some hashing close to ones that are
+		{ "li", "a b" }, { "/div", "a b" }, { "h7", "a b" }, { "divx", "a b" }, { "d", "a b" }, { "bodyx", "a b" },
+		{ "/bodyx", "a b" }, { "pres", "a b" }, { "scripts", "a b" }, { "x-div", "a b" },
+	};
+
+	CHtmlToText pConverter;
+	std::string strText;
+	for (const auto& pTag : arrTags)
+	{
+		// tag names are matched without regard to case
+		for (bool bUpper : { false, true })
+		{
+			std::string strTag = pTag.lpszTag;
+			if (bUpper)
+				std::transform(strTag.begin(), strTag.end(), strTag.begin(), [](char ch) { return (char)toupper((unsigned char)ch); });
+			pConverter.Convert("a<" + strTag + ">b", strText);
+			if (strText != pTag.lpszText)
+				std::fprintf(stderr, "<%s> gives \"%s\"\n", strTag.c_str(), strText.c_str());
+			CHECK(strText == pTag.lpszText);
+		}
+	}
+}
+
+static void TestIgnoredContent()
+{
+	struct IGNORED_CASE
+	{
+		const char* lpszPage;
+		const char* lpszText;
+	};
+	static const IGNORED_CASE arrCases[] = {
+		// script and style end only at their own end tag, whatever markup they contain
+		{ "<p>a<script>if (a<b) x='</div>'; </scriptx> y</SCRIPT >b<style>p{}</style>c", "\na b c" },
+		{ "<p>a<script>never closed", "\na " },
+		{ "<p>a<!-- <script> -->b<ScRiPt src=x />hidden</script>c", "\na b c" },
+		// object and noscript count nested elements of the same name
+		{ "<p>a<object><param name=x><object>in</object>still</object>b", "\na b" },
+		{ "<p>a<object/>b<noscript><p>ns</p></noscript>c", "\na b c" },
+		{ "a<noscript>x<noscript>y</noscript>z</noscript>b", "a b" },
+	};
+
+	CHtmlToText pConverter;
+	std::string strText;
+	for (const auto& pCase : arrCases)
+	{
+		pConverter.Convert(pCase.lpszPage, strText);
+		if (strText != pCase.lpszText)
+			std::fprintf(stderr, "\"%s\" gives \"%s\"\n", pCase.lpszPage, strText.c_str());
+		CHECK(strText == pCase.lpszText);
+		CHECK(!pConverter.IsTruncated());
+	}
+
+	// nesting is counted up to a limit; deeper end tags are then plain tags
+	std::string strPage;
+	for (int nDepth = 0; nDepth < 100; nDepth++)
+		strPage += "<object>";
+	for (int nDepth = 0; nDepth < 100; nDepth++)
+		strPage += "</object>";
+	pConverter.Convert(strPage + "after", strText);
+	CHECK((strText.length() > 5) && (strText.substr(strText.length() - 5) == "after"));
+
+	// millions of unclosed elements are skipped without recursion; a slow build
+	// may also run out of parse time first, which leaves the same text
+	strPage.clear();
+	for (int nDepth = 0; nDepth < 2000000; nDepth++)
+		strPage += "<object>";
+	pConverter.Convert(strPage + "x", strText);
+	CHECK(strText == " ");
+}
+
+static void TestReuse()
+{
+	// random markup, some of it preformatted, through one converter and one buffer
+	static const char* const lpszAlphabets[] = { "ab <>/\t\r\n\"'=pre!-x", "abcdefghijklmnopqrstuvwxyz      \t\n\r.,<" };
+	CHtmlToText pReused;
+	std::string strReused;
+	unsigned int nSeed = 7;
+	int nMismatches = 0;
+	for (int nPage = 0; nPage < 5000; nPage++)
+	{
+		const char* lpszAlphabet = lpszAlphabets[nPage & 1];
+		const size_t nAlphabet = strlen(lpszAlphabet);
+		nSeed = nSeed * 1103515245 + 12345;
+		std::string strPage((nSeed >> 16) % ((nPage & 1) ? 3000 : 200), ' ');
+		for (char& ch : strPage)
+		{
+			nSeed = nSeed * 1103515245 + 12345;
+			ch = lpszAlphabet[(nSeed >> 16) % nAlphabet];
+		}
+		if ((nPage % 7) == 0)
+			strPage = "<pre>" + strPage + "</pre>" + strPage;
+
+		CHtmlToText pFresh;
+		std::string strFresh;
+		pFresh.Convert(strPage, strFresh);
+		pReused.Convert(strPage, strReused);
+		nMismatches += (strReused == strFresh) ? 0 : 1;
+	}
+	CHECK(nMismatches == 0);
+
+	// converting into a buffer that is large enough does not reallocate it
+	std::string strText;
+	pReused.Convert(std::string(100000, 'x'), strText);
+	const char* lpszBuffer = strText.data();
+	pReused.Convert("<p>short</p>", strText);
+	CHECK(strText == "\nshort\n");
+	pReused.Convert(std::string(50000, 'y') + "<br>", strText);
+	CHECK(strText.data() == lpszBuffer);
+	CHECK(strText.length() == 50001);
+
+	// the previous content of the buffer is replaced
+	strText = "stale";
+	pReused.Convert("", strText);
+	CHECK(strText.empty());
+}
+
+static void TestVisitor()
+{
+	const std::string strPage = "<HTML><head><TITLE> Hello &amp; World </TITLE><meta name=robots content='noindex, nofollow'>"
+		"<META property=\"og:title\" content=\"X\"><meta charset=utf-8></head><body>"
+		"<A class=x HREF='/one'>One <b>bold</b></a> text <a href=two.html>Two<a href=\"three\" >Three</A>"
+		"<a name=x>no</a><br/><a href = \"four\"/><title>Second</title><a href=\"  five \">Five";
+	const std::vector<std::string> arrExpected = {
+		"title[Hello &amp; World]",
+		"meta[robots][noindex, nofollow]",
+		"meta[og:title][X]",
+		"link[/one][One  bold]",
+		"link[two.html][Two]",
+		"link[three][Three]",
+		"link[four][Second]", // a slash does not close an <a> element
+		"link[five][Five]",
+	};
+
+	CHtmlToText pConverter;
+	CRecordingVisitor pVisitor;
+	std::string strText, strPlain;
+	pConverter.Convert(strPage, strText, &pVisitor);
+	CHECK(pVisitor.m_arrEvents == arrExpected);
+	for (const auto& strEvent : pVisitor.m_arrEvents)
+		std::printf("%s\n", strEvent.c_str());
+
+	// reporting the structure does not change the text
+	pConverter.Convert(strPage, strPlain);
+	CHECK(strText == strPlain);
+	CHECK(strText.find("One  bold") != std::string::npos);
+	CHECK(strText.find("Five") != std::string::npos);
+}
+
+int main()
+{
+	TestTextRuns();
+	TestTagSeparators();
+	TestIgnoredContent();
+	TestReuse();
+	TestVisitor();
+	return TEST_RESULT();
+}
@@ -0,0 +1,94 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file TestUrlCanonicalizer.cpp
+ * @brief Checks CUrlCanonicalizer against a table of URLs and their canonical forms.
+ */
+
+#include "stdafx.h"
+#include "UrlCanonicalizer.h"
+#include "BloomFilter.h"
+#include "TestCheck.h"
+#include <string>
+
+struct CANONICAL_CASE
+{
+	const char* lpszURL;
+	const char* lpszCanonical; ///< nullptr if the URL must be rejected
+};
+
+static const CANONICAL_CASE arrCases[] = {
+	// scheme and host case, default port, fragment, dot segments, query order
+	{ "HTTP://WWW.Example.COM:80/a/./b/../c?b=2&a=1#frag", "http://www.example.com/a/c?a=1&b=2" },
+	{ "https://example.com:443", "https://example.com/" },
+	{ "https://example.com:8443/", "https://example.com:8443/" },
+	{ "http://example.com:0080/", "http://example.com/" },
+	{ "http://Example.COM./", "http://example.com/" },
+	{ "http://user:pw@Example.com/", "http://user:pw@example.com/" },
+	{ "http://[::1]:8080/x", "http://[::1]:8080/x" },
+	{ "  http://example.com/a\n/b  ", "http://example.com/a/b" },
+	// percent encoding: unreserved characters decoded, escapes uppercase, unsafe bytes escaped
+	{ "http://example.com/%7euser/%2fx%2Fy/a%20b", "http://example.com/~user/%2Fx%2Fy/a%20b" },
+	{ "http://example.com/a b<c", "http://example.com/a%20b%3Cc" },
+	{ "http://example.com/100%", "http://example.com/100%25" },
+	// dot segments
+	{ "http://example.com/a/../../b", "http://example.com/b" },
+	{ "http://example.com/a/b/..", "http://example.com/a/" },
+	{ "http://example.com/./", "http://example.com/" },
+	// session ids and tracking parameters
+	{ "http://example.com/shop;jsessionid=ABC123/item?x=1", "http://example.com/shop/item?x=1" },
+	{ "http://example.com/?utm_source=x&id=5&gclid=abc&UTM_Medium=y", "http://example.com/?id=5" },
+	{ "http://example.com/?utm_source=x", "http://example.com/" },
+	{ "http://example.com/?PHPSESSID=1&q=a&&", "http://example.com/?q=a" },
+	// equal names keep their order
+	{ "http://example.com/?b=2&a=1&b=1", "http://example.com/?a=1&b=2&b=1" },
+	// not http or https, or not well formed
+	{ "ftp://example.com/", nullptr },
+	{ "mailto:someone@example.com", nullptr },
+	{ "example.com/page", nullptr },
+	{ "://example.com/", nullptr },
+	{ "http:///path", nullptr },
+	{ "http://example.com:99999/", nullptr },
+	{ "http://example.com:80a/", nullptr },
+	{ "http://exa mple.com/", nullptr },
+	{ "   ", nullptr },
+};
+
+int main()
+{
+	for (const auto& pCase : arrCases)
+	{
+		std::string strCanonical;
+		const bool bCanonical = CUrlCanonicalizer::Canonicalize(pCase.lpszURL, strCanonical);
+		const bool bPassed = (pCase.lpszCanonical != nullptr) ? (bCanonical && (strCanonical == pCase.lpszCanonical)) : !bCanonical;
+		if (!bPassed)
+			std::fprintf(stderr, "\"%s\" -> \"%s\", expected \"%s\"\n", pCase.lpszURL, bCanonical ? strCanonical.c_str() : "(rejected)",
+				(pCase.lpszCanonical != nullptr) ? pCase.lpszCanonical : "(rejected)");
+		CHECK(bPassed);
+
+		// canonicalizing twice changes nothing
+		std::string strAgain;
+		if (bCanonical)
+			CHECK(CUrlCanonicalizer::Canonicalize(strCanonical, strAgain) && (strAgain == strCanonical));
+	}
+
+	// a trailing slash on a non-root path does not change the fingerprint
+	CHECK(CUrlCanonicalizer::Fingerprint("http://example.com/dir") == CUrlCanonicalizer::Fingerprint("http://example.com/dir/"));
+	CHECK(CUrlCanonicalizer::Fingerprint("http://example.com/dir?a=1") == CUrlCanonicalizer::Fingerprint("http://example.com/dir/?a=1"));
+	CHECK(CUrlCanonicalizer::Fingerprint("http://example.com/") == CBloomFilter::Hash("http://example.com/"));
+	CHECK(CUrlCanonicalizer::Fingerprint("http://example.com/dir") != CUrlCanonicalizer::Fingerprint("http://example.com/other"));
+	CHECK(CUrlCanonicalizer::Fingerprint("http://example.com/dir") != CUrlCanonicalizer::Fingerprint("https://example.com/dir"));
+	return TEST_RESULT();
+}
@@ -0,0 +1,123 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file TestUrlDictionary.cpp
+ * @brief Checks CUrlDictionary lookups in both directions, across merges and a save/load round trip.
+ */
+
+#include "stdafx.h"
+#include "UrlDictionary.h"
+#include "TestCheck.h"
+#include <sstream>
+#include <memory>
+#include <string>
+
+static std::string MakeURL(int nIndex)
+{
+	static const char* lpszSites[] = { "https://en.wikipedia.org/wiki/Page_", "https://www.example.com/blog/2024/", "http://news.example.org/story?id=", "https://docs.example.net/api/v2/" };
+	return lpszSites[nIndex % 4] + std::to_string(nIndex * 7919 % 100003);
+}
+
+/// A saved dictionary holding one URL, with its ID given as raw varint bytes.
+static std::unique_ptr<std::istringstream> MakeSingleEntryStream(const std::string& lpszURL, const std::string& lpszID)
+{
+	std::string strEntry = { 0, static_cast<char>(lpszURL.length()) };
+	strEntry += lpszURL + lpszID;
+	const unsigned int nVersion = 1;
+	const unsigned __int64 nCount = 1, nBytes = strEntry.length();
+	std::string strSaved = "WSEURLDC";
+	strSaved.append(reinterpret_cast<const char*>(&nVersion), sizeof(nVersion));
+	strSaved.append(reinterpret_cast<const char*>(&nCount), sizeof(nCount));
+	strSaved.append(reinterpret_cast<const char*>(&nBytes), sizeof(nBytes));
+	return std::make_unique<std::istringstream>(strSaved + strEntry);
+}
+
+static void CheckContents(const CUrlDictionary& pDictionary, int nCount)
+{
+	int nMissing = 0;
+	for (int nIndex = 0; nIndex < nCount; nIndex++)
+	{
+		__int64 nID = -1;
+		std::string strURL;
+		if (!pDictionary.Lookup(MakeURL(nIndex), nID) || (nID != nIndex) ||
+			!pDictionary.GetURL(nIndex, strURL) || (strURL != MakeURL(nIndex)))
+			nMissing++;
+	}
+	CHECK(nMissing == 0);
+	CHECK(pDictionary.GetCount() == static_cast<size_t>(nCount));
+}
+
+int main()
+{
+	const int nCount = 50000;
+	CUrlDictionary pDictionary;
+	__int64 nID = 0;
+	std::string strURL;
+	CHECK(!pDictionary.Lookup("https://www.example.com/", nID));
+	CHECK(!pDictionary.GetURL(0, strURL));
+
+	// spans several merges of the buffer into the blocks
+	for (int nIndex = 0; nIndex < nCount; nIndex++)
+		CHECK(pDictionary.Insert(MakeURL(nIndex), nIndex));
+	CheckContents(pDictionary, nCount);
+
+	CHECK(!pDictionary.Insert(MakeURL(123), nCount));
+	CHECK(!pDictionary.Insert("https://www.example.com/negative", -1));
+	CHECK(!pDictionary.Lookup("https://en.wikipedia.org/wiki/Page_", nID));
+	CHECK(!pDictionary.Lookup("https://docs.example.net/api/v2/100003", nID));
+	CHECK(!pDictionary.Lookup("", nID));
+	CHECK(!pDictionary.Lookup("zzz", nID));
+	CHECK(!pDictionary.GetURL(nCount, strURL));
+	CHECK(!pDictionary.GetURL(-1, strURL));
+
+	pDictionary.Merge();
+	CheckContents(pDictionary, nCount);
+	CHECK(pDictionary.GetMemoryBytes() < static_cast<size_t>(nCount) * 32);
+
+	std::stringstream pStream;
+	CHECK(pDictionary.Save(pStream));
+	const std::string strSaved = pStream.str();
+	CUrlDictionary pLoaded;
+	CHECK(pLoaded.Load(pStream));
+	CheckContents(pLoaded, nCount);
+
+	// inserts after a load land in the buffer and then in the blocks
+	CHECK(pLoaded.Insert("https://www.example.com/added", nCount));
+	CHECK(pLoaded.Lookup("https://www.example.com/added", nID) && (nID == nCount));
+	pLoaded.Merge();
+	CHECK(pLoaded.GetURL(nCount, strURL) && (strURL == "https://www.example.com/added"));
+
+	// a damaged stream is rejected and leaves the dictionary empty
+	for (size_t nLength : { size_t(0), size_t(7), size_t(20), strSaved.size() / 2, strSaved.size() - 1 })
+	{
+		std::istringstream pTruncated(strSaved.substr(0, nLength));
+		CHECK(!pLoaded.Load(pTruncated));
+		CHECK(pLoaded.GetCount() == 0);
+	}
+	std::string strDamaged = strSaved;
+	strDamaged[0] = 'X';
+	std::istringstream pBadMagic(strDamaged);
+	CHECK(!pLoaded.Load(pBadMagic));
+
+	// an ID far beyond the URL count is rejected before the rank table is sized after it
+	CHECK(!pLoaded.Load(*MakeSingleEntryStream("https://www.example.com/", std::string(8, static_cast<char>(0xFF)) + '\x3F')));
+	CHECK(pLoaded.Load(*MakeSingleEntryStream("https://www.example.com/", "\x05")));
+	CHECK(pLoaded.GetURL(5, strURL) && (strURL == "https://www.example.com/"));
+
+	pDictionary.Clear();
+	CHECK(pDictionary.GetCount() == 0);
+	CHECK(!pDictionary.Lookup(MakeURL(0), nID));
+	return TEST_RESULT();
+}
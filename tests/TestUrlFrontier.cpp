@@ -0,0 +1,162 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+/**
+ * @file TestUrlFrontier.cpp
+ * @brief Checks CUrlFrontier ordering, held hosts, checkpoints and spilling to disk.
+ *
+ * The frontier's segment files use the Win32 file mapping API, so this test is
+ * only built on Windows.
+ */
+
+#include "stdafx.h"
+#include "UrlFrontier.h"
+#include "PolitenessScheduler.h"
+#include "TestCheck.h"
+#include <chrono>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+/// Extracts every URL left, waiting for the spill thread when memory has run dry.
+static std::vector<std::string> ExtractAll(CUrlFrontier& pFrontier)
+{
+	std::vector<std::string> arrURLs;
+	std::string strURL;
+	while (!pFrontier.IsEmpty())
+	{
+		if (pFrontier.Extract(strURL))
+			arrURLs.push_back(strURL);
+		else
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return arrURLs;
+}
+
+static void TestOrder()
+{
+	CUrlFrontier pFrontier;
+	CHECK(pFrontier.Add("http://a.example.com/", 1.0));
+	CHECK(pFrontier.Add("http://b.example.com/", 3.0));
+	CHECK(pFrontier.Add("http://c.example.com/", 2.0));
+	CHECK(pFrontier.Add("http://d.example.com/", 3.0));
+	// more cash for a queued URL raises its priority
+	CHECK(pFrontier.Add("http://a.example.com/", 1.5));
+	CHECK(pFrontier.GetQueuedCount() == 4);
+
+	// equal cash: the URL discovered first comes first
+	const std::vector<std::string> arrExpected = { "http://b.example.com/", "http://d.example.com/", "http://a.example.com/", "http://c.example.com/" };
+	CHECK(ExtractAll(pFrontier) == arrExpected);
+	CHECK(pFrontier.GetVisitedCount() == 4);
+
+	// an extracted URL is not queued again, but collects cash until its page is crawled
+	CHECK(pFrontier.IsVisited("http://a.example.com/"));
+	CHECK(!pFrontier.Add("http://a.example.com/", 1.0));
+	CHECK(pFrontier.TakeCash("http://a.example.com/") == 3.5);
+	CHECK(pFrontier.TakeCash("http://a.example.com/") == 0.0);
+	CHECK(!pFrontier.Add("http://a.example.com/", 1.0));
+	CHECK(pFrontier.IsEmpty());
+}
+
+static void TestHeldHosts()
+{
+	// a busy host's URLs are set aside once instead of starving the other hosts
+	CUrlFrontier pFrontier;
+	for (int nIndex = 0; nIndex < 10000; nIndex++)
+		pFrontier.Add("http://hub.example.com/" + std::to_string(nIndex), 1000.0 + nIndex);
+	for (int nIndex = 0; nIndex < 10; nIndex++)
+		pFrontier.Add("http://small.example.org/" + std::to_string(nIndex), 1.0);
+
+	// one call sets aside at most EXTRACT_HOLD_LIMIT URLs and then finds nothing
+	std::string strURL;
+	const auto pAcceptSmall = [](const std::string& lpszURL) { return CPolitenessScheduler::GetHost(lpszURL) != CPolitenessScheduler::GetHost("http://hub.example.com/"); };
+	int nCalls = 1;
+	while (!pFrontier.Extract(strURL, pAcceptSmall) && (nCalls < 10))
+		nCalls++;
+	CHECK((nCalls == 3) && (strURL == "http://small.example.org/0"));
+	CHECK(pFrontier.GetQueuedCount() == 10009);
+
+	std::string strHub;
+	CHECK(pFrontier.ExtractHeld(CPolitenessScheduler::GetHost("http://hub.example.com/"), strHub) && (strHub == "http://hub.example.com/9999"));
+	CHECK(!pFrontier.ExtractHeld(CPolitenessScheduler::GetHost("http://none.example.com/"), strHub));
+	CHECK(pFrontier.Extract(strURL) && (strURL == "http://small.example.org/1"));
+
+	// a checkpoint keeps the held URLs, which go back to the main queue when it is loaded
+	std::stringstream pStream;
+	CHECK(pFrontier.Save(pStream));
+	CUrlFrontier pLoaded;
+	CHECK(pLoaded.Load(pStream));
+	CHECK(pLoaded.GetQueuedCount() == 10007);
+	CHECK(pLoaded.Extract(strURL) && (strURL == "http://hub.example.com/9998"));
+}
+
+static void TestCheckpoint()
+{
+	CUrlFrontier pFrontier;
+	for (int nIndex = 0; nIndex < 1000; nIndex++)
+		pFrontier.Add("http://www.example.com/page/" + std::to_string(nIndex), (nIndex * 37) % 101);
+	std::string strURL;
+	for (int nIndex = 0; nIndex < 100; nIndex++)
+		pFrontier.Extract(strURL);
+
+	std::stringstream pStream;
+	CHECK(pFrontier.Save(pStream));
+	const std::string strSaved = pStream.str();
+	CUrlFrontier pLoaded;
+	CHECK(pLoaded.Load(pStream));
+	CHECK(pLoaded.GetVisitedCount() == 100);
+	CHECK(pLoaded.IsVisited(strURL));
+	CHECK(ExtractAll(pLoaded) == ExtractAll(pFrontier));
+
+	// a damaged checkpoint leaves the frontier empty
+	for (size_t nLength : { size_t(0), size_t(16), strSaved.size() / 2, strSaved.size() - 1 })
+	{
+		std::istringstream pTruncated(strSaved.substr(0, nLength));
+		CHECK(!pLoaded.Load(pTruncated));
+		CHECK(pLoaded.IsEmpty() && (pLoaded.GetVisitedCount() == 0));
+	}
+}
+
+static void TestSpill()
+{
+	const std::filesystem::path strDirectory = std::filesystem::temp_directory_path() / "WebSearchEngineTestUrlFrontier";
+	std::filesystem::remove_all(strDirectory);
+	std::filesystem::create_directories(strDirectory);
+
+	const int nCount = 100000;
+	{
+		// a small head forces many segment files and merges
+		CUrlFrontier pFrontier;
+		CHECK(pFrontier.SetSpillDirectory(strDirectory.string(), 8192));
+		for (int nIndex = 0; nIndex < nCount; nIndex++)
+			pFrontier.Add("http://www.example.com/spill/" + std::to_string(nIndex), (nIndex * 7919) % 1000);
+		const std::vector<std::string> arrURLs = ExtractAll(pFrontier);
+		const std::unordered_set<std::string> setURLs(arrURLs.begin(), arrURLs.end());
+		CHECK(arrURLs.size() == static_cast<size_t>(nCount));
+		CHECK(setURLs.size() == static_cast<size_t>(nCount));
+		pFrontier.Close();
+	}
+	std::filesystem::remove_all(strDirectory);
+}
+
+int main()
+{
+	TestOrder();
+	TestHeldHosts();
+	TestCheckpoint();
+	TestSpill();
+	return TEST_RESULT();
+}
@@ -0,0 +1,66 @@
+/* Copyright (C) 2022-2026 Stefan-Mihai MOGA
+This file is part of WebSearchEngine application developed by Stefan-Mihai MOGA.
+
+WebSearchEngine is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the Open
+Source Initiative, either version 3 of the License, or any later version.
+
+WebSearchEngine is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+WebSearchEngine. If not, see <http://www.opensource.org/licenses/gpl-3.0.html>*/
+
+// stdafx.h : stand-in for the application's precompiled header, so that the
+// components without MFC dependencies can be built and tested on their own
+
+#pragma once
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <tchar.h>
+#else
+#include <chrono>
+
+#define __int64 long long
+typedef unsigned long long ULONGLONG;
+
+#define _T(x) x
+
+inline ULONGLONG GetTickCount64()
+{
+	return static_cast<ULONGLONG>(std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+#endif
+
+#include <cstring>
+
+//Pull in support for STL, as the application's stdafx.h does
+#include <map>
+#include <string>
+#include <vector>
+#include <memory>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <filesystem>
+
+#define MAX_URL_LENGTH 0x1000
+
+// the components are tested as they run in a release build: ASSERT is compiled
+// out and VERIFY only evaluates its argument
+#ifndef ASSERT
+#define ASSERT(x) ((void)0)
+#endif
+
+#ifndef VERIFY
+#define VERIFY(x) ((void)(x))
+#endif